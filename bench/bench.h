@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A tiny benchmark harness. Each case registers itself with
+ * `BENCH_CASE`, and `bench [filter...]` runs every case whose name contains one
+ * of the filters.
+ */
+struct BenchCase {
+    const char *name;
+    void (*run)();
+};
+
+inline std::vector<BenchCase> &bench_cases() {
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+struct BenchRegistrar {
+    BenchRegistrar(const char *name, void (*run)()) {
+        bench_cases().push_back({name, run});
+    }
+};
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+
+#define BENCH_CASE(name)                                                       \
+    static void BENCH_CONCAT(_bench_case_, __LINE__)();                        \
+    static BenchRegistrar BENCH_CONCAT(_bench_registrar_, __LINE__)(           \
+        name, BENCH_CONCAT(_bench_case_, __LINE__));                           \
+    static void BENCH_CONCAT(_bench_case_, __LINE__)()
+
+/**
+ * @brief Run `fn` `repeat` times and return the fastest run in seconds.
+ */
+template <typename Fn> double bench_time(Fn &&fn, int repeat = 5) {
+    double best = 1e300;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop - start).count();
+        if (seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Print one result line as `name: time, MB/s`.
+ * @param bytes The number of input bytes processed by one run.
+ */
+void bench_report(const std::string &name, double seconds, std::size_t bytes);
+
+/**
+ * @brief Print one result line as `name: time, unit/s`.
+ * @param items The number of items processed by one run.
+ */
+void bench_report_items(const std::string &name, double seconds,
+                        std::size_t items, const char *unit);
+
+/**
+ * @brief Keep the compiler from optimizing away a computed value.
+ */
+template <typename T> void bench_keep(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief Write `content` to a fresh temporary file and return its path.
+ */
+std::string bench_temp_file(const std::string &content);
@@ -0,0 +1,50 @@
+#include "bench.h"
+#include "corpus.h"
+#include "tolang/ast_cache.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include "tolang/token_buffer.h"
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+/**
+ * @brief Compare a cold front end, which lexes and parses the source, with a
+ * hit in the AST cache, which hashes the source and loads the saved arrays.
+ */
+BENCH_CASE("ast-cache/load-vs-parse") {
+    auto input = generate_corpus({20, 20, 1000, 4, 1}, 16 << 20);
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+
+    double parse_time = bench_time([&] {
+        Lexer lexer(begin, end);
+        TokenBuffer tokens(lexer.source());
+        lexer.tokenize(tokens);
+        bench_keep(Parser(tokens, lexer.names()).parse());
+    });
+    bench_report("ast-cache/lex-and-parse", parse_time, input.size());
+
+    auto dir = std::filesystem::temp_directory_path() /
+               ("tolang-bench-cache-" + std::to_string(getpid()));
+    AstCache cache(dir.string());
+    {
+        Lexer lexer(begin, end);
+        TokenBuffer tokens(lexer.source());
+        lexer.tokenize(tokens);
+        cache.store(input, flatten(*Parser(tokens, lexer.names()).parse()));
+    }
+    std::size_t entry = std::filesystem::file_size(cache.path(input));
+
+    double hash_time = bench_time([&] { bench_keep(hash_source(input)); });
+    bench_report("ast-cache/hash", hash_time, input.size());
+
+    double load_time = bench_time([&] {
+        auto ast = cache.load(input);
+        bench_keep(ast->exps.size());
+    });
+    bench_report("ast-cache/load", load_time, input.size());
+    bench_report("ast-cache/load (entry bytes)", load_time, entry);
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,45 @@
+#include "bench.h"
+#include "corpus.h"
+#include "tolang/ast_printer.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include "tolang/token_buffer.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+/**
+ * @brief Compare `--emit-ast` through the virtual `Node::print` with the
+ * buffered `AstPrinter`, writing to a file like the compiler does.
+ */
+BENCH_CASE("ast-printer/emit") {
+    auto input = generate_corpus({20, 20, 1000, 4, 1}, 4 << 20);
+    Lexer lexer(input.data(), input.data() + input.size());
+    TokenBuffer tokens(lexer.source());
+    lexer.tokenize(tokens);
+    auto root = Parser(tokens, lexer.names()).parse();
+    auto path = bench_temp_file("");
+
+    double virtual_time = bench_time([&] {
+        std::ofstream out(path);
+        root->print(out);
+    });
+    bench_report("ast-printer/node-print", virtual_time, input.size());
+
+    struct {
+        const char *name;
+        AstFormat format;
+    } formats[] = {
+        {"ast-printer/text", AstFormat::TEXT},
+        {"ast-printer/sexp", AstFormat::SEXP},
+        {"ast-printer/json", AstFormat::JSON},
+    };
+    for (auto &format : formats) {
+        double time = bench_time([&] {
+            std::ofstream out(path);
+            AstPrinter(out, format.format).print(*root);
+        });
+        bench_report(format.name, time, input.size());
+    }
+    std::remove(path.c_str());
+}
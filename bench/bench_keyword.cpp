@@ -0,0 +1,53 @@
+#include "bench.h"
+#include "tolang/keyword.h"
+#include "tolang/token.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// identifier-heavy input, mostly non-keywords as in generated programs
+static constexpr const char *WORDS[] = {
+    "x",        "n",      "square", "newton_step", "i",    "let",
+    "tmp_0",    "tmp_1",  "acc",    "fibo",        "to",   "loop",
+    "if",       "result", "a",      "b",           "put",  "counter",
+    "helper_7", "value",  "get",    "tag",         "fn",   "var",
+    "delta",    "eps",    "lo",     "hi",          "mid",  "step_size",
+};
+
+BENCH_CASE("keyword/perfect-hash-vs-map") {
+    std::vector<std::string> storage;
+    for (int i = 0; i < (1 << 20); i++) {
+        storage.emplace_back(WORDS[i % std::size(WORDS)]);
+    }
+    std::vector<std::string_view> words(storage.begin(), storage.end());
+
+    static const std::unordered_map<std::string_view, Token::TokenType> table =
+        {
+            {"fn", Token::TK_FN},   {"var", Token::TK_VAR},
+            {"get", Token::TK_GET}, {"put", Token::TK_PUT},
+            {"tag", Token::TK_TAG}, {"let", Token::TK_LET},
+            {"if", Token::TK_IF},   {"to", Token::TK_TO},
+        };
+
+    double map_time = bench_time([&] {
+        int keywords = 0;
+        for (auto word : words) {
+            auto it = table.find(word);
+            keywords += it != table.end() && it->second != Token::TK_IDENT;
+        }
+        bench_keep(keywords);
+    });
+    bench_report_items("keyword/unordered_map", map_time, words.size(),
+                       "words");
+
+    double hash_time = bench_time([&] {
+        int keywords = 0;
+        for (auto word : words) {
+            keywords += keyword_type(word) != Token::TK_IDENT;
+        }
+        bench_keep(keywords);
+    });
+    bench_report_items("keyword/perfect-hash", hash_time, words.size(),
+                       "words");
+}
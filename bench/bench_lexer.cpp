@@ -0,0 +1,207 @@
+#include "bench.h"
+#include "tolang/incremental_lexer.h"
+#include "tolang/lexer.h"
+#include "tolang/parallel_lexer.h"
+#include "tolang/source.h"
+#include "tolang/token.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static constexpr char SAMPLE[] = R"(fn square(x) => x * x;
+fn newton_step(x, n) => x - (square(x) - n) / (2 * x);
+
+var n;
+var x;
+var i;
+
+get n;
+let x = n / 2;
+let i = 0;
+# iterate until the answer is good enough
+tag loop;
+let x = newton_step(x, n);
+let i = i + 1;
+if i < 20 to loop;
+put x;
+)";
+
+static std::string make_input(std::size_t bytes) {
+    std::string input;
+    input.reserve(bytes + sizeof(SAMPLE));
+    while (input.size() < bytes) {
+        input += SAMPLE;
+    }
+    return input;
+}
+
+static std::size_t lex_all(Lexer &lexer) {
+    std::size_t count = 0;
+    Token token;
+    lexer.next(token);
+    while (token.type != Token::TK_EOF) {
+        count++;
+        lexer.next(token);
+    }
+    return count;
+}
+
+BENCH_CASE("lexer/stream-vs-mmap") {
+    auto input = make_input(16 << 20);
+    auto path = bench_temp_file(input);
+
+    double stream_time = bench_time([&] {
+        std::ifstream in(path, std::ios::in);
+        Lexer lexer(in);
+        bench_keep(lex_all(lexer));
+    });
+    bench_report("lexer/istream", stream_time, input.size());
+
+    double mmap_time = bench_time([&] {
+        auto source = SourceBuffer::map_file(path);
+        Lexer lexer(source);
+        bench_keep(lex_all(lexer));
+    });
+    bench_report("lexer/mmap", mmap_time, input.size());
+
+    std::remove(path.c_str());
+}
+
+BENCH_CASE("lexer/trivia") {
+    // deeply indented code with long comments, as emitted by generators
+    std::string input;
+    while (input.size() < (16 << 20)) {
+        input += "# ---------------------------------------------------------\n"
+                 "# generated block, do not edit by hand\n"
+                 "#\n"
+                 "                let x = x + 1;\n"
+                 "\n\n\n"
+                 "                        put x;   # trailing comment\n";
+    }
+
+    double time = bench_time([&] {
+        Lexer lexer(input.data(), input.data() + input.size());
+        bench_keep(lex_all(lexer));
+    });
+    bench_report("lexer/trivia", time, input.size());
+}
+
+BENCH_CASE("lexer/serial-vs-parallel") {
+    auto input = make_input(64 << 20);
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+
+    double serial_time = bench_time([&] {
+        Lexer lexer(begin, end);
+        TokenBuffer tokens(lexer.source());
+        lexer.tokenize(tokens);
+        bench_keep(tokens.size());
+    });
+    bench_report("lexer/serial", serial_time, input.size());
+
+    for (unsigned threads : {2u, 4u, 8u}) {
+        double parallel_time = bench_time([&] {
+            ParallelLexer lexer(begin, end, std::make_shared<NameTable>(),
+                                threads);
+            TokenBuffer tokens(lexer.source());
+            lexer.tokenize(tokens);
+            bench_keep(tokens.size());
+        });
+        bench_report("lexer/parallel-" + std::to_string(threads),
+                     parallel_time, input.size());
+    }
+}
+
+BENCH_CASE("lexer/number-conversion") {
+    std::string input;
+    for (int i = 0; input.size() < (16 << 20); i++) {
+        input += std::to_string(i * 7919ull % 100003) + "." +
+                 std::to_string(i * 104729ull % 1000003) + "\n";
+    }
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+
+    // the lexer converts every literal as it scans
+    double lexer_time = bench_time([&] {
+        Lexer lexer(begin, end);
+        Token token;
+        float sum = 0;
+        for (lexer.next(token); token.type != Token::TK_EOF;
+             lexer.next(token)) {
+            sum += token.value;
+        }
+        bench_keep(sum);
+    });
+    bench_report("lexer/number-in-lexer", lexer_time, input.size());
+
+    // the conversion done by the parser before, on top of the lexer
+    double stof_time = bench_time([&] {
+        Lexer lexer(begin, end);
+        Token token;
+        float sum = 0;
+        for (lexer.next(token); token.type != Token::TK_EOF;
+             lexer.next(token)) {
+            sum += std::stof(std::string(token.content));
+        }
+        bench_keep(sum);
+    });
+    bench_report("lexer/number-in-lexer+stof", stof_time, input.size());
+}
+
+BENCH_CASE("lexer/full-vs-incremental") {
+    auto base = make_input(16 << 20);
+    auto names = std::make_shared<NameTable>();
+    Lexer base_lexer(base.data(), base.data() + base.size(), names);
+    TokenBuffer base_tokens(base_lexer.source());
+    base_lexer.tokenize(base_tokens);
+
+    // retype one line in the middle of the file
+    auto input = base;
+    std::size_t line = input.find('\n', input.size() / 2) + 1;
+    TextEdit edit{line, 0, 14};
+    input.insert(line, "let i = i + 2;");
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+
+    double full_time = bench_time([&] {
+        Lexer lexer(begin, end, names);
+        TokenBuffer tokens(lexer.source());
+        lexer.tokenize(tokens);
+        bench_keep(tokens.size());
+    });
+    bench_report("lexer/full-relex", full_time, input.size());
+
+    // relex a fresh copy of the old tokens every run, outside of the timing
+    std::vector<TokenBuffer> copies(5, base_tokens);
+    double incremental_time = bench_time([&] {
+        IncrementalLexer lexer(names);
+        lexer.relex(copies.back(), input, edit);
+        bench_keep(copies.back().size());
+        copies.pop_back();
+    });
+    bench_report("lexer/incremental-relex", incremental_time, input.size());
+
+    // Type the line over a blank one and blank it again, one keystroke per
+    // edit, in a source that is updated in place. Every edit is at the gap
+    // that the one before left, but for the first, outside of the timing.
+    std::string text = "let i = i + 2;";
+    auto typed = base;
+    std::size_t start = base.find('\n', base.size() / 2) + 1;
+    typed.insert(start, std::string(text.size(), ' ') + "\n");
+    Lexer typed_lexer(typed.data(), typed.data() + typed.size(), names);
+    TokenBuffer typed_tokens(typed_lexer.source());
+    typed_lexer.tokenize(typed_tokens);
+    IncrementalLexer typist(names);
+    typist.relex(typed_tokens, typed, {start, 1, 1});
+    double keystroke_time = bench_time([&] {
+        for (std::size_t i = 0; i < 2 * text.size(); i++) {
+            std::size_t column = i % text.size();
+            typed[start + column] = i < text.size() ? text[column] : ' ';
+            typist.relex(typed_tokens, typed, {start + column, 1, 1});
+        }
+        bench_keep(typed_tokens.size());
+    });
+    bench_report_items("lexer/keystrokes", keystroke_time, 2 * text.size(),
+                       "keystrokes");
+}
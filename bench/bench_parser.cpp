@@ -0,0 +1,162 @@
+#include "bench.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include "tolang/token_buffer.h"
+#include <string>
+
+static constexpr char SAMPLE[] = R"(fn square(x) => x * x;
+fn poly(a, b, c, x) => a * square(x) + b * x + c;
+
+var n;
+var x;
+var i;
+
+get n;
+let x = n / 2;
+let i = 0;
+tag loop;
+let x = x - (square(x) - n) / (2 * x);
+let i = i + 1;
+if i < 20 to loop;
+put poly(1, -2, 0.5, x);
+)";
+
+static std::string make_input(std::size_t bytes) {
+    std::string input;
+    input.reserve(bytes + sizeof(SAMPLE));
+    // only the first copy may hold the function and variable definitions
+    input += SAMPLE;
+    std::string body = SAMPLE;
+    body = body.substr(body.find("get n;"));
+    while (input.size() < bytes) {
+        input += body;
+    }
+    return input;
+}
+
+BENCH_CASE("parser/streaming-vs-token-buffer") {
+    auto input = make_input(16 << 20);
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+
+    double stream_time = bench_time([&] {
+        Lexer lexer(begin, end);
+        Parser parser(lexer);
+        bench_keep(parser.parse());
+    });
+    bench_report("lex+parse/streaming", stream_time, input.size());
+
+    double buffer_time = bench_time([&] {
+        Lexer lexer(begin, end);
+        TokenBuffer tokens(lexer.source());
+        lexer.tokenize(tokens);
+        Parser parser(tokens, lexer.names());
+        bench_keep(parser.parse());
+    });
+    bench_report("lex+parse/token-buffer", buffer_time, input.size());
+}
+
+BENCH_CASE("parser/constant-table") {
+    // a generated table of constants, the worst case for number conversion
+    std::string input = "var t;\n";
+    for (int i = 0; input.size() < (16 << 20); i++) {
+        input += "let t = " + std::to_string(i * 7919ull % 100003) + "." +
+                 std::to_string(i * 104729ull % 1000003) + ";\n";
+    }
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+
+    double time = bench_time([&] {
+        Lexer lexer(begin, end);
+        Parser parser(lexer);
+        bench_keep(parser.parse());
+    });
+    bench_report("lex+parse/constant-table", time, input.size());
+}
+
+BENCH_CASE("parser/build-and-free") {
+    // about a million statements, parsed from tokens that are scanned once,
+    // so that the time is spent on building and freeing the tree
+    auto input = make_input(12 << 20);
+    Lexer lexer(input.data(), input.data() + input.size());
+    TokenBuffer tokens(lexer.source());
+    lexer.tokenize(tokens);
+
+    std::size_t statements = 0;
+    double parse_time = bench_time([&] {
+        Parser parser(tokens, lexer.names());
+        auto root = parser.parse();
+        statements = root->stmts.size();
+        bench_keep(root);
+    });
+    bench_report_items("parse+free/statements", parse_time, statements,
+                       "stmts");
+}
+
+BENCH_CASE("parser/long-expressions") {
+    // one statement with a million terms, and many statements nested a few
+    // thousand levels deep, which a recursive parser can still handle
+    std::string chain = "var x;\nlet x = 1";
+    for (int i = 1; i < 1000000; i++) {
+        chain += " +-*/"[i % 4 + 1];
+        chain += i % 3 == 0 ? "x" : std::to_string(i % 100);
+    }
+    chain += ";\n";
+
+    std::string nested = "var x;\nfn f(a) => a;\n";
+    while (nested.size() < chain.size()) {
+        nested += "let x = ";
+        for (int i = 0; i < 5000; i++) {
+            nested += i % 2 == 0 ? "-(" : "f(";
+        }
+        nested += "x";
+        nested.append(5000, ')');
+        nested += ";\n";
+    }
+
+    for (const auto &[name, input] :
+         {std::pair{"chain", &chain}, std::pair{"nested", &nested}}) {
+        Lexer lexer(input->data(), input->data() + input->size());
+        TokenBuffer tokens(lexer.source());
+        lexer.tokenize(tokens);
+
+        double time = bench_time([&] {
+            Parser parser(tokens, lexer.names());
+            bench_keep(parser.parse());
+        });
+        bench_report_items(std::string("parse/") + name, time, tokens.size(),
+                           "tokens");
+    }
+}
+
+BENCH_CASE("parser/parallel-func-defs") {
+    // tens of thousands of small helpers, each calling the one before it
+    std::string input = "fn f0(a, b) => a + b;\n";
+    for (int i = 1; input.size() < (16 << 20); i++) {
+        input += "fn f" + std::to_string(i) + "(a, b) => f" +
+                 std::to_string(i - 1) + "(a * " + std::to_string(i % 100) +
+                 ", b - a) / (a + 1);\n";
+    }
+    input += "var x;\nget x;\nput f1(x, x);\n";
+    Lexer lexer(input.data(), input.data() + input.size());
+    TokenBuffer tokens(lexer.source());
+    lexer.tokenize(tokens);
+
+    std::size_t func_defs = 0;
+    double serial_time = bench_time([&] {
+        auto root = Parser(tokens, lexer.names()).parse();
+        func_defs = root->func_defs.size();
+        bench_keep(root);
+    });
+    bench_report_items("parse/func-defs/serial", serial_time, func_defs,
+                       "defs");
+
+    for (unsigned threads : {2u, 4u}) {
+        double time = bench_time([&] {
+            bench_keep(Parser(tokens, lexer.names()).parse_parallel(threads));
+        });
+        bench_report_items("parse/func-defs/" + std::to_string(threads) +
+                               "-threads",
+                           time, func_defs, "defs");
+    }
+}
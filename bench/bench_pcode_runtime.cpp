@@ -0,0 +1,53 @@
+#include "bench.h"
+#include "tolang/error.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include "tolang/visitor.h"
+#include <string>
+
+#if TOLANG_BACKEND == PCODE
+#include "pcode/PcodeModule.h"
+#include "pcode/runtime/PcodeRuntime.h"
+
+static constexpr int LOOP_COUNT = 200000;
+
+// A loop of loads, stores, arithmetic, calls and jumps, with no input and no
+// output, so that only the interpreter is measured.
+static const std::string LOOP = R"(fn square(x) => x * x;
+fn mix(a, b) => square(a) / (b + 1) - a * 0.5;
+
+var i;
+var s;
+
+let i = 0;
+let s = 0;
+tag loop;
+let s = s + mix(i, s) - square(i) / (i + 1);
+if s < 0 to negative;
+let s = -s;
+tag negative;
+let i = i + 1;
+if i < )" + std::to_string(LOOP_COUNT) + R"( to loop;
+)";
+
+/**
+ * @brief Run a compiled loop in `PcodeRuntime`, and report it in loop
+ * iterations per second.
+ */
+BENCH_CASE("pcode-runtime/loop") {
+    Lexer lexer(LOOP.data(), LOOP.data() + LOOP.size());
+    auto root = Parser(lexer).parse();
+    PcodeModule module;
+    Visitor(module).visit(*root);
+    if (DiagnosticsEngine::current().has_error()) {
+        DiagnosticsEngine::current().dump(std::cerr, *root->lines);
+        return;
+    }
+
+    double time = bench_time([&] {
+        PcodeRuntime runtime(module);
+        runtime.run();
+    });
+    bench_report_items("pcode-runtime/loop", time, LOOP_COUNT, "iterations");
+}
+#endif
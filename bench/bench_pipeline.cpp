@@ -0,0 +1,95 @@
+#include "bench.h"
+#include "corpus.h"
+#include "tolang/error.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include "tolang/token_buffer.h"
+#include "tolang/visitor.h"
+#include <sstream>
+#include <string>
+
+#if TOLANG_BACKEND == LLVM
+#include "llvm/asm/AsmPrinter.h"
+#include "llvm/ir/Module.h"
+#elif TOLANG_BACKEND == PCODE
+#include "pcode/PcodeModule.h"
+#endif
+
+/**
+ * @brief Run every front-end stage over a generated program on its own, and
+ * report the throughput of each in MB/s of source and in tokens or syntax
+ * tree nodes per second.
+ */
+static void bench_pipeline(const std::string &name, const CorpusShape &shape,
+                           std::size_t bytes) {
+    auto input = generate_corpus(shape, bytes);
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+
+    Lexer lexer(begin, end);
+    TokenBuffer tokens(lexer.source());
+    lexer.tokenize(tokens);
+    double lex_time = bench_time([&] {
+        Lexer lexer(begin, end);
+        TokenBuffer tokens(lexer.source());
+        lexer.tokenize(tokens);
+        bench_keep(tokens.size());
+    });
+    bench_report(name + "/lexer", lex_time, input.size());
+    bench_report_items(name + "/lexer", lex_time, tokens.size(), "tokens");
+
+    auto root = Parser(tokens, lexer.names()).parse();
+    if (DiagnosticsEngine::current().has_error()) {
+        DiagnosticsEngine::current().dump(std::cerr, *root->lines);
+        return;
+    }
+    std::size_t nodes = count_nodes(*root);
+    double parse_time = bench_time([&] {
+        Parser parser(tokens, lexer.names());
+        bench_keep(parser.parse());
+    });
+    bench_report(name + "/parser", parse_time, input.size());
+    bench_report_items(name + "/parser", parse_time, nodes, "nodes");
+
+#if TOLANG_BACKEND == LLVM
+    double visit_time = bench_time([&] {
+        auto module = Module::New("bench");
+        Visitor(module).visit(*root);
+        bench_keep(module);
+    });
+    bench_report(name + "/visitor", visit_time, input.size());
+    bench_report_items(name + "/visitor", visit_time, nodes, "nodes");
+
+    auto module = Module::New("bench");
+    Visitor(module).visit(*root);
+    std::size_t printed = 0;
+    double print_time = bench_time([&] {
+        std::ostringstream out;
+        AsmPrinter printer;
+        printer.Print(module, out);
+        printed = out.tellp();
+    });
+    bench_report(name + "/asm-printer", print_time, printed);
+    bench_report_items(name + "/asm-printer", print_time, nodes, "nodes");
+#elif TOLANG_BACKEND == PCODE
+    double visit_time = bench_time([&] {
+        PcodeModule module;
+        Visitor(module).visit(*root);
+        bench_keep(module);
+    });
+    bench_report(name + "/visitor", visit_time, input.size());
+    bench_report_items(name + "/visitor", visit_time, nodes, "nodes");
+#endif
+}
+
+BENCH_CASE("pipeline/statements") {
+    bench_pipeline("statements", {20, 20, 1000, 3, 1}, 2 << 20);
+}
+
+BENCH_CASE("pipeline/functions") {
+    bench_pipeline("functions", {2000, 5, 100, 4, 2}, 0);
+}
+
+BENCH_CASE("pipeline/deep-expressions") {
+    bench_pipeline("deep-expressions", {10, 10, 100, 10, 3}, 2 << 20);
+}
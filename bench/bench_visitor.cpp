@@ -0,0 +1,132 @@
+#include "bench.h"
+#include "corpus.h"
+#include "tolang/error.h"
+#include "tolang/flat_ast.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include "tolang/resolver.h"
+#include "tolang/visitor.h"
+#include <string>
+
+#if TOLANG_BACKEND == LLVM
+#include "llvm/ir/Module.h"
+#elif TOLANG_BACKEND == PCODE
+#include "pcode/PcodeModule.h"
+#endif
+
+// The IR that is generated is not freed with its module, so the two layouts
+// are measured in separate cases, to be run in separate processes, e.g.
+// `bench visitor/tree` and `bench visitor/flat`.
+
+static const std::pair<const char *, CorpusShape> VISITOR_SHAPES[] = {
+    {"statements", {20, 20, 1000, 3, 1}},
+    {"deep-expressions", {10, 10, 100, 10, 3}},
+    {"deeper-expressions", {10, 10, 20, 14, 4}},
+    {"many-symbols", {1000, 5000, 500, 2, 5}},
+};
+
+/**
+ * @brief Generate IR from programs of every shape in `VISITOR_SHAPES`, and
+ * report it in syntax tree nodes per second.
+ * @param flat Whether the programs are visited in the flat layout.
+ */
+static void bench_visitor(bool flat) {
+    for (const auto &[name, shape] : VISITOR_SHAPES) {
+        auto input = generate_corpus(shape, 2 << 20);
+        Lexer lexer(input.data(), input.data() + input.size());
+        auto root = Parser(lexer).parse();
+        if (DiagnosticsEngine::current().has_error()) {
+            DiagnosticsEngine::current().dump(std::cerr, *root->lines);
+            return;
+        }
+        std::size_t nodes = count_nodes(*root);
+        auto ast = flatten(*root);
+
+        // resolved before the IR the visitor leaks takes up the heap
+        double resolve_time = bench_time([&] {
+            flat ? Resolver().resolve(ast) : Resolver().resolve(*root);
+        });
+        bench_report_items(std::string(name) +
+                               (flat ? "/resolve-flat" : "/resolve-tree"),
+                           resolve_time, nodes, "nodes");
+
+        double time = bench_time([&] {
+#if TOLANG_BACKEND == LLVM
+            auto module = Module::New("bench");
+            flat ? Visitor(module).visit(ast) : Visitor(module).visit(*root);
+            bench_keep(module);
+#elif TOLANG_BACKEND == PCODE
+            PcodeModule module;
+            flat ? Visitor(module).visit(ast) : Visitor(module).visit(*root);
+            bench_keep(module);
+#endif
+        });
+        bench_report_items(std::string(name) +
+                               (flat ? "/visitor-flat" : "/visitor-tree"),
+                           time, nodes, "nodes");
+
+        if (flat) {
+            double flatten_time =
+                bench_time([&] { bench_keep(flatten(*root)); });
+            bench_report_items(std::string(name) + "/flatten", flatten_time,
+                               nodes, "nodes");
+        }
+    }
+}
+
+/**
+ * @brief Generate a program of functions with `params` parameters each, whose
+ * bodies use every parameter, with about the same number of parameter uses
+ * whatever `params` is.
+ */
+static std::string generate_params_program(int params) {
+    std::string input;
+    for (int f = 0; f < 200000 / params; f++) {
+        input += "fn f" + std::to_string(f) + "(";
+        for (int p = 0; p < params; p++) {
+            input += (p == 0 ? "p" : ", p") + std::to_string(p);
+        }
+        input += ") => p0";
+        for (int p = 1; p < params; p++) {
+            input += " + p" + std::to_string(p);
+        }
+        input += ";\n";
+    }
+    input += "var x;\nlet x = f0(";
+    for (int p = 0; p < params; p++) {
+        input += p == 0 ? "1" : ", 1";
+    }
+    input += ");\nput x;\n";
+    return input;
+}
+
+/**
+ * @brief Generate code from functions with more and more parameters, where
+ * the time per node should stay flat.
+ */
+BENCH_CASE("visitor/params") {
+    for (int params : {4, 32, 256, 2048}) {
+        auto input = generate_params_program(params);
+        Lexer lexer(input.data(), input.data() + input.size());
+        auto root = Parser(lexer).parse();
+        std::size_t nodes = count_nodes(*root);
+
+        double time = bench_time([&] {
+#if TOLANG_BACKEND == LLVM
+            auto module = Module::New("bench");
+            Visitor(module).visit(*root);
+            bench_keep(module);
+#elif TOLANG_BACKEND == PCODE
+            PcodeModule module;
+            Visitor(module).visit(*root);
+            bench_keep(module);
+#endif
+        });
+        bench_report_items("params-" + std::to_string(params) + "/visitor",
+                           time, nodes, "nodes");
+    }
+}
+
+BENCH_CASE("visitor/tree") { bench_visitor(false); }
+
+BENCH_CASE("visitor/flat") { bench_visitor(true); }
@@ -0,0 +1,226 @@
+#include "corpus.h"
+#include "tolang/utils.h"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+class CorpusGenerator {
+public:
+    CorpusGenerator(const CorpusShape &shape)
+        : _shape(shape), _random(shape.seed) {}
+
+    std::string functions() {
+        std::string out;
+        for (int i = 0; i < _shape.functions; i++) {
+            int params = 1 + _pick(3);
+            out += "fn f" + std::to_string(i) + "(";
+            std::vector<std::string> names;
+            for (int j = 0; j < params; j++) {
+                names.push_back("p" + std::to_string(j));
+                out += (j ? ", " : "") + names.back();
+            }
+            out += ") => " + _exp(_shape.depth, names) + ";\n";
+            // only defined functions can be called
+            _params.push_back(params);
+        }
+        return out;
+    }
+
+    std::string variables() {
+        std::string out;
+        for (int i = 0; i < _shape.variables; i++) {
+            out += "var v" + std::to_string(i) + ";\n";
+            _variables.push_back("v" + std::to_string(i));
+        }
+        return out;
+    }
+
+    std::string statements() {
+        std::string out;
+        int left = _shape.statements;
+        while (left > 0) {
+            left -= _stmt(out, left, 0);
+        }
+        return out;
+    }
+
+private:
+    int _pick(int n) {
+        return std::uniform_int_distribution<>(0, n - 1)(_random);
+    }
+
+    const std::string &_variable() {
+        return _variables[_pick(_variables.size())];
+    }
+
+    std::string _leaf(const std::vector<std::string> &names) {
+        if (_pick(3) == 0 || names.empty()) {
+            return _pick(2) ? std::to_string(_pick(100))
+                            : std::to_string(_pick(100)) + "." +
+                                  std::to_string(_pick(1000));
+        }
+        return names[_pick(names.size())];
+    }
+
+    std::string _exp(int depth, const std::vector<std::string> &names) {
+        if (depth == 0) {
+            return _leaf(names);
+        }
+        int kind = _pick(10);
+        if (kind == 0) {
+            return "-" + _exp(depth - 1, names);
+        }
+        if (kind <= 2 && !_params.empty()) {
+            int callee = _pick(_params.size());
+            std::string out = "f" + std::to_string(callee) + "(";
+            for (int i = 0; i < _params[callee]; i++) {
+                out += (i ? ", " : "") + _exp(depth - 1, names);
+            }
+            return out + ")";
+        }
+        static const char *OPS[] = {" + ", " - ", " * ", " / "};
+        return "(" + _exp(depth - 1, names) + OPS[_pick(4)] +
+               _exp(depth - 1, names) + ")";
+    }
+
+    std::string _cond() {
+        static const char *OPS[] = {" < ",  " > ",  " <= ",
+                                    " >= ", " == ", " != "};
+        return _exp(_shape.depth, _variables) + OPS[_pick(6)] +
+               _exp(_shape.depth, _variables);
+    }
+
+    /**
+     * @brief Append one statement, or one loop or skip block, to `out`.
+     * @return The number of statements appended.
+     */
+    int _stmt(std::string &out, int left, int nesting) {
+        std::string indent(nesting * 4, ' ');
+        int kind = _pick(10);
+
+        // a counted loop, as in fibo.tol
+        if (kind == 0 && left >= 8 && nesting < 2) {
+            auto label = std::to_string(_labels++);
+            auto &counter = _variable();
+            out += indent + "let " + counter + " = 0;\n";
+            out += indent + "tag loop" + label + ";\n";
+            out += indent + "if " + counter + " >= " +
+                   std::to_string(1 + _pick(10)) + " to done" + label + ";\n";
+            int count = 5;
+            int body = std::min(left - count, 2 + _pick(6));
+            while (body > 0) {
+                int n = _stmt(out, body, nesting + 1);
+                body -= n;
+                count += n;
+            }
+            out += indent + "    let " + counter + " = " + counter + " + 1;\n";
+            out += indent + "to loop" + label + ";\n";
+            out += indent + "tag done" + label + ";\n";
+            return count;
+        }
+
+        // a forward skip, as in newton.tol
+        if (kind == 1 && left >= 3) {
+            auto label = std::to_string(_labels++);
+            out += indent + "if " + _cond() + " to skip" + label + ";\n";
+            int count = 2;
+            int n = _stmt(out, left - count, nesting + 1);
+            out += indent + "tag skip" + label + ";\n";
+            return count + n;
+        }
+
+        if (kind <= 3) {
+            out += indent + "get " + _variable() + ";\n";
+        } else if (kind <= 5) {
+            out += indent + "put " + _exp(_shape.depth, _variables) + ";\n";
+        } else {
+            out += indent + "let " + _variable() + " = " +
+                   _exp(_shape.depth, _variables) + ";\n";
+        }
+        return 1;
+    }
+
+    CorpusShape _shape;
+    std::mt19937 _random;
+    std::vector<int> _params;
+    std::vector<std::string> _variables;
+    int _labels = 0;
+};
+
+} // namespace
+
+std::string generate_corpus(const CorpusShape &shape) {
+    return generate_corpus(shape, 0);
+}
+
+std::string generate_corpus(const CorpusShape &shape, std::size_t bytes) {
+    CorpusGenerator generator(shape);
+    std::string out = generator.functions();
+    out += "\n" + generator.variables() + "\n";
+    do {
+        out += generator.statements();
+    } while (out.size() < bytes);
+    return out;
+}
+
+static std::size_t count_exp(const Exp &exp);
+
+static std::size_t count_exp(const Exp *exp) {
+    return exp ? count_exp(*exp) : 0;
+}
+
+static std::size_t count_exp(const Exp &exp) {
+    return std::visit(
+        overloaded{
+            [](const BinaryExp &node) {
+                return 1 + count_exp(node.lhs) + count_exp(node.rhs);
+            },
+            [](const CallExp &node) {
+                std::size_t count = 2;
+                for (const auto &param : node.func_r_params) {
+                    count += count_exp(param);
+                }
+                return count;
+            },
+            [](const UnaryExp &node) { return 1 + count_exp(node.exp); },
+            [](const IdentExp &) -> std::size_t { return 2; },
+            [](const Number &) -> std::size_t { return 1; },
+        },
+        exp);
+}
+
+static std::size_t count_stmt(const Stmt &stmt) {
+    return std::visit(
+        overloaded{
+            [](const GetStmt &) -> std::size_t { return 2; },
+            [](const PutStmt &node) { return 1 + count_exp(node.exp); },
+            [](const TagStmt &) -> std::size_t { return 2; },
+            [](const LetStmt &node) { return 2 + count_exp(node.exp); },
+            [](const IfStmt &node) {
+                std::size_t count = 2;
+                if (node.cond) {
+                    count += 1 + count_exp(node.cond->lhs) +
+                             count_exp(node.cond->rhs);
+                }
+                return count;
+            },
+            [](const ToStmt &) -> std::size_t { return 2; },
+        },
+        stmt);
+}
+
+std::size_t count_nodes(const CompUnit &root) {
+    std::size_t count = 1;
+    for (const auto &func_def : root.func_defs) {
+        count += 2 + func_def->func_f_params.size() + count_exp(func_def->exp);
+    }
+    count += 2 * root.var_decls.size();
+    for (const auto &stmt : root.stmts) {
+        if (stmt) {
+            count += count_stmt(*stmt);
+        }
+    }
+    return count;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "tolang/ast.h"
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief The shape of a generated tolang program.
+ */
+struct CorpusShape {
+    // the number of `fn` definitions, each calling earlier ones
+    int functions = 20;
+    // the number of `var` declarations
+    int variables = 20;
+    // the number of statements in the main body, loops included
+    int statements = 1000;
+    // the depth of every generated expression
+    int depth = 3;
+    unsigned seed = 1;
+};
+
+/**
+ * @brief Generate a valid tolang program of the given shape.
+ *
+ * The statements mix `get`, `put` and `let` with the control flow shapes of
+ * `testcases/fibo.tol` and `testcases/newton.tol`: counted loops made of a
+ * `tag`, an `if ... to` exit and a `to` back edge, possibly nested, and forward
+ * `if ... to` skips over a few statements.
+ */
+std::string generate_corpus(const CorpusShape &shape);
+
+/**
+ * @brief Generate a program of the given shape, repeating the main body until
+ * the program is at least `bytes` long.
+ */
+std::string generate_corpus(const CorpusShape &shape, std::size_t bytes);
+
+/**
+ * @brief Count the nodes of a syntax tree, identifiers included.
+ */
+std::size_t count_nodes(const CompUnit &root);
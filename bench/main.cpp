@@ -0,0 +1,64 @@
+#include "bench.h"
+#include "corpus.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+void bench_report(const std::string &name, double seconds, std::size_t bytes) {
+    printf("%-36s %10.3f ms %10.1f MB/s\n", name.c_str(), seconds * 1e3,
+           bytes / seconds / 1e6);
+}
+
+void bench_report_items(const std::string &name, double seconds,
+                        std::size_t items, const char *unit) {
+    printf("%-36s %10.3f ms %10.2f M%s/s\n", name.c_str(), seconds * 1e3,
+           items / seconds / 1e6, unit);
+}
+
+std::string bench_temp_file(const std::string &content) {
+    char path[] = "/tmp/tolang-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        exit(1);
+    }
+    close(fd);
+
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    out << content;
+    return path;
+}
+
+int main(int argc, char *argv[]) {
+    // `bench --corpus [functions [variables [statements [depth [seed]]]]]`
+    // prints a generated program instead of running the benchmarks
+    if (argc > 1 && strcmp(argv[1], "--corpus") == 0) {
+        CorpusShape shape;
+        int *fields[] = {&shape.functions, &shape.variables, &shape.statements,
+                         &shape.depth};
+        for (int i = 2; i < argc && i - 2 < 4; i++) {
+            *fields[i - 2] = atoi(argv[i]);
+        }
+        if (argc > 6) {
+            shape.seed = atoi(argv[6]);
+        }
+        fputs(generate_corpus(shape).c_str(), stdout);
+        return 0;
+    }
+
+    for (const auto &bench : bench_cases()) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; i++) {
+            if (strstr(bench.name, argv[i]) != nullptr) {
+                selected = true;
+            }
+        }
+        if (selected) {
+            printf("== %s\n", bench.name);
+            bench.run();
+        }
+    }
+    return 0;
+}
@@ -1,13 +1,26 @@
 #include "tolang/ast.h"
+#include "tolang/ast_cache.h"
+#include "tolang/ast_printer.h"
 #include "tolang/error.h"
+#include "tolang/exp_dag.h"
+#include "tolang/flat_ast.h"
+#include "tolang/fold.h"
 #include "tolang/lexer.h"
+#include "tolang/parallel_lexer.h"
 #include "tolang/parser.h"
+#include "tolang/source.h"
 #include "tolang/visitor.h"
 #include "tolang/utils.h"
 
+#include <cctype>
+#include <cstdlib>
 #include <fstream>
+#include <functional>
 #include <getopt.h>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <sys/stat.h>
 #include <vector>
 
 #if TOLANG_BACKEND == LLVM
@@ -25,7 +38,14 @@ struct Options {
     bool emit_ast = false;
     bool emit_ir = false;
     bool emit_asm = false;
+    bool stream = false;
+    bool parallel_parse = false;
+    bool fold = true;
+    bool share_exps = false;
+    AstFormat ast_format = AstFormat::TEXT;
+    std::size_t error_limit = 0;
     std::string output;
+    std::string ast_cache;
 };
 
 void usage(const char *name) {
@@ -33,9 +53,27 @@ void usage(const char *name) {
     std::cerr << "Options:" << std::endl;
     std::cerr << "  -h, --help: Show this help message" << std::endl;
     std::cerr << "  --emit-ast: Emit AST" << std::endl;
+    std::cerr << "  --ast-format FORMAT: Emit the AST as text (default), sexp "
+                 "or json"
+              << std::endl;
     std::cerr << "  --emit-ir: Emit IR" << std::endl;
     std::cerr << "  -S, --emit-asm: Emit assembly" << std::endl;
     std::cerr << "  -o, --output: Output file" << std::endl;
+    std::cerr << "  --stream: Generate code while parsing, without keeping the "
+                 "AST"
+              << std::endl;
+    std::cerr << "  --parallel-parse: Parse function definitions on all cores"
+              << std::endl;
+    std::cerr << "  --no-fold: Do not fold constants" << std::endl;
+    std::cerr << "  --share-exps: Share identical subexpressions of each "
+                 "statement, and report the node counts"
+              << std::endl;
+    std::cerr << "  --ast-cache DIR: Reuse the AST of an unchanged input from "
+                 "DIR, and save it there otherwise"
+              << std::endl;
+    std::cerr << "  --error-limit N: Stop lexing and parsing after N errors, "
+                 "and generate no code after any error"
+              << std::endl;
 }
 
 void cmd_error(const char *name, const std::string &msg) {
@@ -45,20 +83,110 @@ void cmd_error(const char *name, const std::string &msg) {
 
 extern FILE *yyin;
 
+/**
+ * @brief Print the errors of a failed compilation, and exit.
+ */
+void compilation_failed(const char *name, const LineTable &lines) {
+    auto &diagnostics = DiagnosticsEngine::current();
+    diagnostics.dump(std::cerr, lines);
+    if (diagnostics.limit_reached()) {
+        std::cerr << name << ": stopped after " << diagnostics.error_limit()
+                  << " errors" << std::endl;
+    }
+    cmd_error(name, "compilation failed");
+}
+
+/**
+ * @brief The front end of a compilation, which feeds the program to a visitor
+ * and returns the line table of the source to report errors with.
+ */
+using FrontEnd = std::function<std::shared_ptr<LineTable>(Visitor &)>;
+
+/**
+ * @brief Parse the whole input into a tree.
+ */
+std::unique_ptr<CompUnit> parse(const Options &options, Parser &parser) {
+    return options.parallel_parse ? parser.parse_parallel() : parser.parse();
+}
+
+/**
+ * @brief Fold the constants of a tree, unless `--no-fold` is given, share
+ * its subexpressions with `--share-exps`, and generate code from it.
+ * @note With `--error-limit`, nothing is done if parsing failed.
+ */
+void fold_and_visit(const Options &options, CompUnit &root,
+                    Visitor &visitor) {
+    // with an error limit, a tree that failed to parse goes no further
+    if (options.error_limit != 0 && DiagnosticsEngine::current().has_error()) {
+        return;
+    }
+    if (options.fold) {
+        fold(root);
+    }
+    if (options.share_exps) {
+        auto stats = share_exps(root);
+        std::cerr << "expression nodes: " << stats.nodes_before
+                  << " before sharing, " << stats.nodes_after << " after"
+                  << std::endl;
+    }
+    visitor.visit(root);
+}
+
+/**
+ * @brief Parse the input and generate code from it, either from the whole
+ * tree or, with `--stream`, from each top-level node as it is parsed.
+ * @return The root of the tree, which holds no children when streaming.
+ * @note `--share-exps` works on the whole tree, so it turns `--stream` off.
+ */
+std::unique_ptr<CompUnit> parse_and_visit(const Options &options,
+                                          Parser &parser, Visitor &visitor) {
+    bool stream = options.stream && !options.share_exps;
+    if (stream && options.fold) {
+        FoldingConsumer folder(visitor);
+        return parser.parse(folder);
+    }
+    if (stream) {
+        return parser.parse(visitor);
+    }
+    auto root = parse(options, parser);
+    fold_and_visit(options, *root, visitor);
+    return root;
+}
+
+/**
+ * @brief Save the tree of a source in the AST cache, unless parsing failed.
+ * @note A failure to save is only a warning, since the compilation itself can
+ * go on.
+ */
+void store_ast(const char *name, const AstCache &cache,
+               std::string_view source, const CompUnit &root) {
+    // an invalid tree has lost the nodes that the errors were reported on, so
+    // loading it would hide the errors
+    if (DiagnosticsEngine::current().has_error()) {
+        return;
+    }
+    try {
+        cache.store(source, flatten(root));
+    } catch (const std::runtime_error &e) {
+        std::cerr << name << ": warning: " << e.what() << std::endl;
+    }
+}
+
 #if TOLANG_BACKEND == LLVM
 
 void compile(const char *name, const Options &options, const std::string &input,
-             std::unique_ptr<CompUnit> root) {
+             const FrontEnd &front_end) {
     std::ofstream outfile;
     auto output = options.output;
 
     ModulePtr module = Module::New(input);
     auto visitor = Visitor(module);
-    visitor.visit(*root);
+    visitor.memoize_exps(options.share_exps);
+    visitor.stop_on_error(options.error_limit != 0);
+    auto lines = front_end(visitor);
 
-    if (ErrorReporter::get().has_error()) {
-        ErrorReporter::get().dump(std::cerr);
-        cmd_error(name, "compilation failed");
+    if (DiagnosticsEngine::current().has_error()) {
+        compilation_failed(name, *lines);
     }
 
     if (options.emit_ir) {
@@ -90,17 +218,18 @@ void compile(const char *name, const Options &options, const std::string &input,
 #elif TOLANG_BACKEND == PCODE
 
 void compile(const char *name, const Options &options, const std::string &input,
-             std::unique_ptr<CompUnit> root) {
+             const FrontEnd &front_end) {
     std::ofstream outfile;
     auto output = options.output;
     
     Module module;
     auto visitor = Visitor(module);
-    visitor.visit(*root);
+    visitor.memoize_exps(options.share_exps);
+    visitor.stop_on_error(options.error_limit != 0);
+    auto lines = front_end(visitor);
 
-    if (ErrorReporter::get().has_error()) {
-        ErrorReporter::get().dump(std::cerr);
-        cmd_error(name, "compilation failed");
+    if (DiagnosticsEngine::current().has_error()) {
+        compilation_failed(name, *lines);
     }
 
     if (options.emit_ir || options.emit_asm) {
@@ -128,22 +257,97 @@ void compile(const char *name, const Options &options,
     std::ofstream outfile;
     auto output = options.output;
 
-    std::ifstream infile(input, std::ios::in);
+    // every stage reports the errors of this compilation here
+    DiagnosticsEngine diagnostics;
+    DiagnosticsScope diagnostics_scope(diagnostics);
+    diagnostics.set_error_limit(options.error_limit);
 
-    Lexer lexer(infile);
-    Parser parser(lexer);
-    auto root = parser.parse();
+    std::optional<AstCache> cache;
+    if (!options.ast_cache.empty()) {
+        cache.emplace(options.ast_cache);
+    }
+    // With a cache hit, the input is neither lexed nor parsed.
+    std::optional<FlatAst> cached;
+
+    // Map regular files into memory and lex them on all cores in one pass;
+    // read anything else (pipes, character devices) through a stream.
+    SourceBuffer source;
+    std::string_view text;
+    std::unique_ptr<Lexer> lexer;
+    std::unique_ptr<TokenBuffer> tokens;
+    std::unique_ptr<Parser> parser;
+    struct stat st;
+    if (stat(input.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        try {
+            source = SourceBuffer::map_file(input);
+        } catch (const std::runtime_error &e) {
+            cmd_error(name, e.what());
+        }
+        text = source.view();
+        if (cache) {
+            cached = cache->load(text);
+        }
+        if (!cached) {
+            ParallelLexer parallel_lexer(source);
+            tokens = std::make_unique<TokenBuffer>(parallel_lexer.source());
+            parallel_lexer.tokenize(*tokens);
+            parser = std::make_unique<Parser>(*tokens, parallel_lexer.names());
+        }
+    } else {
+        std::ifstream infile(input, std::ios::in);
+        if (!infile) {
+            cmd_error(name, "cannot open file " + input);
+        }
+        try {
+            lexer = std::make_unique<Lexer>(infile);
+        } catch (const std::runtime_error &e) {
+            cmd_error(name, e.what());
+        }
+        text = lexer->source();
+        if (cache) {
+            cached = cache->load(text);
+        }
+        parser = std::make_unique<Parser>(*lexer);
+    }
 
     if (options.emit_ast) {
+        std::unique_ptr<CompUnit> root;
+        if (cached) {
+            root = unflatten(*cached);
+        } else {
+            root = parse(options, *parser);
+            if (cache) {
+                store_ast(name, *cache, text, *root);
+            }
+        }
         if (output.length() == 0) {
             output = "out.ast";
         }
         outfile.open(output, std::ios::out);
-        root->print(outfile);
+        AstPrinter(outfile, options.ast_format).print(*root);
         return;
     }
 
-    compile(name, options, input, std::move(root));
+    compile(name, options, input, [&](Visitor &visitor) {
+        if (cached && (options.fold || options.share_exps)) {
+            // the cache holds the tree as parsed, which is folded as a tree
+            auto root = unflatten(*cached);
+            fold_and_visit(options, *root, visitor);
+            return root->lines;
+        }
+        if (cached) {
+            visitor.visit(*cached);
+            return cached->lines;
+        }
+        if (!cache) {
+            return parse_and_visit(options, *parser, visitor)->lines;
+        }
+        // the tree has to be kept to be saved, so the input is not streamed
+        auto root = parse(options, *parser);
+        store_ast(name, *cache, text, *root);
+        fold_and_visit(options, *root, visitor);
+        return root->lines;
+    });
 }
 
 int main(int argc, char *argv[]) {
@@ -153,6 +357,13 @@ int main(int argc, char *argv[]) {
         EMIT_AST,
         EMIT_ASM,
         OUTPUT,
+        STREAM,
+        AST_CACHE,
+        PARALLEL_PARSE,
+        NO_FOLD,
+        SHARE_EXPS,
+        AST_FORMAT,
+        ERROR_LIMIT,
     };
     const struct option long_options[] = {
         {"help", no_argument, 0, HELP},
@@ -160,6 +371,13 @@ int main(int argc, char *argv[]) {
         {"emit-ir", no_argument, 0, EMIT_IR},
         {"emit-asm", no_argument, 0, EMIT_ASM},
         {"output", required_argument, 0, OUTPUT},
+        {"stream", no_argument, 0, STREAM},
+        {"ast-cache", required_argument, 0, AST_CACHE},
+        {"parallel-parse", no_argument, 0, PARALLEL_PARSE},
+        {"no-fold", no_argument, 0, NO_FOLD},
+        {"share-exps", no_argument, 0, SHARE_EXPS},
+        {"ast-format", required_argument, 0, AST_FORMAT},
+        {"error-limit", required_argument, 0, ERROR_LIMIT},
         {0, 0, 0, 0}};
 
     Options options;
@@ -186,6 +404,41 @@ int main(int argc, char *argv[]) {
         case OUTPUT:
             options.output = optarg;
             break;
+        case STREAM:
+            options.stream = true;
+            break;
+        case PARALLEL_PARSE:
+            options.parallel_parse = true;
+            break;
+        case NO_FOLD:
+            options.fold = false;
+            break;
+        case SHARE_EXPS:
+            options.share_exps = true;
+            break;
+        case AST_CACHE:
+            options.ast_cache = optarg;
+            break;
+        case AST_FORMAT:
+            if (optarg == std::string("text")) {
+                options.ast_format = AstFormat::TEXT;
+            } else if (optarg == std::string("sexp")) {
+                options.ast_format = AstFormat::SEXP;
+            } else if (optarg == std::string("json")) {
+                options.ast_format = AstFormat::JSON;
+            } else {
+                cmd_error(argv[0], "unknown AST format " + std::string(optarg));
+            }
+            break;
+        case ERROR_LIMIT: {
+            char *end;
+            options.error_limit = std::strtoul(optarg, &end, 10);
+            if (!isdigit(*optarg) || *end != '\0') {
+                cmd_error(argv[0],
+                          "invalid error limit " + std::string(optarg));
+            }
+            break;
+        }
         case '?':
             cmd_error(argv[0], "unknown option");
             return 1;
@@ -14,6 +14,10 @@
 #include "llvm/ir/value/inst/Instructions.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
 
 void Value::PrintAsm(AsmWriterPtr out) {
     TOLANG_DIE("Operation not supported.");
@@ -37,7 +41,19 @@ void ConstantData::PrintAsm(AsmWriterPtr out) {
 
 void ConstantData::PrintName(AsmWriterPtr out) {
     if (GetType()->IsFloatTy()) {
-        out->Push(std::to_string(_floatValue));
+        // LLVM rejects a decimal that is not exactly a float, so such values
+        // are printed as the hex bits of the equal double
+        std::string text = std::to_string(_floatValue);
+        if (std::stod(text) != static_cast<double>(_floatValue)) {
+            double value = _floatValue;
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            char hex[24];
+            std::snprintf(hex, sizeof(hex), "0x%016llX",
+                          static_cast<unsigned long long>(bits));
+            text = hex;
+        }
+        out->Push(text);
     } else if (GetType()->IsIntegerTy()) {
         out->Push(std::to_string(_intValue));
     } else {
@@ -112,10 +128,10 @@ void BasicBlock::PrintAsm(AsmWriterPtr out) {
             std::vector<int> preds;
             for (auto it = this->UserBegin(); it != UserEnd(); ++it) {
                 // The user MUST be a BranchInst or JumpInst.
-                auto user =
-                    dynamic_cast<HasParent<BasicBlock> *>((*it)->GetUser());
-                TOLANG_ASSERT(user);
-                preds.push_back(tracker->Slot(user->Parent()));
+                auto user = (*it)->GetUser();
+                TOLANG_ASSERT(user->Is<BranchInst>() || user->Is<JumpInst>());
+                preds.push_back(
+                    tracker->Slot(user->As<Instruction>()->Parent()));
             }
             std::sort(preds.begin(), preds.end(), std::less<int>());
             for (auto it = preds.begin(); it != preds.end(); ++it) {
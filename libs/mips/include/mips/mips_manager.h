@@ -39,6 +39,8 @@ private:
     int currentOffset = 0;
 
     std::unordered_map<ValuePtr, MipsRegPtr> occupation;
+    // 已翻译的使用次数，值的最后一次使用之后才能释放其寄存器
+    std::unordered_map<ValuePtr, std::size_t> translatedUses;
     std::unordered_map<BasicBlockPtr, std::string *> blockNames;
 
     int tmpCount = 0;
@@ -212,8 +212,15 @@ MipsRegPtr MipsManager::loadConst(ValuePtr valuePtr, MipsRegType type) {
 void MipsManager::tryRelease(UserPtr userPtr) {
     for (UsePtr use : *(userPtr->GetUseList())) {
         // TODO:完善寄存器的释放逻辑判断（基本块流图和活跃变量分析）
-        if (!use->GetValue()->GetType()->IsPointerTy()) {
-            release(use->GetValue());
+        auto valuePtr = use->GetValue();
+        if (valuePtr->GetType()->IsPointerTy()) {
+            continue;
+        }
+        // a value may be used by several instructions, so its register is
+        // only released after the last of them
+        if (++translatedUses[valuePtr] >= valuePtr->GetUserList()->size()) {
+            translatedUses.erase(valuePtr);
+            release(valuePtr);
         }
     }
 }
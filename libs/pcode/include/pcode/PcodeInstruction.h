@@ -49,6 +49,13 @@ public:
     PcodeInstruction(PcodeInstructionType type) : _type(type) {}
 
     PcodeInstructionType getType() const { return _type; }
+
+    // Check if the instruction is of a specific kind, by the `classof` of the
+    // kind, like `Value::Is` in the IR. No RTTI is needed.
+    template<typename T> bool is() const { return T::classof(_type); }
+
+    // Cast the instruction to a specific kind, which must be checked first.
+    template<typename T> T *as() { return static_cast<T *>(this); }
     
     virtual void print(std::ostream &out) const = 0;
 
@@ -13,6 +13,10 @@ private:
 public:
     PcodeDefineInst(PcodeVarPtr &var):
         PcodeInstruction(PcodeInstruction::DEF), _var(var) {}
+
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::DEF;
+    }
     
     void print(std::ostream &out) const override {
         out << "DEF\t\t" << _var->getName() << std::endl;
@@ -27,6 +31,10 @@ public:
     PcodeArgumentInst(int index) : 
         PcodeInstruction(PcodeInstruction::ARG), _index(index) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::ARG;
+    }
+
     int getIndex() const { return _index; }
 
     void print(std::ostream &out) const override {
@@ -42,6 +50,10 @@ public:
     PcodeLoadImmediateInst(float imm) :
         PcodeInstruction(PcodeInstruction::LI), _imm(imm) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::LI;
+    }
+
     float getImm() const { return _imm; }
 
     void print(std::ostream &out) const override {
@@ -63,6 +75,10 @@ public:
     PcodeOperationInst(OperationType op) :
         PcodeInstruction(PcodeInstruction::OPR), _op(op) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::OPR;
+    }
+
     OperationType getOp() const { return _op; }
 
     void print(std::ostream &out) const override { 
@@ -94,6 +110,10 @@ public:
     PcodeLoadInst(PcodeVarPtr & var) : 
         PcodeInstruction(PcodeInstruction::LOAD), _var(var) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::LOAD;
+    }
+
     PcodeVarPtr &getVar() { return _var; }
 
     void print(std::ostream &out) const override {
@@ -109,6 +129,10 @@ public:
     PcodeStoreInst(PcodeVarPtr &var):
         PcodeInstruction(PcodeInstruction::STORE), _var(var) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::STORE;
+    }
+
     PcodeVarPtr &getVar() { return _var; }
 
     void print(std::ostream &out) const override {
@@ -123,6 +147,10 @@ private:
 public:
     PcodeCallInst(PcodeFuncPtr &fn) : 
         PcodeInstruction(PcodeInstruction::CALL), _fn(fn) {}
+
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::CALL;
+    }
     
     PcodeFuncPtr &getFn() { return _fn; }
 
@@ -135,6 +163,10 @@ class PcodeReturnInst : public PcodeInstruction {
 public:
     PcodeReturnInst() : PcodeInstruction(PcodeInstruction::RET) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::RET;
+    }
+
     void print(std::ostream &out) const override {
         out << "RET" << std::endl;
     }
@@ -148,6 +180,10 @@ public:
     PcodeJumpIfTrueInst(const std::string &label) :
         PcodeInstruction(PcodeInstruction::JIT), _label(label) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::JIT;
+    }
+
     const std::string &getLabel() const { return _label; }
 
     void print(std::ostream &out) const override {
@@ -163,6 +199,10 @@ public:
     PcodeJumpInst(const std::string &label) :
         PcodeInstruction(PcodeInstruction::JUMP), _label(label) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::JUMP;
+    }
+
     const std::string &getLabel() const { return _label; }
 
     void print(std::ostream &out) const override {
@@ -174,6 +214,10 @@ class PcodeReadInst : public PcodeInstruction {
 public:
     PcodeReadInst() : PcodeInstruction(PcodeInstruction::READ) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::READ;
+    }
+
     void print(std::ostream &out) const override {
         out << "READ" << std::endl;
     }
@@ -183,6 +227,10 @@ class PcodeWriteInst : public PcodeInstruction {
 public:
     PcodeWriteInst() : PcodeInstruction(PcodeInstruction::WRITE) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::WRITE;
+    }
+
     void print(std::ostream &out) const override {
         out << "WRITE" << std::endl;
     }
@@ -196,6 +244,10 @@ public:
     PcodeLabelInst(const std::string &label) :
         PcodeInstruction(PcodeInstruction::LABEL), _label(label) {}
 
+    static bool classof(PcodeInstructionType type) {
+        return type == PcodeInstruction::LABEL;
+    }
+
     const std::string &getLabel() const { return _label; }
 
     void print(std::ostream &out) const override {
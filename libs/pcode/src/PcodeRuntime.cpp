@@ -13,7 +13,7 @@ void PcodeRuntime::run() {
             if (inst->getType() == PcodeInstruction::JIT) {
                 auto &ar = _ars.top();
                 if (::fabs(ar.popTmp() - 1) < eps) {
-                    auto jit = std::dynamic_pointer_cast<PcodeJumpIfTrueInst>(inst);
+                    auto jit = inst->as<PcodeJumpIfTrueInst>();
                     _currentBlock = _module.getLabel((jit->getLabel()));
                     flag = true;
                     break;
@@ -21,7 +21,7 @@ void PcodeRuntime::run() {
                     continue;
                 }
             } else if (inst->getType() == PcodeInstruction::JUMP) {
-                auto jump = std::dynamic_pointer_cast<PcodeJumpInst>(inst);
+                auto jump = inst->as<PcodeJumpInst>();
                 _currentBlock = _module.getLabel((jump->getLabel()));
                 flag = true;
                 break;
@@ -69,19 +69,19 @@ void PcodeRuntime::excuteInst(const PcodeInstPtr &inst) {
 
 void PcodeRuntime::executeArg(const PcodeInstPtr &inst) {
     auto &ar = _ars.top();
-    auto arg = std::dynamic_pointer_cast<PcodeArgumentInst>(inst);
+    auto arg = inst->as<PcodeArgumentInst>();
     ar.pushTmp(ar.getNthArg(arg->getIndex()));
 }
 
 void PcodeRuntime::executeLi(const PcodeInstPtr &inst) {
     auto &ar = _ars.top();
-    auto li = std::dynamic_pointer_cast<PcodeLoadImmediateInst>(inst);
+    auto li = inst->as<PcodeLoadImmediateInst>();
     ar.pushTmp(li->getImm());
 }
 
 void PcodeRuntime::executeOpr(const PcodeInstPtr &inst) {
     auto &ar = _ars.top();
-    auto opr = std::dynamic_pointer_cast<PcodeOperationInst>(inst);
+    auto opr = inst->as<PcodeOperationInst>();
     auto op = opr->getOp();
     // Only negative operation needs one operand
     if (op == PcodeOperationInst::NEG) {
@@ -119,19 +119,19 @@ void PcodeRuntime::executeOpr(const PcodeInstPtr &inst) {
 
 void PcodeRuntime::executeLoad(const PcodeInstPtr &inst) {
     auto &ar = _ars.top();
-    auto &var = std::dynamic_pointer_cast<PcodeLoadInst>(inst)->getVar();
+    auto &var = inst->as<PcodeLoadInst>()->getVar();
     ar.pushTmp(var->getValue());
 }
 
 void PcodeRuntime::executeStore(const PcodeInstPtr &inst) {
     auto &ar = _ars.top();
-    auto &var = std::dynamic_pointer_cast<PcodeStoreInst>(inst)->getVar();
+    auto &var = inst->as<PcodeStoreInst>()->getVar();
     var->setValue(ar.popTmp());
 }
 
 void PcodeRuntime::executeCall(const PcodeInstPtr &inst) {
     auto &prevAr = _ars.top();
-    auto call = std::dynamic_pointer_cast<PcodeCallInst>(inst);
+    auto call = inst->as<PcodeCallInst>();
     
     // Parameter counter of the function 
     auto cnt = call->getFn()->getParamCounter();
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A fixed-size array allocated in an `Arena`.
+ * @note The array does not own its items, the arena does.
+ */
+template <typename T> struct ArenaArray {
+    T *items = nullptr;
+    std::size_t count = 0;
+
+    T *begin() const { return items; }
+    T *end() const { return items + count; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T &operator[](std::size_t i) const { return items[i]; }
+};
+
+/**
+ * @brief `Arena` is a bump-pointer allocator. Objects are carved out of large
+ * blocks one after another, and are all released together when the arena is
+ * destroyed.
+ * @note Destructors of the objects are never run, so only trivially
+ * destructible objects may be allocated, which the arena checks at compile
+ * time.
+ */
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Allocate uninitialized memory.
+     * @param size The size of the memory in bytes.
+     * @param align The alignment of the memory, a power of two.
+     */
+    void *allocate(std::size_t size, std::size_t align) {
+        // compare the room left in the block, so that no pointer is formed
+        // past its end
+        std::size_t padding = _cur != nullptr ? _padding(_cur, align) : 0;
+        std::size_t room = _end - _cur;
+        if (_cur == nullptr || padding > room || size > room - padding) {
+            _grow(size + align);
+            padding = _padding(_cur, align);
+        }
+        char *ptr = _cur + padding;
+        _cur = ptr + size;
+        return ptr;
+    }
+
+    /**
+     * @brief Construct an object in the arena.
+     * @return The object, which lives as long as the arena.
+     */
+    template <typename T, typename... Args> T *make(Args &&...args) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T)))
+            T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Copy the items `[first, last)` into an array in the arena.
+     */
+    template <typename It> auto make_array(It first, It last) {
+        using T = typename std::iterator_traits<It>::value_type;
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "arena objects are never destroyed");
+        ArenaArray<T> array;
+        array.count = std::distance(first, last);
+        if (array.count != 0) {
+            array.items = static_cast<T *>(
+                allocate(sizeof(T) * array.count, alignof(T)));
+            std::uninitialized_copy(first, last, array.items);
+        }
+        return array;
+    }
+
+    /**
+     * @brief Release all objects at once. Only the largest block is kept, to
+     * be reused by the following allocations.
+     */
+    void reset() {
+        if (_blocks.empty()) {
+            return;
+        }
+        auto largest = std::max_element(
+            _blocks.begin(), _blocks.end(),
+            [](const auto &a, const auto &b) { return a.size < b.size; });
+        if (_blocks.size() > 1) {
+            auto block = std::move(*largest);
+            _blocks.clear();
+            _blocks.push_back(std::move(block));
+        }
+        _cur = _blocks.back().data.get();
+        _end = _cur + _blocks.back().size;
+        _reserved = _blocks.back().size;
+    }
+
+    /**
+     * @brief Take over the blocks of `other`, so that the objects allocated in
+     * it live as long as this arena. `other` is left empty.
+     */
+    void adopt(Arena &other) {
+        if (_blocks.empty()) {
+            std::swap(_blocks, other._blocks);
+            std::swap(_block_size, other._block_size);
+            std::swap(_reserved, other._reserved);
+            std::swap(_cur, other._cur);
+            std::swap(_end, other._end);
+            return;
+        }
+        _blocks.insert(_blocks.end(),
+                       std::make_move_iterator(other._blocks.begin()),
+                       std::make_move_iterator(other._blocks.end()));
+        _reserved += other._reserved;
+        other._blocks.clear();
+        other._block_size = 0;
+        other._reserved = 0;
+        other._cur = nullptr;
+        other._end = nullptr;
+    }
+
+    /**
+     * @brief Get the number of bytes reserved from the system.
+     */
+    std::size_t reserved() const { return _reserved; }
+
+private:
+    // The first block is small, so that tiny programs stay cheap, and every
+    // block is twice as large as the one before, so that a large tree needs
+    // few blocks.
+    static constexpr std::size_t FIRST_BLOCK_SIZE = 4096;
+    static constexpr std::size_t MAX_BLOCK_SIZE = 64 << 20;
+
+    // The number of bytes to skip from `ptr` to the next multiple of `align`.
+    static std::size_t _padding(const char *ptr, std::size_t align) {
+        auto address = reinterpret_cast<uintptr_t>(ptr);
+        return (align - address % align) % align;
+    }
+
+    void _grow(std::size_t min_size) {
+        std::size_t size = _blocks.empty()
+                               ? FIRST_BLOCK_SIZE
+                               : std::min(_block_size * 2, MAX_BLOCK_SIZE);
+        _block_size = size;
+        size = std::max(size, min_size);
+        _blocks.push_back({std::unique_ptr<char[]>(new char[size]), size});
+        _cur = _blocks.back().data.get();
+        _end = _cur + size;
+        _reserved += size;
+    }
+
+    struct _Block {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    std::vector<_Block> _blocks;
+    std::size_t _block_size = 0;
+    std::size_t _reserved = 0;
+    char *_cur = nullptr;
+    char *_end = nullptr;
+};
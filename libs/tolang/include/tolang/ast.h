@@ -1,16 +1,21 @@
 #pragma once
 
+#include "arena.h"
+#include "name_table.h"
+#include "source_loc.h"
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 struct Node {
-    int lineno;
+    SourceLoc loc;
 
     Node() = default;
-    Node(int lineno) : lineno(lineno) {}
+    Node(SourceLoc loc) : loc(loc) {}
     virtual void print(std::ostream &out) = 0;
 };
 
@@ -32,58 +37,103 @@ using Exp = std::variant<BinaryExp, CallExp, UnaryExp, IdentExp, Number>;
 struct FuncDef;
 struct VarDecl;
 
+/**
+ * @brief The slot of an identifier that is not bound to any symbol.
+ */
+constexpr uint32_t NO_SLOT = UINT32_MAX;
+
 struct Ident : public Node {
-    std::string value;
+    // The interned name, whose `value` is stored in the `NameTable` of the
+    // `CompUnit`.
+    NameId id;
+    std::string_view value;
+    // The symbol the identifier names, which is set by `Resolver`.
+    uint32_t slot = NO_SLOT;
 
     void print(std::ostream &out) override;
 
     Ident() = default;
-    Ident(int lineno, const std::string &value) : Node(lineno), value(value) {}
+    Ident(SourceLoc loc, NameId id, std::string_view value)
+        : Node(loc), id(id), value(value) {}
 };
 
 struct CompUnit : public Node {
-    std::vector<std::unique_ptr<FuncDef>> func_defs;
-    std::vector<std::unique_ptr<VarDecl>> var_decls;
-    std::vector<std::unique_ptr<Stmt>> stmts;
+    // All other nodes of the tree live in the arena, and are freed with it.
+    Arena arena;
+
+    std::vector<FuncDef *> func_defs;
+    std::vector<VarDecl *> var_decls;
+    std::vector<Stmt *> stmts;
+
+    // The names of all identifiers in the tree.
+    NameTablePtr names;
+    // The line table of the source, to turn the locations of nodes into lines
+    // and columns.
+    std::shared_ptr<LineTable> lines = std::make_shared<LineTable>();
 
     void print(std::ostream &out) override;
 };
 
+/**
+ * @brief `AstConsumer` receives the top-level nodes of a tree one at a time,
+ * in source order, as soon as the parser has finished them.
+ * @note A node is freed once the call that receives it returns, so neither
+ * the node nor its children may be kept.
+ */
+class AstConsumer {
+public:
+    virtual ~AstConsumer() = default;
+
+    /**
+     * @brief Called once before any node.
+     * @param root The root of the tree, which never has any children.
+     */
+    virtual void begin(const CompUnit &root) = 0;
+    virtual void func_def(const FuncDef &node) = 0;
+    virtual void var_decl(const VarDecl &node) = 0;
+    virtual void stmt(const Stmt &node) = 0;
+
+    /**
+     * @brief Called once after the last node.
+     */
+    virtual void end() = 0;
+};
+
 struct FuncDef : public Node {
-    std::unique_ptr<Ident> ident;
-    std::vector<std::unique_ptr<Ident>> func_f_params;
-    std::unique_ptr<Exp> exp;
+    Ident *ident = nullptr;
+    ArenaArray<Ident *> func_f_params;
+    Exp *exp = nullptr;
 
     void print(std::ostream &out) override;
 };
 
 struct VarDecl : public Node {
-    std::unique_ptr<Ident> ident;
+    Ident *ident = nullptr;
 
     void print(std::ostream &out) override;
 };
 
 struct GetStmt : public Node {
-    std::unique_ptr<Ident> ident;
+    Ident *ident = nullptr;
 
     void print(std::ostream &out) override;
 };
 
 struct PutStmt : public Node {
-    std::unique_ptr<Exp> exp;
+    Exp *exp = nullptr;
 
     void print(std::ostream &out) override;
 };
 
 struct TagStmt : public Node {
-    std::unique_ptr<Ident> ident;
+    Ident *ident = nullptr;
 
     void print(std::ostream &out) override;
 };
 
 struct LetStmt : public Node {
-    std::unique_ptr<Ident> ident;
-    std::unique_ptr<Exp> exp;
+    Ident *ident = nullptr;
+    Exp *exp = nullptr;
 
     void print(std::ostream &out) override;
 };
@@ -91,20 +141,20 @@ struct LetStmt : public Node {
 struct Cond;
 
 struct IfStmt : public Node {
-    std::unique_ptr<Cond> cond;
-    std::unique_ptr<Ident> ident;
+    Cond *cond = nullptr;
+    Ident *ident = nullptr;
 
     void print(std::ostream &out) override;
 };
 
 struct ToStmt : public Node {
-    std::unique_ptr<Ident> ident;
+    Ident *ident = nullptr;
 
     void print(std::ostream &out) override;
 };
 
 struct BinaryExp : public Node {
-    std::unique_ptr<Exp> lhs;
+    Exp *lhs = nullptr;
     enum BinaryOp {
         PLUS,
         MINU,
@@ -112,19 +162,19 @@ struct BinaryExp : public Node {
         DIV,
         MOD,
     } op;
-    std::unique_ptr<Exp> rhs;
+    Exp *rhs = nullptr;
 
     BinaryExp() = default;
 
-    BinaryExp(BinaryOp op, std::unique_ptr<Exp> lhs, std::unique_ptr<Exp> rhs)
-        : lhs(std::move(lhs)), op(op), rhs(std::move(rhs)) {}
+    BinaryExp(BinaryOp op, Exp *lhs, Exp *rhs)
+        : lhs(lhs), op(op), rhs(rhs) {}
 
     void print(std::ostream &out) override;
 };
 
 struct CallExp : public Node {
-    std::unique_ptr<Ident> ident;
-    std::vector<std::unique_ptr<Exp>> func_r_params;
+    Ident *ident = nullptr;
+    ArenaArray<Exp *> func_r_params;
 
     void print(std::ostream &out) override;
 };
@@ -134,18 +184,18 @@ struct UnaryExp : public Node {
         PLUS,
         MINU,
     } op;
-    std::unique_ptr<Exp> exp;
+    Exp *exp = nullptr;
     void print(std::ostream &out) override;
 };
 
 struct IdentExp : public Node {
-    std::unique_ptr<Ident> ident;
+    Ident *ident = nullptr;
 
     void print(std::ostream &out) override;
 };
 
 struct Cond : public Node {
-    std::unique_ptr<Exp> lhs;
+    Exp *lhs = nullptr;
     enum {
         LT,
         GT,
@@ -154,7 +204,7 @@ struct Cond : public Node {
         EQ,
         NE,
     } op;
-    std::unique_ptr<Exp> rhs;
+    Exp *rhs = nullptr;
 
     void print(std::ostream &out) override;
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "flat_ast.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Hash the content of a source file, to find its entry in an
+ * `AstCache`.
+ * @note The hash reads 8 bytes at a time, so that it costs much less than
+ * lexing the source.
+ */
+uint64_t hash_source(std::string_view source);
+
+/**
+ * @brief `AstCache` saves the flat trees of parsed sources in a directory,
+ * keyed by the hash of the source, so that an unchanged file does not have to
+ * be lexed and parsed again.
+ * @note Each entry is a binary image of the arrays of a `FlatAst`, plus the
+ * source itself and the names of the identifiers. An entry is only used for
+ * the very source it was written for, and an entry written by another version
+ * of the format, or one whose tree is not well-formed, is ignored.
+ */
+class AstCache {
+public:
+    /**
+     * @brief Construct a cache in `dir`, which is created on the first
+     * `store`.
+     */
+    explicit AstCache(std::string dir) : _dir(std::move(dir)) {}
+
+    /**
+     * @brief Get the path of the entry of a source.
+     */
+    std::string path(std::string_view source) const;
+
+    /**
+     * @brief Load the tree of a source.
+     * @param source The content of the source.
+     * @return The tree, or `std::nullopt` if there is no entry for the source
+     * or the entry is stale or corrupt. The indices of a loaded tree are all
+     * in bounds or `FLAT_NONE`.
+     */
+    std::optional<FlatAst> load(std::string_view source) const;
+
+    /**
+     * @brief Save the tree of a source.
+     * @param source The content of the source.
+     * @param ast The tree of the source, which should be valid.
+     * @note The entry is written to a temporary file and renamed, so that a
+     * concurrent `load` never sees half of it. Throw `std::runtime_error` if
+     * the entry cannot be written.
+     */
+    void store(std::string_view source, const FlatAst &ast) const;
+
+private:
+    std::string _path(uint64_t hash) const;
+
+    std::string _dir;
+};
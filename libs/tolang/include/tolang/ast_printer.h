@@ -0,0 +1,108 @@
+#pragma once
+
+#include "ast.h"
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief The formats an `AstPrinter` can write a tree in.
+ */
+enum class AstFormat {
+    // The tokens and grammar symbols printed by `Node::print`.
+    TEXT,
+    // One S-expression per top-level node, such as `(let x (+ y 1))`.
+    SEXP,
+    // One JSON object per top-level node, in the JSON Lines format. Top-level
+    // objects carry the line of the node.
+    JSON,
+};
+
+/**
+ * @brief `AstPrinter` writes a tree to a stream without the virtual
+ * `Node::print`. The nodes are rendered into a buffer, which is written to the
+ * stream in large blocks.
+ * @note Like `Node::print`, the printer writes the function definitions, then
+ * the variable declarations, then the statements. In the `TEXT` format the
+ * output is the same as that of `Node::print`. Missing nodes of an invalid
+ * tree are skipped in `TEXT`, and written as `()` in `SEXP` and as `null` in
+ * `JSON`.
+ */
+class AstPrinter {
+public:
+    // The size of the buffer that is written to the stream at once.
+    static constexpr std::size_t FLUSH_SIZE = 1 << 16;
+
+    explicit AstPrinter(std::ostream &out, AstFormat format = AstFormat::TEXT);
+    ~AstPrinter() { flush(); }
+
+    AstPrinter(const AstPrinter &) = delete;
+    AstPrinter &operator=(const AstPrinter &) = delete;
+
+    /**
+     * @brief Print a tree.
+     * @note The end of the output may stay in the buffer until `flush` is
+     * called or the printer is destroyed.
+     */
+    void print(const CompUnit &root);
+
+    /**
+     * @brief Write the buffered output to the stream.
+     */
+    void flush();
+
+private:
+    void _put(std::string_view text) { _buffer.append(text); }
+    void _put(char c) { _buffer.push_back(c); }
+    void _put_number(float value);
+    // Flush the buffer if it is full, between two top-level nodes.
+    void _end_node();
+
+    /**
+     * @brief Print an expression in the format of the printer.
+     */
+    void _exp(const Exp *root);
+    // Push an expression, or the text of a missing one, onto `_items`.
+    void _push(const Exp *exp);
+    void _push(std::string_view text) { _items.push_back({nullptr, text}); }
+    // Return the first operand of a node, or push the text of a missing one.
+    const Exp *_first(const Exp *exp);
+
+    void _text(const Ident *ident);
+    void _text(const FuncDef &node);
+    void _text(const VarDecl &node);
+    void _text(const Stmt &node);
+    void _text(const Cond &node);
+    const Exp *_text(const Exp &exp);
+
+    void _sexp(const Ident *ident);
+    void _sexp(const FuncDef &node);
+    void _sexp(const VarDecl &node);
+    void _sexp(const Stmt &node);
+    void _sexp(const Cond &node);
+    const Exp *_sexp(const Exp &exp);
+
+    void _json_line(SourceLoc loc);
+    void _json(const Ident *ident);
+    void _json(const FuncDef &node);
+    void _json(const VarDecl &node);
+    void _json(const Stmt &node);
+    void _json(const Cond &node);
+    const Exp *_json(const Exp &exp);
+
+    std::ostream &_out;
+    AstFormat _format;
+    // The line table of the tree being printed, for the lines in `JSON`.
+    const LineTable *_lines = nullptr;
+    std::string _buffer;
+
+    // The explicit stack of `_exp`: an expression to print, or the text to
+    // put if `exp` is `nullptr`. It is kept to reuse its storage.
+    struct _Item {
+        const Exp *exp;
+        std::string_view text;
+    };
+    std::vector<_Item> _items;
+};
@@ -1,45 +1,87 @@
 #pragma once
 
-#include <algorithm>
+#include "source_loc.h"
+#include <cstddef>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 struct Error {
-    int lineno;
+    SourceLoc loc;
     std::string msg;
 };
 
 /**
- * @brief `ErrorReporter` is a singleton class that collects error messages
- * during parsing and prints them out at the end.
+ * @brief `DiagnosticsEngine` collects the error messages of one compilation
+ * and prints them out at the end.
+ *
+ * Errors are reported to the engine installed on the reporting thread by a
+ * `DiagnosticsScope`, so that each compilation, and each worker thread of a
+ * parallel stage, fills a buffer of its own. A stage that runs on several
+ * threads gives every thread its own engine, and merges them into the engine
+ * of the calling thread after joining, in an order that does not depend on
+ * the scheduling.
+ *
+ * An engine may be given an error limit, after which it drops further errors
+ * and the lexer and the parser stop as if the input ended, so that a bad input
+ * fails fast instead of reporting every error it holds.
+ *
+ * @note An engine is not synchronized: it is only used by one thread at a
+ * time.
  */
-class ErrorReporter {
+class DiagnosticsEngine {
 public:
+    DiagnosticsEngine() = default;
+    DiagnosticsEngine(const DiagnosticsEngine &) = delete;
+    DiagnosticsEngine &operator=(const DiagnosticsEngine &) = delete;
+    DiagnosticsEngine(DiagnosticsEngine &&) = default;
+    DiagnosticsEngine &operator=(DiagnosticsEngine &&) = default;
+
     /**
-     * @brief Get the singleton instance of `ErrorReporter`.
+     * @brief Get the engine of the calling thread, which is the one of the
+     * innermost `DiagnosticsScope`, or a default engine of the thread if there
+     * is no scope.
      */
-    static ErrorReporter &get() {
-        static ErrorReporter instance;
-        return instance;
-    }
+    static DiagnosticsEngine &current();
 
     /**
-     * @brief Report an error message.
-     * @param lineno The line number where the error occurred.
+     * @brief Report an error message to the engine of the calling thread.
+     * @param loc The location where the error occurred.
      * @param msg The error message.
      */
-    static void error(int lineno, const std::string msg) {
-        get().report_error(lineno, msg);
+    static void error(SourceLoc loc, std::string msg) {
+        current().report_error(loc, std::move(msg));
     }
 
     /**
      * @brief Report an error message.
-     * @param lineno The line number where the error occurred.
+     * @param loc The location where the error occurred.
      * @param msg The error message.
      */
-    void report_error(int lineno, const std::string msg) {
-        _errors.push_back({lineno, msg});
+    void report_error(SourceLoc loc, std::string msg) {
+        if (!limit_reached()) {
+            _errors.push_back({loc, std::move(msg)});
+        }
+    }
+
+    /**
+     * @brief Keep at most `limit` error messages, or all of them if `limit` is
+     * 0, which is the default.
+     */
+    void set_error_limit(std::size_t limit) { _error_limit = limit; }
+
+    /**
+     * @brief Get the error limit, 0 if there is none.
+     */
+    std::size_t error_limit() const { return _error_limit; }
+
+    /**
+     * @brief Check if the error limit is reached, after which no more error
+     * messages are kept and the stages reporting them should stop.
+     */
+    bool limit_reached() const {
+        return _error_limit != 0 && _errors.size() >= _error_limit;
     }
 
     /**
@@ -48,25 +90,51 @@ public:
      */
     bool has_error() const { return !_errors.empty(); }
 
+    /**
+     * @brief Get the error messages, in the order they were reported.
+     */
+    const std::vector<Error> &errors() const { return _errors; }
+
+    /**
+     * @brief Move the error messages of another engine to the end of this one,
+     * up to the error limit of this one.
+     */
+    void merge(DiagnosticsEngine &other);
+
+    /**
+     * @brief Forget all error messages, to reuse the engine for another
+     * compilation.
+     */
+    void clear() { _errors.clear(); }
+
     /**
      * @brief Dump all error messages to the given output stream.
      * @param out The output stream.
-     * @note The error messages are sorted by line number before being printed.
+     * @param lines The line table of the source, which turns the locations of
+     * the errors into `line:column` prefixes.
+     * @note The error messages are sorted by location before being printed.
+     * The sort is stable, so errors at the same location keep the order in
+     * which they were reported and merged.
      */
-    void dump(std::ostream &out) {
-        std::sort(
-            _errors.begin(), _errors.end(),
-            [](const Error &a, const Error &b) { return a.lineno < b.lineno; });
-
-        for (const auto &err : _errors) {
-            out << err.lineno << ": " << err.msg << std::endl;
-        }
-    }
+    void dump(std::ostream &out, const LineTable &lines);
 
 private:
-    ErrorReporter() = default;
-    ErrorReporter(const ErrorReporter &) = delete;
-    ErrorReporter &operator=(const ErrorReporter &) = delete;
-
     std::vector<Error> _errors;
+    std::size_t _error_limit = 0;
+};
+
+/**
+ * @brief `DiagnosticsScope` installs an engine on the calling thread for its
+ * lifetime, and restores the engine installed before it when it ends.
+ */
+class DiagnosticsScope {
+public:
+    explicit DiagnosticsScope(DiagnosticsEngine &engine);
+    ~DiagnosticsScope();
+
+    DiagnosticsScope(const DiagnosticsScope &) = delete;
+    DiagnosticsScope &operator=(const DiagnosticsScope &) = delete;
+
+private:
+    DiagnosticsEngine *_previous;
 };
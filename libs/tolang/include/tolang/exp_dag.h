@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ast.h"
+#include <cstddef>
+
+/**
+ * @brief The number of expression nodes of a tree before and after
+ * `share_exps`.
+ */
+struct ShareStats {
+    std::size_t nodes_before = 0;
+    std::size_t nodes_after = 0;
+};
+
+/**
+ * @brief Turn the expressions of a tree into a DAG, where structurally
+ * identical subexpressions are one node.
+ *
+ * Nodes are hash-consed bottom-up, keyed by their kind, their operator and
+ * the identity of their operands, so comparing two nodes never looks deeper
+ * than their children. Identifiers are keyed by name and numbers by value.
+ *
+ * @return The number of expression nodes before and after sharing.
+ * @note Nodes are only shared within one function body or one statement.
+ * Expressions have no side effects, since functions only compute a value,
+ * but a variable may change between two statements. The tree is walked with
+ * an explicit stack, however deep it is, and printing a DAG prints every
+ * shared node at each of its uses.
+ */
+ShareStats share_exps(CompUnit &root);
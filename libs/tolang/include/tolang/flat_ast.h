@@ -0,0 +1,159 @@
+#pragma once
+
+#include "ast.h"
+#include "name_table.h"
+#include "source_loc.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The index of a node in one of the arrays of a `FlatAst`.
+ */
+using FlatId = uint32_t;
+
+/**
+ * @brief The index of a child that is missing from an invalid tree.
+ */
+constexpr FlatId FLAT_NONE = UINT32_MAX;
+
+/**
+ * @brief An expression in `FlatAst::exps`, which refers to the node in the
+ * array of its kind.
+ * @note Since expressions are stored in post-order, the whole subtree of the
+ * expression `id` is the range `[first, id]`, and the children come before
+ * their parent.
+ */
+struct FlatExp {
+    enum Kind : uint8_t {
+        BINARY,
+        CALL,
+        UNARY,
+        IDENT,
+        NUMBER,
+    } kind;
+    FlatId index;
+    FlatId first;
+};
+
+// `lhs`, `rhs`, `exp` and the items of `FlatAst::args` are indices into
+// `FlatAst::exps`, and `ident` is an index into `FlatAst::idents`.
+
+struct FlatBinaryExp {
+    SourceLoc loc;
+    BinaryExp::BinaryOp op;
+    FlatId lhs;
+    FlatId rhs;
+};
+
+struct FlatCallExp {
+    SourceLoc loc;
+    FlatId ident;
+    // The arguments are `FlatAst::args[first_arg, first_arg + arg_count)`.
+    uint32_t first_arg;
+    uint32_t arg_count;
+};
+
+struct FlatUnaryExp {
+    SourceLoc loc;
+    decltype(UnaryExp::op) op;
+    FlatId exp;
+};
+
+struct FlatIdentExp {
+    SourceLoc loc;
+    FlatId ident;
+};
+
+struct FlatNumber {
+    SourceLoc loc;
+    float value;
+};
+
+struct FlatCond {
+    SourceLoc loc;
+    decltype(Cond::op) op;
+    FlatId lhs;
+    FlatId rhs;
+};
+
+/**
+ * @brief A statement. All kinds of statements share this layout, since none
+ * has more than an identifier and an expression.
+ */
+struct FlatStmt {
+    enum Kind : uint8_t {
+        GET,
+        PUT,
+        TAG,
+        LET,
+        IF,
+        TO,
+    } kind;
+    SourceLoc loc;
+    FlatId ident;
+    // An index into `FlatAst::exps`, or into `FlatAst::conds` for `IF`.
+    FlatId exp;
+};
+
+struct FlatFuncDef {
+    SourceLoc loc;
+    FlatId ident;
+    // The parameters are `FlatAst::params[first_param, first_param +
+    // param_count)`, which are indices into `FlatAst::idents`.
+    uint32_t first_param;
+    uint32_t param_count;
+    FlatId exp;
+};
+
+struct FlatVarDecl {
+    SourceLoc loc;
+    FlatId ident;
+};
+
+/**
+ * @brief `FlatAst` is an alternative layout of the abstract syntax tree, with
+ * one contiguous array per kind of node, where children are referred to by
+ * 32-bit indices instead of pointers.
+ * @note Expressions are stored in post-order, so that an expression tree is
+ * a contiguous range that can be walked without recursion.
+ */
+struct FlatAst {
+    std::vector<FlatFuncDef> func_defs;
+    std::vector<FlatVarDecl> var_decls;
+    std::vector<FlatStmt> stmts;
+
+    std::vector<FlatExp> exps;
+    std::vector<FlatBinaryExp> binary_exps;
+    std::vector<FlatCallExp> call_exps;
+    std::vector<FlatUnaryExp> unary_exps;
+    std::vector<FlatIdentExp> ident_exps;
+    std::vector<FlatNumber> numbers;
+    std::vector<FlatCond> conds;
+
+    std::vector<Ident> idents;
+    std::vector<FlatId> params;
+    std::vector<FlatId> args;
+
+    // The names of all identifiers in the tree.
+    NameTablePtr names;
+    // The line table of the source, to turn the locations of nodes into lines
+    // and columns.
+    std::shared_ptr<LineTable> lines = std::make_shared<LineTable>();
+};
+
+/**
+ * @brief Convert a tree into the flat layout.
+ * @param root The root of the tree, which may be invalid. Missing children
+ * are stored as `FLAT_NONE`.
+ * @note The conversion takes no stack, however deep the expressions are.
+ */
+FlatAst flatten(const CompUnit &root);
+
+/**
+ * @brief Convert a flat tree back into the pointer-based layout, e.g. to
+ * print it.
+ * @note Since children come before their parents, the conversion is one
+ * pass over each array, without recursion.
+ */
+std::unique_ptr<CompUnit> unflatten(const FlatAst &ast);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ast.h"
+
+/**
+ * @brief Fold the constants of an expression in place.
+ *
+ * - A binary or unary expression whose operands are numbers becomes a
+ *   number, unless the result is not finite.
+ * - `x * 1`, `1 * x`, `x / 1`, `x - 0` and `x + -0` become `x`.
+ * - `+x` and `--x` become `x`.
+ *
+ * @param exp The expression, which may be invalid. Missing operands are left
+ * alone.
+ * @note The result is computed in `float`, like the generated code, and only
+ * exact identities are applied: `x + 0` is kept, since it turns `-0` into
+ * `0`. The expression is walked with an explicit stack, however deep it is.
+ */
+void fold(Exp *exp);
+
+/**
+ * @brief Fold the constants of every expression of a tree in place.
+ */
+void fold(CompUnit &root);
+
+/**
+ * @brief `FoldingConsumer` folds every top-level node before passing it on,
+ * to fold the constants of a tree that is streamed by the parser.
+ */
+class FoldingConsumer : public AstConsumer {
+public:
+    explicit FoldingConsumer(AstConsumer &next) : _next(next) {}
+
+    void begin(const CompUnit &root) override { _next.begin(root); }
+    void func_def(const FuncDef &node) override;
+    void var_decl(const VarDecl &node) override { _next.var_decl(node); }
+    void stmt(const Stmt &node) override;
+    void end() override { _next.end(); }
+
+private:
+    AstConsumer &_next;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "name_table.h"
+#include "token_buffer.h"
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+/**
+ * @brief A single replacement of a range of the source.
+ */
+struct TextEdit {
+    // The first replaced character, the same in the old and new source.
+    std::size_t offset;
+    // The number of characters replaced in the old source.
+    std::size_t old_length;
+    // The number of characters that replace them in the new source.
+    std::size_t new_length;
+};
+
+/**
+ * @brief `IncrementalLexer` updates the tokens of a source after an edit,
+ * without scanning the whole source again.
+ *
+ * Scanning restarts at the end of the last token that the edit cannot change,
+ * and stops as soon as a new token starts where an old token past the edit
+ * used to start: the rest of the source is unchanged, so the old tokens from
+ * there on are reused, moved by the size of the edit.
+ *
+ * @note The same name table must be used for every update of a token buffer,
+ * since the reused tokens keep their name IDs. The IDs may therefore differ
+ * from those of a fresh lex, but they name the same identifiers.
+ * @note Invalid characters are kept as `TK_ERR` tokens, but not reported.
+ */
+class IncrementalLexer {
+public:
+    /**
+     * @brief Construct a new IncrementalLexer object.
+     * @param names The table that identifiers are interned into.
+     */
+    IncrementalLexer(NameTablePtr names = std::make_shared<NameTable>())
+        : _names(std::move(names)) {}
+
+    /**
+     * @brief Update the tokens in place after an edit.
+     * @param tokens The tokens of the old source, ending with EOF. They are
+     * replaced by the tokens of the new source.
+     * @param source The new source, which must outlive the tokens.
+     * @param edit The edit that turned the old source into the new one.
+     */
+    void relex(TokenBuffer &tokens, std::string_view source,
+               const TextEdit &edit);
+
+    /**
+     * @brief Get the number of tokens scanned by the last `relex`.
+     */
+    std::size_t rescanned() const { return _rescanned; }
+
+    /**
+     * @brief Get the table that identifiers are interned into.
+     */
+    const NameTablePtr &names() const { return _names; }
+
+private:
+    NameTablePtr _names;
+    std::size_t _rescanned = 0;
+};
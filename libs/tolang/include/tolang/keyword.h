@@ -0,0 +1,184 @@
+#pragma once
+
+#include "token.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief A keyword recognizer generated at compile time from `TOKEN_TYPE`.
+ *
+ * Every token whose spelling looks like an identifier is a keyword, except the
+ * tokens whose "spelling" is only a description (`identifier`, `number`, `err`
+ * and `eof`). The keywords are placed in a small table by a perfect hash of
+ * their length, first and last character, whose parameters are searched for by
+ * the compiler. Recognizing a keyword is then one table probe and one short
+ * comparison, with no allocation and no string hashing.
+ */
+struct KeywordEntry {
+    std::string_view spelling;
+    Token::TokenType type;
+};
+
+// The helpers of `detail` build the tables below at compile time.
+namespace detail {
+
+constexpr bool is_keyword(const KeywordEntry &entry) {
+    if (entry.type == Token::TK_IDENT || entry.type == Token::TK_NUMBER ||
+        entry.type == Token::TK_ERR || entry.type == Token::TK_EOF) {
+        return false;
+    }
+    if (entry.spelling.empty()) {
+        return false;
+    }
+    for (char ch : entry.spelling) {
+        if (!((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+              ch == '_')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr KeywordEntry token_spellings[] = {
+#define X(a, b) {b, Token::a},
+    TOKEN_TYPE
+#undef X
+};
+
+constexpr std::size_t count_keywords() {
+    std::size_t count = 0;
+    for (const auto &entry : token_spellings) {
+        count += is_keyword(entry);
+    }
+    return count;
+}
+
+} // namespace detail
+
+constexpr std::size_t KEYWORD_COUNT = detail::count_keywords();
+
+namespace detail {
+
+constexpr std::array<KeywordEntry, KEYWORD_COUNT> collect_keywords() {
+    std::array<KeywordEntry, KEYWORD_COUNT> keywords{};
+    std::size_t i = 0;
+    for (const auto &entry : token_spellings) {
+        if (is_keyword(entry)) {
+            keywords[i++] = entry;
+        }
+    }
+    return keywords;
+}
+
+} // namespace detail
+
+constexpr std::array<KeywordEntry, KEYWORD_COUNT> KEYWORDS =
+    detail::collect_keywords();
+
+namespace detail {
+
+constexpr std::size_t keyword_length(bool longest) {
+    std::size_t length = longest ? 0 : SIZE_MAX;
+    for (const auto &entry : KEYWORDS) {
+        if (longest ? entry.spelling.size() > length
+                    : entry.spelling.size() < length) {
+            length = entry.spelling.size();
+        }
+    }
+    return length;
+}
+
+} // namespace detail
+
+constexpr std::size_t KEYWORD_MIN_LENGTH = detail::keyword_length(false);
+constexpr std::size_t KEYWORD_MAX_LENGTH = detail::keyword_length(true);
+
+// A power of two, so that the hash is reduced with a mask.
+constexpr std::size_t KEYWORD_TABLE_SIZE = 32;
+
+/**
+ * @brief Parameters of the perfect hash
+ * `(length + first * first_mul + last * last_mul) % KEYWORD_TABLE_SIZE`.
+ */
+struct KeywordHash {
+    uint32_t first_mul;
+    uint32_t last_mul;
+    bool found;
+
+    constexpr std::size_t operator()(std::string_view word) const {
+        auto first = static_cast<unsigned char>(word.front());
+        auto last = static_cast<unsigned char>(word.back());
+        return (word.size() + first * first_mul + last * last_mul) &
+               (KEYWORD_TABLE_SIZE - 1);
+    }
+};
+
+namespace detail {
+
+constexpr KeywordHash find_keyword_hash() {
+    for (uint32_t first_mul = 1; first_mul < 64; first_mul++) {
+        for (uint32_t last_mul = 0; last_mul < 64; last_mul++) {
+            KeywordHash hash{first_mul, last_mul, true};
+            bool used[KEYWORD_TABLE_SIZE] = {};
+            bool perfect = true;
+            for (const auto &entry : KEYWORDS) {
+                auto slot = hash(entry.spelling);
+                if (used[slot]) {
+                    perfect = false;
+                    break;
+                }
+                used[slot] = true;
+            }
+            if (perfect) {
+                return hash;
+            }
+        }
+    }
+    return KeywordHash{0, 0, false};
+}
+
+} // namespace detail
+
+constexpr KeywordHash KEYWORD_HASH = detail::find_keyword_hash();
+static_assert(KEYWORD_HASH.found,
+              "no perfect hash for the keywords, enlarge the search space");
+
+namespace detail {
+
+constexpr std::array<KeywordEntry, KEYWORD_TABLE_SIZE> build_keyword_table() {
+    std::array<KeywordEntry, KEYWORD_TABLE_SIZE> table{};
+    for (auto &slot : table) {
+        slot = {"", Token::TK_IDENT};
+    }
+    for (const auto &entry : KEYWORDS) {
+        table[KEYWORD_HASH(entry.spelling)] = entry;
+    }
+    return table;
+}
+
+} // namespace detail
+
+constexpr std::array<KeywordEntry, KEYWORD_TABLE_SIZE> KEYWORD_TABLE =
+    detail::build_keyword_table();
+
+/**
+ * @brief Get the token type of an identifier-like word.
+ * @param word A non-empty word made of letters, digits and underscores.
+ * @return The keyword type if `word` is a keyword, `TK_IDENT` otherwise.
+ */
+constexpr Token::TokenType keyword_type(std::string_view word) {
+    if (word.size() < KEYWORD_MIN_LENGTH || word.size() > KEYWORD_MAX_LENGTH) {
+        return Token::TK_IDENT;
+    }
+    const auto &entry = KEYWORD_TABLE[KEYWORD_HASH(word)];
+    return entry.spelling == word ? entry.type : Token::TK_IDENT;
+}
+
+static_assert(keyword_type("fn") == Token::TK_FN &&
+              keyword_type("to") == Token::TK_TO &&
+              keyword_type("tag") == Token::TK_TAG &&
+              keyword_type("get") == Token::TK_GET &&
+              keyword_type("foo") == Token::TK_IDENT &&
+              keyword_type("eof") == Token::TK_IDENT);
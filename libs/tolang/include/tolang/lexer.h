@@ -1,39 +1,125 @@
 #pragma once
 
+#include "name_table.h"
+#include "source.h"
 #include "token.h"
+#include "token_buffer.h"
 #include <istream>
-#include <unordered_map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
 /**
- * @brief `Lexer` is a class that reads input from a stream and generates
- * tokens.
+ * @brief `Lexer` is a class that scans a contiguous source buffer and
+ * generates tokens.
  */
 class Lexer {
 public:
     /**
-     * @brief Get the next token from the input stream.
+     * @brief Get the next token from the input.
      * @param token The token to be filled.
-     * @note Get EOF token if the end of the input stream is reached. This
-     * function can still be called after EOF is reached.
+     * @note Get EOF token if the end of the input is reached. This function can
+     * still be called after EOF is reached. An invalid character that reaches
+     * the error limit of the diagnostics engine ends the input.
      */
     void next(Token &token);
 
+    /**
+     * @brief Scan the rest of the input in one pass.
+     * @param tokens The buffer to append the tokens to, which must refer to
+     * the same source as the lexer. The EOF token is appended last.
+     */
+    void tokenize(TokenBuffer &tokens);
+
+    /**
+     * @brief Construct a new Lexer object over a contiguous buffer.
+     * @param begin The first character of the source.
+     * @param end One past the last character of the source.
+     * @param names The table that identifiers are interned into.
+     * @note The buffer is not copied, so it must outlive the lexer and the
+     * tokens it produces. Throw `std::runtime_error` if the buffer is larger
+     * than `MAX_SOURCE_SIZE`.
+     */
+    Lexer(const char *begin, const char *end,
+          NameTablePtr names = std::make_shared<NameTable>())
+        : _names(std::move(names)), _begin(begin), _cur(begin), _end(end) {
+        if (static_cast<std::size_t>(end - begin) > MAX_SOURCE_SIZE) {
+            throw std::runtime_error("source too large");
+        }
+    }
+
+    /**
+     * @brief Construct a new Lexer object over a source buffer.
+     * @param source The source buffer, which must outlive the lexer.
+     * @param names The table that identifiers are interned into.
+     */
+    Lexer(const SourceBuffer &source,
+          NameTablePtr names = std::make_shared<NameTable>())
+        : Lexer(source.begin(), source.end(), std::move(names)) {}
+
     /**
      * @brief Construct a new Lexer object.
      * @param in The input stream.
+     * @param names The table that identifiers are interned into.
+     * @note The whole stream is read into a buffer owned by the lexer, which is
+     * the fallback for inputs that cannot be mapped, such as pipes. Throw
+     * `std::runtime_error` if the stream is larger than `MAX_SOURCE_SIZE`.
+     */
+    Lexer(std::istream &in, NameTablePtr names = std::make_shared<NameTable>());
+
+    /**
+     * @brief Get the table that identifiers are interned into.
+     */
+    const NameTablePtr &names() const { return _names; }
+
+    /**
+     * @brief Get the whole source that the lexer scans.
      */
-    Lexer(std::istream &in) : _input(in) {}
+    std::string_view source() const {
+        return std::string_view(_begin, _end - _begin);
+    }
+
+    // The cursor may point into `_owned`, so the lexer must stay in place.
+    Lexer(const Lexer &) = delete;
+    Lexer &operator=(const Lexer &) = delete;
 
 private:
-    // A table that maps keywords to their token types. Since keywords are
-    // similar to identifiers, we can first identify a identifier and then check
-    // if it is a keyword.
-    static const std::unordered_map<std::string, Token::TokenType>
-        _keywords_table;
+    friend class IncrementalLexer;
+    friend class ParallelLexer;
+
+    /**
+     * @brief Scan the next token like `next`, but without reporting invalid
+     * characters, so that several lexers can run on different threads.
+     */
+    void _scan(Token &token);
+
+    /**
+     * @brief Skip blanks, newlines and comments before the next token.
+     * @note This is a loop rather than a recursion, so that long runs of blank
+     * lines or comments take no stack.
+     */
+    void _skip_trivia();
+
+    /**
+     * @brief Consume the next character if it is `expected`.
+     * @return `true` if the character is consumed.
+     */
+    bool _match(char expected) {
+        if (_cur != _end && *_cur == expected) {
+            _cur++;
+            return true;
+        }
+        return false;
+    }
+
+    NameTablePtr _names;
 
-    int _lineno = 1;
+    // The storage of the source when it is read from a stream.
+    std::string _owned;
 
-    // The input stream. we can use `get` and `unget` to read and unread
-    // characters, which is useful for implementing the lexer.
-    std::istream &_input;
+    // `_begin` is the first character of the source, `_cur` is the next
+    // character to scan, and `_end` is one past the last character.
+    const char *_begin;
+    const char *_cur;
+    const char *_end;
 };
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief The small integer ID of an interned name.
+ */
+using NameId = uint32_t;
+
+/**
+ * @brief `NameTable` interns identifier names, so that each distinct name is
+ * stored once and is referred to by a dense `NameId` afterwards.
+ * @note The `std::string_view`s returned by the table stay valid as long as the
+ * table is alive.
+ */
+class NameTable {
+public:
+    /**
+     * @brief Get the ID of a name, adding the name to the table if it is new.
+     * @param name The name to intern.
+     * @return The ID of the name.
+     */
+    NameId intern(std::string_view name) {
+        auto it = _ids.find(name);
+        if (it != _ids.end()) {
+            return it->second;
+        }
+
+        NameId id = _names.size();
+        const auto &stored = _names.emplace_back(name);
+        _ids.emplace(stored, id);
+        return id;
+    }
+
+    /**
+     * @brief Get the name of an ID returned by `intern`.
+     */
+    std::string_view name(NameId id) const { return _names[id]; }
+
+    /**
+     * @brief Get the number of distinct names in the table.
+     */
+    std::size_t size() const { return _names.size(); }
+
+private:
+    // `std::deque` never moves its elements, so the keys of `_ids` can refer to
+    // the strings stored here.
+    std::deque<std::string> _names;
+    std::unordered_map<std::string_view, NameId> _ids;
+};
+
+using NameTablePtr = std::shared_ptr<NameTable>;
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "name_table.h"
+#include "source.h"
+#include "token_buffer.h"
+#include <cstddef>
+#include <memory>
+
+/**
+ * @brief `ParallelLexer` scans a large source on several threads.
+ *
+ * The source is split into chunks right after newlines. No token spans a
+ * newline and every comment ends at one, so each chunk starts at a token
+ * boundary outside of any comment and can be lexed on its own. The chunks are
+ * lexed concurrently, each into its own token buffer and name table, and then
+ * merged in order, with the names re-interned into the shared table in order
+ * of first appearance. The result is token-for-token identical to what the
+ * serial `Lexer::tokenize` produces, name IDs and error reports included.
+ */
+class ParallelLexer {
+public:
+    /**
+     * @brief Sources smaller than twice this size are lexed serially, since
+     * starting the threads would cost more than it saves.
+     */
+    static constexpr std::size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    /**
+     * @brief Construct a new ParallelLexer object over a contiguous buffer.
+     * @param begin The first character of the source.
+     * @param end One past the last character of the source.
+     * @param names The table that identifiers are interned into.
+     * @param threads The maximum number of threads, or 0 to use one per
+     * hardware thread.
+     * @note The buffer is not copied, so it must outlive the tokens.
+     */
+    ParallelLexer(const char *begin, const char *end,
+                  NameTablePtr names = std::make_shared<NameTable>(),
+                  unsigned threads = 0);
+
+    /**
+     * @brief Construct a new ParallelLexer object over a source buffer.
+     * @param source The source buffer, which must outlive the tokens.
+     * @param names The table that identifiers are interned into.
+     * @param threads The maximum number of threads, or 0 to use one per
+     * hardware thread.
+     */
+    ParallelLexer(const SourceBuffer &source,
+                  NameTablePtr names = std::make_shared<NameTable>(),
+                  unsigned threads = 0)
+        : ParallelLexer(source.begin(), source.end(), std::move(names),
+                        threads) {}
+
+    /**
+     * @brief Scan the whole source, or up to the invalid character that
+     * reaches the error limit of the diagnostics engine, as `Lexer` does.
+     * @param tokens The buffer to append the tokens to, which must refer to
+     * the same source as the lexer. The EOF token is appended last.
+     */
+    void tokenize(TokenBuffer &tokens);
+
+    /**
+     * @brief Get the table that identifiers are interned into.
+     */
+    const NameTablePtr &names() const { return _names; }
+
+    /**
+     * @brief Get the whole source that the lexer scans.
+     */
+    std::string_view source() const {
+        return std::string_view(_begin, _end - _begin);
+    }
+
+private:
+    /**
+     * @brief The tokens of one chunk, lexed against a chunk-local name table.
+     */
+    struct _Chunk;
+
+    NameTablePtr _names;
+    unsigned _threads;
+
+    const char *_begin;
+    const char *_end;
+};
@@ -1,7 +1,12 @@
 #pragma once
 
 #include "ast.h"
+#include "error.h"
 #include "lexer.h"
+#include "name_table.h"
+#include "token_buffer.h"
+#include <cstddef>
+#include <memory>
 #include <vector>
 
 /**
@@ -11,10 +16,42 @@
 class Parser {
 public:
     /**
-     * @brief Construct a new Parser object.
+     * @brief Function definitions that span fewer tokens than this are not
+     * worth a thread of their own in `parse_parallel`.
+     */
+    static constexpr std::size_t MIN_PARALLEL_TOKENS = 1 << 16;
+
+    /**
+     * @brief The number of tokens pulled from a lexer that are kept before
+     * the parsed ones are dropped.
+     */
+    static constexpr std::size_t WINDOW_SIZE = 1 << 12;
+
+    /**
+     * @brief The number of tokens pulled from a lexer at a time.
+     */
+    static constexpr std::size_t FILL_BATCH = 64;
+
+    /**
+     * @brief Construct a new Parser object that pulls tokens from a lexer one
+     * at a time.
      * @param lexer The lexer object.
+     * @note The tokens are pulled into a window of the parser, which is
+     * emptied every `WINDOW_SIZE` tokens, so streaming takes constant memory.
+     */
+    Parser(Lexer &lexer)
+        : _window(std::make_unique<TokenBuffer>(lexer.source())),
+          _lexer(&lexer), _tokens(_window.get()), _names(lexer.names()){};
+
+    /**
+     * @brief Construct a new Parser object that walks a token buffer which has
+     * been filled by `Lexer::tokenize`.
+     * @param tokens The token buffer, ending with an EOF token.
+     * @param names The table that the identifiers of the tokens are interned
+     * into.
      */
-    Parser(Lexer &lexer) : _lexer(lexer){};
+    Parser(const TokenBuffer &tokens, NameTablePtr names)
+        : _tokens(&tokens), _names(std::move(names)){};
 
     /**
      * @brief Parse the tokens generated by the lexer.
@@ -22,42 +59,128 @@ public:
      */
     std::unique_ptr<CompUnit> parse();
 
+    /**
+     * @brief Parse the tokens, handing every top-level node to `consumer` as
+     * soon as it is parsed, and freeing it right after.
+     * @return The root of the tree, which holds no children, but the names
+     * and the line table of the source.
+     * @note Only one top-level node is alive at a time, so the memory taken
+     * by the tree does not grow with the source.
+     */
+    std::unique_ptr<CompUnit> parse(AstConsumer &consumer);
+
+    /**
+     * @brief Parse the tokens like `parse`, but parse the leading function
+     * definitions on several threads.
+     * @param threads The maximum number of threads, or 0 to use one per
+     * hardware thread.
+     * @return The same tree as `parse`, with the function definitions in
+     * source order.
+     * @note The token buffer is pre-scanned for the `;`s that end the
+     * definitions. If any definition turns out to be invalid, the section is
+     * parsed again serially, so that the errors are exactly those of `parse`.
+     * A parser that pulls tokens from a lexer always parses serially.
+     */
+    std::unique_ptr<CompUnit> parse_parallel(unsigned threads = 0);
+
 private:
-    std::unique_ptr<CompUnit> _parse_comp_unit();
-    std::unique_ptr<FuncDef> _parse_func_def();
-    void
-    _parse_func_f_params(std::vector<std::unique_ptr<Ident>> &func_f_params);
-    std::unique_ptr<VarDecl> _parse_var_decl();
-    std::unique_ptr<Stmt> _parse_stmt();
-    std::unique_ptr<Exp> _parse_exp();
-    std::unique_ptr<Exp> _parse_add_exp();
-    std::unique_ptr<Exp> _parse_mul_exp();
-    std::unique_ptr<Exp> _parse_unary_exp();
-    std::unique_ptr<Exp> _parse_primary_exp();
-    void _parse_func_r_params(std::vector<std::unique_ptr<Exp>> &func_r_params);
-    std::unique_ptr<Cond> _parse_cond();
-    std::unique_ptr<Ident> _parse_ident();
-    std::unique_ptr<Exp> _parse_number();
-
-    /**
-     * @brief Get the next token from the lexer.
-     * @note This function will pre-read the next token and store it in
-     * `_pre_read`.
+    std::unique_ptr<CompUnit> _parse(AstConsumer *consumer);
+    std::unique_ptr<CompUnit> _parse_comp_unit(AstConsumer *consumer);
+
+    /**
+     * @brief Parse the function definitions that start at the current token
+     * on `_threads` threads, and move on to the token after them.
+     * @note Nothing is parsed if the definitions are too short to be split,
+     * or if any of them is invalid.
+     */
+    void _parse_func_defs_parallel(CompUnit &comp_unit);
+
+    FuncDef *_parse_func_def();
+    ArenaArray<Ident *> _parse_func_f_params();
+    VarDecl *_parse_var_decl();
+    Stmt *_parse_stmt();
+    Exp *_parse_exp();
+
+    /**
+     * @brief Parse the prefix of an operand, pushing a frame for each unary
+     * operator, parenthesis and call that is opened, up to the first
+     * identifier or number.
+     * @return The identifier or number, `nullptr` on syntax errors.
+     */
+    Exp *_parse_operand();
+
+    /**
+     * @brief Complete the frames above `base` with `exp`, the last parsed
+     * operand, while no further operand is needed.
+     * @return `true` if another operand must be parsed, `false` if the
+     * expression is complete and stored in `exp`.
+     */
+    bool _reduce_exp(std::size_t base, Exp *&exp);
+    Cond *_parse_cond();
+    Ident *_parse_ident();
+    Exp *_parse_number();
+
+    /**
+     * @brief Get the type of the current token.
+     */
+    Token::TokenType _type() const { return _tokens->type(_index); }
+
+    /**
+     * @brief Get the location of the current token.
+     */
+    SourceLoc _loc() const { return _tokens->loc(_index); }
+
+    /**
+     * @brief Get the type of the `k`-th token after the current one, or EOF
+     * past the end of the input.
+     */
+    Token::TokenType _peek(std::size_t k) {
+        if (_index + k < _tokens->size() || _fill(k)) {
+            return _tokens->type(_index + k);
+        }
+        return Token::TK_EOF;
+    }
+
+    /**
+     * @brief Move on to the next token, staying at the trailing EOF token.
      */
     void _next_token() {
-        _token = _pre_read;
-        _lexer.next(_pre_read);
+        if (_index + 1 < _tokens->size() || _fill(1)) {
+            _index++;
+        }
     }
 
+    /**
+     * @brief Pull tokens from `_lexer` into `_window` until it holds the
+     * `k`-th token after the current one.
+     * @return `false` if the input ends before that token, or if the tokens
+     * come from a buffer, which holds them all.
+     */
+    bool _fill(std::size_t k);
+
     /**
      * @brief Match the current token with the expected token type, and get the
      * next token if they match.
-     * @param token The current token.
      * @param expected The expected token type.
      * @note If the current token type does not match the expected token type,
      * an error will be reported.
      */
-    void _match(const Token &token, Token::TokenType expected);
+    void _match(Token::TokenType expected);
+
+    /**
+     * @brief Report a syntax error.
+     */
+    void _error(SourceLoc loc, const std::string &msg) {
+        DiagnosticsEngine::error(loc, msg);
+    }
+
+    /**
+     * @brief Check if the error limit of the diagnostics engine is reached,
+     * after which the parser stops as if the input ended.
+     */
+    bool _stopped() const {
+        return DiagnosticsEngine::current().limit_reached();
+    }
 
     /**
      * @brief Recover from a syntax error.
@@ -66,13 +189,60 @@ private:
     void _recover() {
         do {
             _next_token();
-        } while (_token.type != Token::TK_SEMINCN &&
-                 _token.type != Token::TK_EOF);
+        } while (_type() != Token::TK_SEMINCN && _type() != Token::TK_EOF);
         _next_token();
     }
 
-    // `_token` is the current token, and `_pre_read` is the next token.
-    Token _token, _pre_read;
+    // The tokens pulled from `_lexer`, if the parser has a lexer.
+    std::unique_ptr<TokenBuffer> _window;
+    Lexer *_lexer = nullptr;
+
+    // The tokens are read from `_tokens`, which is `_window` with a lexer.
+    // `_index` is the current token.
+    const TokenBuffer *_tokens = nullptr;
+    std::size_t _index = 0;
+
+    NameTablePtr _names;
+
+    // The number of threads of `parse_parallel`, 1 for `parse`.
+    unsigned _threads = 1;
+
+    /**
+     * @brief A rule of the expression grammar that waits for an operand.
+     */
+    struct _ExpFrame {
+        enum Kind : uint8_t {
+            ADD,
+            MUL,
+            UNARY,
+            PAREN,
+            CALL,
+        } kind;
+        // The location of the first token of the rule.
+        SourceLoc loc;
+        // The operator of `ADD`, `MUL` and `UNARY`. `ADD` and `MUL` have a
+        // left operand in `lhs` once an operator is pending.
+        Token::TokenType op = Token::TK_ERR;
+        bool pending = false;
+        Exp *lhs = nullptr;
+        // The callee of `CALL`, whose arguments start at `_exp_stack[first]`.
+        Ident *ident = nullptr;
+        std::size_t first = 0;
+    };
+
+    _ExpFrame &_push_exp_frame(_ExpFrame::Kind kind) {
+        auto &frame = _exp_frames.emplace_back();
+        frame.kind = kind;
+        frame.loc = _loc();
+        return frame;
+    }
 
-    Lexer &_lexer;
+    // The arena of the tree being built.
+    Arena *_arena = nullptr;
+    // Scratch space for the parameters of a function definition, and for the
+    // arguments of the calls being parsed, innermost call last.
+    std::vector<Ident *> _ident_stack;
+    std::vector<Exp *> _exp_stack;
+    // The rules of the expressions being parsed, innermost last.
+    std::vector<_ExpFrame> _exp_frames;
 };
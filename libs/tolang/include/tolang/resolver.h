@@ -0,0 +1,133 @@
+#pragma once
+
+#include "ast.h"
+#include "flat_ast.h"
+#include "symtable.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief `Resolver` binds every identifier of a program to the symbol it
+ * names, and reports the errors of names, before any code is generated.
+ *
+ * Each symbol gets a dense index, its slot, which is stored into
+ * `Ident::slot` of every identifier that names it, so that the code
+ * generators keep the state of symbols in arrays indexed by slot. An
+ * identifier whose symbol is missing, redefined or of the wrong kind keeps
+ * `NO_SLOT`, and so do the identifiers of the parts of the program that the
+ * code generators skip after such an error.
+ *
+ * @note The nodes are resolved in the order the code generators visit them:
+ * the function definitions, then the variable declarations, then the
+ * statements, or one top-level node at a time while a tree is streamed.
+ * Functions are defined in the global scope, parameters in the scope of their
+ * function and variables and tags in the scope of the main function.
+ */
+class Resolver {
+public:
+    /**
+     * @brief Resolve a whole tree.
+     */
+    void resolve(const CompUnit &root);
+
+    /**
+     * @brief Resolve a whole tree in the flat layout.
+     */
+    void resolve(FlatAst &ast);
+
+    // Resolve a tree one top-level node at a time, like an `AstConsumer`.
+    void begin(const CompUnit &root) {
+        _names = root.names;
+        _lines = root.lines.get();
+    }
+    void func_def(const FuncDef &node);
+    void var_decl(const VarDecl &node);
+    void stmt(const Stmt &node);
+    void end();
+
+    /**
+     * @brief Resolve each expression node once per function body or
+     * statement, for trees whose nodes are shared by `share_exps`.
+     */
+    void memoize_exps(bool enable) { _memoize_exps = enable; }
+
+    /**
+     * @brief Get the number of slots given out so far.
+     */
+    std::size_t size() const { return _table.size(); }
+
+    /**
+     * @brief Get the symbol of a slot.
+     */
+    const Symbol &symbol(uint32_t slot) const { return _table.symbol(slot); }
+
+private:
+    void _begin_main();
+    void _end_main();
+
+    /**
+     * @brief Define a function and open the scope of its parameters.
+     * @return `false` if the function is redefined, in which case its body is
+     * skipped.
+     */
+    bool _begin_func_def(Ident &ident, SourceLoc loc,
+                         const std::vector<Ident *> &params);
+    void _define_var(Ident &ident);
+    void _use_any(Ident &ident);
+    void _define_tag(Ident &ident);
+    void _use_tag(Ident &ident);
+
+    // These report an error and return `false` if the identifier does not
+    // name a symbol of the kind.
+    bool _use_variable(Ident &ident);
+    bool _use_function(Ident &ident, std::size_t args_count);
+
+    // These return `false` if there is an error in the expression.
+    bool _resolve_exp(const Exp &root);
+    bool _resolve_cond(const Cond &node);
+    bool _resolve_flat_exp(FlatAst &ast, FlatId root);
+
+    /**
+     * @brief Check a node of `_resolve_exp`, and push its children.
+     * @return `false` if the node has an error of its own.
+     */
+    bool _expand_exp(const Exp &exp);
+
+    void _resolve_flat_stmt(FlatAst &ast, const FlatStmt &node);
+
+    int _line(SourceLoc loc) const {
+        return loc.valid() ? _lines->line(loc) : -1;
+    }
+
+    SymbolTable _table;
+    // The names of the resolved tree, which the names of symbols refer to.
+    NameTablePtr _names;
+    // The line table of the resolved tree, for messages that refer to lines.
+    const LineTable *_lines = nullptr;
+    bool _in_main = false;
+
+    // Whether the expression nodes of the current function body or statement
+    // are free of errors, if `_memoize_exps` is set.
+    bool _memoize_exps = false;
+    std::unordered_map<const Exp *, bool> _exp_results;
+
+    // The explicit stacks of `_resolve_exp` and `_resolve_flat_exp`, kept to
+    // reuse their storage.
+    struct _ExpFrame {
+        const Exp *exp;
+        bool expanded;
+        // Whether the node and the children finished so far are free of
+        // errors.
+        bool ok;
+    };
+    struct _FlatFrame {
+        FlatId id;
+        bool expanded;
+        // Whether the function of a call has been found.
+        bool callable;
+    };
+    std::vector<_ExpFrame> _exp_frames;
+    std::vector<_FlatFrame> _flat_frames;
+    std::vector<bool> _flat_results;
+};
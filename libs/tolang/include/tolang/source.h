@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief `SourceBuffer` is a contiguous, read-only view of a whole source
+ * file. The content is either memory-mapped from a regular file or owned as an
+ * in-memory string.
+ * @note A `SourceBuffer` is move-only, and the memory it exposes stays valid
+ * until the buffer is destroyed.
+ */
+class SourceBuffer {
+public:
+    /**
+     * @brief Construct an empty source buffer.
+     */
+    SourceBuffer() = default;
+
+    /**
+     * @brief Construct a source buffer that owns the given content.
+     * @param content The source content.
+     * @note Throw `std::runtime_error` if the content is larger than
+     * `MAX_SOURCE_SIZE`.
+     */
+    explicit SourceBuffer(std::string content);
+
+    /**
+     * @brief Map the whole file at `path` into memory.
+     * @param path The path of a regular file.
+     * @return The mapped source buffer.
+     * @note Throw `std::runtime_error` if the file cannot be opened or mapped,
+     * or is larger than `MAX_SOURCE_SIZE`.
+     */
+    static SourceBuffer map_file(const std::string &path);
+
+    SourceBuffer(SourceBuffer &&other) noexcept;
+    SourceBuffer &operator=(SourceBuffer &&other) noexcept;
+    SourceBuffer(const SourceBuffer &) = delete;
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+    ~SourceBuffer();
+
+    const char *begin() const { return _data; }
+    const char *end() const { return _data + _size; }
+    std::size_t size() const { return _size; }
+
+    std::string_view view() const { return std::string_view(_data, _size); }
+
+private:
+    void _release();
+
+    const char *_data = "";
+    std::size_t _size = 0;
+
+    // `true` if `_data` comes from `mmap` and must be unmapped.
+    bool _mapped = false;
+
+    // The storage of `_data` if the buffer is not mapped.
+    std::string _owned;
+};
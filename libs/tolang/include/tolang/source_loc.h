@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief `SourceLoc` is a compact position in a source file, stored as the
+ * offset of a character. Lines and columns are computed on demand by a
+ * `LineTable`.
+ */
+struct SourceLoc {
+    uint32_t offset = 0;
+
+    SourceLoc() = default;
+    explicit SourceLoc(uint32_t offset) : offset(offset) {}
+
+    /**
+     * @brief Get a location that is not in any source, for things that are
+     * not written anywhere (yet).
+     */
+    static SourceLoc invalid() { return SourceLoc(UINT32_MAX); }
+    bool valid() const { return offset != UINT32_MAX; }
+
+    bool operator==(SourceLoc other) const { return offset == other.offset; }
+    bool operator!=(SourceLoc other) const { return offset != other.offset; }
+    bool operator<(SourceLoc other) const { return offset < other.offset; }
+};
+
+/**
+ * @brief The largest size of a source, in bytes, so that every offset in it,
+ * up to the end, fits in a `SourceLoc` below `SourceLoc::invalid()`.
+ */
+constexpr std::size_t MAX_SOURCE_SIZE = UINT32_MAX - 1;
+
+/**
+ * @brief A line and a column, both starting from 1. The column counts bytes.
+ */
+struct LineColumn {
+    int line;
+    int column;
+};
+
+/**
+ * @brief `LineTable` records where each line of a source starts, so that a
+ * `SourceLoc` can be turned into a line and a column.
+ * @note The table is built once per file, by one pass over the source, and
+ * does not refer to the source afterwards.
+ */
+class LineTable {
+public:
+    /**
+     * @brief Construct the line table of an empty source.
+     */
+    LineTable() : _starts{0} {}
+
+    /**
+     * @brief Construct the line table of a source.
+     */
+    explicit LineTable(std::string_view source);
+
+    /**
+     * @brief Get the line of a location.
+     */
+    int line(SourceLoc loc) const;
+
+    /**
+     * @brief Get the line and column of a location.
+     */
+    LineColumn line_column(SourceLoc loc) const;
+
+    /**
+     * @brief Get the number of lines.
+     */
+    std::size_t size() const { return _starts.size(); }
+
+private:
+    // The offset of the first character of each line.
+    std::vector<uint32_t> _starts;
+};
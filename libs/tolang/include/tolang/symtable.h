@@ -1,13 +1,12 @@
 #pragma once
 
-#include "utils.h"
-
-#if TOLANG_BACKEND == LLVM
-
-#include "llvm/ir/Llvm.h"
-#include <memory>
+#include "name_table.h"
+#include "source_loc.h"
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 enum SymbolType { VAR, TAG, FUNC };
@@ -31,128 +30,186 @@ inline std::string symbol_type_to_string(SymbolType type) {
 }
 
 /**
- * @brief `Symbol` is a class for different types of symbols, which are
- * used in the symbol table.
- * @note This is a base class for different types of symbols.
+ * @brief `Symbol` is a symbol of any type, which is stored by value in the
+ * symbol table.
+ * @note What the code generators make of a symbol is kept by them, indexed by
+ * its slot.
  */
 struct Symbol {
     SymbolType type;
-    std::string name;
-    int lineno;
-    ValuePtr value;
-
-    virtual ~Symbol() = default;
-
-    Symbol(SymbolType type, std::string name, ValuePtr value, int lineno)
-        : type(type), name(name), value(value), lineno(lineno) {}
-};
-
-/**
- * @brief A symbol representing a variable.
- */
-struct VariableSymbol : public Symbol {
-    VariableSymbol(std::string name, ValuePtr value, int lineno)
-        : Symbol(SymbolType::VAR, name, value, lineno) {}
-};
-
-/**
- * @brief A symbol representing a tag.
- */
-struct TagSymbol : public Symbol {
-    BasicBlockPtr target;
-    std::vector<InstructionPtr> jump_insts;
-
-    TagSymbol(std::string name, ValuePtr value, int lineno)
-        : Symbol(SymbolType::TAG, name, value, lineno) {}
-};
-
-/**
- * @brief A symbol representing a function.
- */
-struct FunctionSymbol : public Symbol {
-    int params_count = 0;
-
-    FunctionSymbol(std::string name, ValuePtr value, int lineno,
-                   int params_count)
-        : Symbol(SymbolType::FUNC, name, value, lineno),
+    // The interned name, whose `name` is stored in the `NameTable` of the
+    // program.
+    NameId id;
+    std::string_view name;
+    SourceLoc loc;
+    // The index of the symbol among all symbols of the program, which is
+    // stored into the identifiers that name it. It is given by `SymbolTable`.
+    uint32_t slot = 0;
+    // The number of parameters of a function.
+    std::size_t params_count = 0;
+
+    Symbol(SymbolType type, NameId id, std::string_view name, SourceLoc loc,
+           std::size_t params_count = 0)
+        : type(type), id(id), name(name), loc(loc),
           params_count(params_count) {}
 };
 
 /**
- * @brief A symbol table, which is a map from symbol names to symbols.
- * @note This is a recursive data structure, where each symbol table has a
- * pointer to its parent symbol table.
+ * @brief A symbol table, which maps interned names to the symbols of the
+ * scopes that are open.
+ *
+ * The table is flat: every definition pushes a binding onto one stack, and
+ * an open-addressing hash maps each name to its innermost binding, which
+ * links to the binding it shadows. A scope is a mark on the stack, so
+ * `push_scope` only records the height of the stack, and `pop_scope` unwinds
+ * the bindings above the mark.
+ *
+ * @note Symbols are never removed. They are stored in one array, indexed by
+ * slot, which outlives the scopes they are defined in.
  */
-class SymbolTable : public std::enable_shared_from_this<SymbolTable> {
+class SymbolTable {
 public:
-    SymbolTable() : _father(nullptr) {}
+    SymbolTable() : _entries(INITIAL_CAPACITY) {}
 
     /**
      * @brief Check if a symbol with the given name exists in the current scope.
-     * @param name The name of the symbol.
+     * @param id The interned name of the symbol.
      * @return `true` if the symbol exists, `false` otherwise.
      */
-    bool exist_in_scope(const std::string &name) {
-        return _symbols.find(name) != _symbols.end();
+    bool exist_in_scope(NameId id) const {
+        uint32_t binding = _entries[_find(id)].binding;
+        return binding != NONE && binding >= _scope_begin();
     }
 
     /**
-     * @brief Add a symbol to the current scope.
+     * @brief Add a symbol to the current scope, giving it the next slot.
      * @param symbol The symbol to be added.
      * @return `true` if the symbol is added successfully, `false` if a symbol
      * with the same name already exists in the current scope.
+     * @note The symbol is stored, and its slot taken, even if it is not
+     * added, so that every definition has a slot of its own.
      */
-    bool add_symbol(std::shared_ptr<Symbol> symbol) {
-        if (exist_in_scope(symbol->name)) {
+    bool add_symbol(Symbol symbol) {
+        uint32_t slot = _symbols.size();
+        symbol.slot = slot;
+        _symbols.push_back(symbol);
+
+        std::size_t index = _find(symbol.id);
+        auto &entry = _entries[index];
+        if (entry.binding != NONE && entry.binding >= _scope_begin()) {
             return false;
         }
+        if (entry.id == NONE) {
+            entry.id = symbol.id;
+            _used++;
+        }
+        _bindings.push_back({slot, entry.binding});
+        entry.binding = _bindings.size() - 1;
 
-        _symbols[symbol->name] = symbol;
+        if (_used * 2 > _entries.size()) {
+            _grow();
+        }
         return true;
     }
 
     /**
-     * @brief Get a symbol with the given name.
-     * @param name The name of the symbol.
+     * @brief Get the symbol a name refers to in the scopes that are open.
+     * @param id The interned name of the symbol.
      * @return The symbol if it exists, `nullptr` otherwise.
      */
-    std::shared_ptr<Symbol> get_symbol(const std::string &name) {
-        auto it = _symbols.find(name);
-        if (it != _symbols.end()) {
-            return it->second;
-        } else if (_father != nullptr) {
-            return _father->get_symbol(name);
-        } else {
+    const Symbol *get_symbol(NameId id) const {
+        uint32_t binding = _entries[_find(id)].binding;
+        if (binding == NONE) {
             return nullptr;
         }
+        return &_symbols[_bindings[binding].slot];
     }
 
     /**
-     * @brief Create a new scope, which means a new symbol table will be
-     * created. And the current symbol table will be the father of the new
-     * symbol table.
-     * @return The new symbol table.
+     * @brief Open a new scope, nested in the current one.
      */
-    std::shared_ptr<SymbolTable> push_scope() {
-        auto new_table = std::make_shared<SymbolTable>();
-        new_table->_father = shared_from_this();
-        return new_table;
+    void push_scope() { _scopes.push_back(_bindings.size()); }
+
+    /**
+     * @brief Close the current scope, after which the names defined in it
+     * refer again to the symbols they shadowed.
+     * @note The global scope is never closed.
+     */
+    void pop_scope() {
+        if (_scopes.empty()) {
+            return;
+        }
+        uint32_t begin = _scopes.back();
+        _scopes.pop_back();
+        while (_bindings.size() > begin) {
+            auto &binding = _bindings.back();
+            _entries[_find(_symbols[binding.slot].id)].binding =
+                binding.shadowed;
+            _bindings.pop_back();
+        }
     }
 
     /**
-     * @brief Pop the current scope, which means the father of the current
-     * symbol table will be returned.
-     * @return The father symbol table.
-     * @note Since we use `shared_ptr`, the current symbol table will be
-     * automatically deleted if there is no other reference to it.
+     * @brief Get the symbol of a slot.
      */
-    std::shared_ptr<SymbolTable> pop_scope() { return _father; }
+    const Symbol &symbol(uint32_t slot) const { return _symbols[slot]; }
+
+    /**
+     * @brief Get the number of slots given out so far.
+     */
+    std::size_t size() const { return _symbols.size(); }
 
 private:
-    std::unordered_map<std::string, std::shared_ptr<Symbol>> _symbols;
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr std::size_t INITIAL_CAPACITY = 64;
+
+    struct _Entry {
+        NameId id = NONE;
+        // The innermost binding of the name, `NONE` if it is not bound.
+        uint32_t binding = NONE;
+    };
+
+    struct _Binding {
+        uint32_t slot;
+        // The binding of the same name in an outer scope, `NONE` if none.
+        uint32_t shadowed;
+    };
+
+    uint32_t _scope_begin() const {
+        return _scopes.empty() ? 0 : _scopes.back();
+    }
 
-    // The father symbol table, `nullptr` if this is the global symbol table.
-    std::shared_ptr<SymbolTable> _father;
-};
+    /**
+     * @brief Find the entry of a name, or the empty entry where it would be
+     * inserted.
+     */
+    std::size_t _find(NameId id) const {
+        std::size_t mask = _entries.size() - 1;
+        std::size_t index = (id * 0x9e3779b9u) & mask;
+        while (_entries[index].id != id && _entries[index].id != NONE) {
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
 
-#endif
\ No newline at end of file
+    void _grow() {
+        std::vector<_Entry> entries(_entries.size() * 2);
+        std::swap(entries, _entries);
+        for (auto &entry : entries) {
+            if (entry.id != NONE) {
+                _entries[_find(entry.id)] = entry;
+            }
+        }
+    }
+
+    // The symbols, indexed by slot.
+    std::vector<Symbol> _symbols;
+    // The bindings of the scopes that are open, innermost last.
+    std::vector<_Binding> _bindings;
+    // The height of `_bindings` when each nested scope was opened.
+    std::vector<uint32_t> _scopes;
+    // The hash from names to their innermost bindings, whose capacity is a
+    // power of two. Names stay in it once added, unbound or not.
+    std::vector<_Entry> _entries;
+    std::size_t _used = 0;
+};
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "name_table.h"
+#include "source_loc.h"
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 // X macro magic
@@ -38,6 +41,8 @@
 /**
  * @brief `Token` is a class that represents a token generated by the lexer. And
  * it is consumed by the parser.
+ * @note `content` points into the source buffer of the lexer, so building a
+ * token never allocates.
  */
 struct Token {
     enum TokenType {
@@ -45,13 +50,18 @@ struct Token {
         TOKEN_TYPE
 #undef X
     } type;
-    std::string content;
-    int lineno;
+    std::string_view content;
+    SourceLoc loc;
+    // The interned name of a `TK_IDENT` token.
+    NameId name = 0;
+    // The value of a `TK_NUMBER` token, converted by the lexer.
+    float value = 0;
 
     Token() = default;
 
-    Token(TokenType type, std::string content, int lineno)
-        : type(type), content(content), lineno(lineno) {}
+    Token(TokenType type, std::string_view content, SourceLoc loc,
+          NameId name = 0)
+        : type(type), content(content), loc(loc), name(name) {}
 };
 
 inline std::string token_type_to_string(Token::TokenType type) {
@@ -0,0 +1,270 @@
+#pragma once
+
+#include "name_table.h"
+#include "token.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief `TokenBuffer` holds all tokens of a source in a structure-of-arrays
+ * layout, with one compact array per token field.
+ *
+ * The arrays are a gap buffer: `splice` leaves a gap of unused entries where
+ * the last edit was, and the tokens before the gap store their offset from
+ * the start of the source, while the tokens after it store their offset from
+ * the end. An edit at the gap then changes neither, so successive edits at
+ * the same place cost the size of the edits, whatever the size of the source.
+ * Moving the gap costs the number of tokens it moves over. A buffer that has
+ * not been spliced has its gap at the end, and is read like plain arrays.
+ *
+ * @note The content of a token is not stored, but sliced from the source by
+ * its offset and length. So the source must outlive the buffer. The offset
+ * is also the location of the token.
+ */
+class TokenBuffer {
+public:
+    /**
+     * @brief Construct an empty token buffer.
+     * @param source The source that the tokens are scanned from.
+     */
+    explicit TokenBuffer(std::string_view source) : _source(source) {}
+
+    /**
+     * @brief Append a token, whose content must lie in the source.
+     */
+    void push(const Token &token) {
+        if (_gap != _types.size()) {
+            _close_gap();
+        }
+        _gap++;
+        _types.push_back(token.type);
+        _offsets.push_back(_offset(token));
+        _lengths.push_back(token.content.size());
+        _payloads.push_back(_payload(token));
+    }
+
+    /**
+     * @brief Replace the tokens `[first, last)` after an edit of the source.
+     * @param tokens The replacing tokens, scanned from the new source that
+     * this buffer then refers to.
+     * @note The tokens after `last` must have moved by the change in size of
+     * the source, as they do after a single edit before them. They are not
+     * touched, since they are located from the end of the source, so only
+     * the replaced tokens and those that the gap moves over are.
+     */
+    void splice(std::size_t first, std::size_t last,
+                const TokenBuffer &tokens) {
+        // grow the gap before moving it, which is cheaper while it is at the
+        // end of the arrays
+        std::size_t count = tokens.size();
+        if (_gap_size + (last - first) < count) {
+            _grow_gap(count - (last - first));
+        }
+        _move_gap(last);
+        _gap = first;
+        _gap_size += last - first;
+        _source = tokens._source;
+
+        for (std::size_t i = 0; i < count; i++) {
+            std::size_t j = tokens._at(i);
+            _types[_gap] = tokens._types[j];
+            _offsets[_gap] = tokens.offset(i);
+            _lengths[_gap] = tokens._lengths[j];
+            _payloads[_gap] = tokens._payloads[j];
+            _gap++;
+        }
+        _gap_size -= count;
+    }
+
+    /**
+     * @brief Overwrite the `i`-th token, whose content must lie in the source.
+     * @note Different tokens can be set from different threads.
+     */
+    void set(std::size_t i, const Token &token) {
+        std::size_t j = _at(i);
+        uint32_t offset = _offset(token);
+        _types[j] = token.type;
+        _offsets[j] = i < _gap ? offset : _end() - offset;
+        _lengths[j] = token.content.size();
+        _payloads[j] = _payload(token);
+    }
+
+    /**
+     * @brief Grow or shrink the buffer to `count` tokens. New tokens are
+     * empty and must be `set` before use.
+     */
+    void resize(std::size_t count) {
+        _close_gap();
+        _gap = count;
+        _types.resize(count);
+        _offsets.resize(count);
+        _lengths.resize(count);
+        _payloads.resize(count);
+    }
+
+    /**
+     * @brief Reserve room for `count` tokens.
+     */
+    void reserve(std::size_t count) {
+        _close_gap();
+        _types.reserve(count);
+        _offsets.reserve(count);
+        _lengths.reserve(count);
+        _payloads.reserve(count);
+    }
+
+    std::size_t size() const { return _types.size() - _gap_size; }
+    std::string_view source() const { return _source; }
+
+    Token::TokenType type(std::size_t i) const {
+        return static_cast<Token::TokenType>(_types[_at(i)]);
+    }
+    uint32_t offset(std::size_t i) const {
+        return i < _gap ? _offsets[i] : _end() - _offsets[i + _gap_size];
+    }
+    uint32_t length(std::size_t i) const { return _lengths[_at(i)]; }
+    SourceLoc loc(std::size_t i) const { return SourceLoc(offset(i)); }
+
+    NameId name(std::size_t i) const {
+        return type(i) == Token::TK_IDENT ? _payloads[_at(i)] : 0;
+    }
+
+    float value(std::size_t i) const {
+        float value = 0;
+        if (type(i) == Token::TK_NUMBER) {
+            std::memcpy(&value, &_payloads[_at(i)], sizeof(value));
+        }
+        return value;
+    }
+
+    std::string_view content(std::size_t i) const {
+        return _source.substr(offset(i), length(i));
+    }
+
+    /**
+     * @brief Rebuild the `i`-th token.
+     */
+    Token get(std::size_t i) const {
+        Token token(type(i), content(i), loc(i), name(i));
+        token.value = value(i);
+        return token;
+    }
+
+private:
+    /**
+     * @brief Get the entry of the `i`-th token in the arrays.
+     */
+    std::size_t _at(std::size_t i) const {
+        return i < _gap ? i : i + _gap_size;
+    }
+
+    /**
+     * @brief Get the offset of the end of the source, which the tokens after
+     * the gap are located from.
+     */
+    uint32_t _end() const { return _source.size(); }
+
+    /**
+     * @brief Get the offset of a token in the source.
+     */
+    uint32_t _offset(const Token &token) const {
+        std::size_t offset = token.content.data() - _source.data();
+        // the lexers reject sources larger than `MAX_SOURCE_SIZE`
+        assert(offset <= MAX_SOURCE_SIZE);
+        return offset;
+    }
+
+    /**
+     * @brief Move the gap to before the `pos`-th token, moving the tokens in
+     * between to the other side of the gap.
+     */
+    void _move_gap(std::size_t pos) {
+        // the entries move as blocks, and their offsets from the start turn
+        // into ones from the end, and back, by subtracting them from the end
+        std::size_t from = pos < _gap ? pos : _gap + _gap_size;
+        std::size_t to = pos < _gap ? pos + _gap_size : _gap;
+        std::size_t count = pos < _gap ? _gap - pos : pos - _gap;
+        _move(_types, from, to, count);
+        _move(_offsets, from, to, count);
+        _move(_lengths, from, to, count);
+        _move(_payloads, from, to, count);
+        uint32_t end = _end();
+        for (std::size_t i = to; i < to + count; i++) {
+            _offsets[i] = end - _offsets[i];
+        }
+        _gap = pos;
+    }
+
+    template <typename T>
+    static void _move(std::vector<T> &array, std::size_t from, std::size_t to,
+                      std::size_t count) {
+        auto first = array.begin() + from;
+        if (from == to) {
+            return;
+        }
+        if (from < to) {
+            std::copy_backward(first, first + count,
+                               array.begin() + to + count);
+        } else {
+            std::copy(first, first + count, array.begin() + to);
+        }
+    }
+
+    /**
+     * @brief Grow the gap to hold at least `count` tokens, with room to
+     * spare for the next edits.
+     */
+    void _grow_gap(std::size_t count) {
+        std::size_t grow = count - _gap_size + size() / 16 + 16;
+        std::size_t after = _gap + _gap_size;
+        _types.insert(_types.begin() + after, grow, 0);
+        _offsets.insert(_offsets.begin() + after, grow, 0);
+        _lengths.insert(_lengths.begin() + after, grow, 0);
+        _payloads.insert(_payloads.begin() + after, grow, 0);
+        _gap_size += grow;
+    }
+
+    /**
+     * @brief Move the gap to the end and drop it, so that tokens can be
+     * appended.
+     */
+    void _close_gap() {
+        _move_gap(size());
+        _types.resize(_gap);
+        _offsets.resize(_gap);
+        _lengths.resize(_gap);
+        _payloads.resize(_gap);
+        _gap_size = 0;
+    }
+
+    static uint32_t _payload(const Token &token) {
+        uint32_t payload = 0;
+        if (token.type == Token::TK_IDENT) {
+            payload = token.name;
+        } else if (token.type == Token::TK_NUMBER) {
+            static_assert(sizeof(float) == sizeof(payload));
+            std::memcpy(&payload, &token.value, sizeof(payload));
+        }
+        return payload;
+    }
+
+    std::string_view _source;
+
+    // The entries `[_gap, _gap + _gap_size)` of the arrays are the gap.
+    std::size_t _gap = 0;
+    std::size_t _gap_size = 0;
+
+    std::vector<uint8_t> _types;
+    // The offset from the start of the source before the gap, and from its
+    // end after it.
+    std::vector<uint32_t> _offsets;
+    std::vector<uint32_t> _lengths;
+    // The interned name of an identifier or the bits of the value of a
+    // number, 0 for other tokens.
+    std::vector<uint32_t> _payloads;
+};
@@ -5,21 +5,27 @@
 #if TOLANG_BACKEND == LLVM
 
 #include "ast.h"
-#include "symtable.h"
+#include "error.h"
+#include "flat_ast.h"
+#include "resolver.h"
 #include "llvm/ir/Module.h"
+#include <unordered_map>
+#include <vector>
 
 /**
  * @brief `Visitor` is a class that visits the abstract syntax tree and
  * generates the intermediate representation.
+ * @note The names of a tree are bound by a `Resolver` before its code is
+ * generated, which reports the errors of names. Code generation then only
+ * looks symbols up by slot.
  */
-class Visitor {
+class Visitor : public AstConsumer {
 public:
     /**
      * @brief Construct a new Visitor object.
      * @param module The intermediate representation module.
      */
-    Visitor(ModulePtr module)
-        : _ir_module(module), _cur_scope(std::make_shared<SymbolTable>()) {}
+    Visitor(ModulePtr module) : _ir_module(module) {}
 
     /**
      * @brief Visit the given abstract syntax tree.
@@ -29,7 +35,59 @@ public:
      */
     void visit(const CompUnit &node);
 
+    /**
+     * @brief Visit the given abstract syntax tree in the flat layout.
+     * @param ast The flat abstract syntax tree.
+     * @note The intermediate representation and the errors are the same as
+     * those of the tree that `ast` is flattened from, but expressions are
+     * walked without recursion. The identifiers of `ast` are bound to their
+     * slots.
+     */
+    void visit(FlatAst &ast);
+
+    /**
+     * @brief Generate an expression node once per function body or statement,
+     * however many times it is used, for trees whose nodes are shared by
+     * `share_exps`.
+     * @note The errors of a shared node are reported once, too.
+     */
+    void memoize_exps(bool enable) {
+        _memoize_exps = enable;
+        _resolver.memoize_exps(enable);
+    }
+
+    /**
+     * @brief Stop generating code once any error has been reported, since a
+     * program with errors is not emitted. Names are still resolved, so their
+     * errors are reported.
+     */
+    void stop_on_error(bool enable) { _stop_on_error = enable; }
+
+    // Visit a tree one top-level node at a time, while it is being parsed by
+    // `Parser::parse(AstConsumer &)`. Each node is resolved right before its
+    // code is generated, and forward jumps to tags are patched through
+    // `_Slot::jump_insts`, like in `visit`.
+    void begin(const CompUnit &root) override;
+    void func_def(const FuncDef &node) override;
+    void var_decl(const VarDecl &node) override;
+    void stmt(const Stmt &node) override;
+    void end() override;
+
 private:
+    /**
+     * @brief Check if code generation has stopped, with `stop_on_error`.
+     */
+    bool _stopped() const {
+        return _stop_on_error && DiagnosticsEngine::current().has_error();
+    }
+
+    /**
+     * @brief Create the main function, which the variables and statements go
+     * into, unless it has been created.
+     */
+    void _begin_main();
+    void _end_main();
+
     void _visit_func_def(const FuncDef &node);
     void _visit_var_decl(const VarDecl &node);
 
@@ -41,18 +99,97 @@ private:
     void _visit_if_stmt(const IfStmt &node);
     void _visit_to_stmt(const ToStmt &node);
 
-    ValuePtr _visit_exp(const Exp &node);
-    ValuePtr _visit_binary_exp(const BinaryExp &node);
-    ValuePtr _visit_call_exp(const CallExp &node);
-    ValuePtr _visit_unary_exp(const UnaryExp &node);
-    ValuePtr _visit_ident_exp(const IdentExp &node);
-    ValuePtr _visit_number(const Number &node);
+    ValuePtr _visit_exp(const Exp &root);
+    void _expand_exp(const Exp &exp);
+    ValuePtr _finish_exp(const Exp &exp, uint32_t func);
     ValuePtr _visit_cond(const Cond &node);
 
-    std::shared_ptr<SymbolTable> _cur_scope;
+    void _visit_flat_func_def(const FlatAst &ast, const FlatFuncDef &node);
+    void _visit_flat_stmt(const FlatAst &ast, const FlatStmt &node);
+    ValuePtr _visit_flat_exp(const FlatAst &ast, FlatId root);
+    void _expand_flat_exp(const FlatAst &ast, const FlatExp &exp);
+    ValuePtr _finish_flat_exp(const FlatAst &ast, const FlatExp &exp,
+                              uint32_t func);
+    /**
+     * @brief Pop the values of the arguments of a call into `_args`.
+     * @param count The number of arguments that have been visited.
+     */
+    void _pop_args(std::size_t count);
+
+    // The code generation below is shared by both layouts. An identifier
+    // without a slot has an error, which has been reported by `_resolver`,
+    // and the code that uses it is skipped.
+
+    /**
+     * @brief Create a function and allocate its parameters.
+     * @return `false` if the function is redefined.
+     */
+    bool _begin_func_def(const Ident &ident,
+                         const std::vector<const Ident *> &params);
+    void _end_func_def(ValuePtr val);
+    void _gen_var_decl(const Ident &ident);
+    void _gen_get(const Ident &ident);
+    void _gen_tag(const Ident &ident);
+    void _gen_branch(ValuePtr cond, const Ident &ident);
+    void _gen_jump(const Ident &ident);
+
+    /**
+     * @brief Get the state of the symbol of a slot.
+     */
+    struct _Slot;
+    _Slot &_slot(uint32_t slot);
+
+    // These return `nullptr` if any operand is `nullptr`.
+    ValuePtr _gen_binary(BinaryExp::BinaryOp op, ValuePtr left_val,
+                         ValuePtr right_val);
+    ValuePtr _gen_call(uint32_t func, const std::vector<ValuePtr> &values);
+    ValuePtr _gen_unary(decltype(UnaryExp::op) op, ValuePtr exp_val);
+    ValuePtr _gen_load(const Ident &ident);
+    ValuePtr _gen_number(float value);
+    ValuePtr _gen_compare(decltype(Cond::op) op, ValuePtr left_val,
+                          ValuePtr right_val);
+
+    Resolver _resolver;
     ModulePtr _ir_module;
     FunctionPtr _cur_func = nullptr;
     BasicBlockPtr _cur_block = nullptr;
+    bool _in_main = false;
+    bool _stop_on_error = false;
+
+    // What has been generated for each symbol, indexed by slot.
+    struct _Slot {
+        // The alloca of a variable or a parameter, or a function.
+        ValuePtr value = nullptr;
+        // The block of a tag, and the jumps to the tag that have been
+        // generated before it.
+        BasicBlockPtr target = nullptr;
+        std::vector<InstructionPtr> jump_insts;
+    };
+    std::vector<_Slot> _slots;
+
+    // The values of the expression nodes of the current function body or
+    // statement, if `_memoize_exps` is set.
+    bool _memoize_exps = false;
+    std::unordered_map<const Exp *, ValuePtr> _exp_values;
+
+    // The explicit stacks of `_visit_exp` and `_visit_flat_exp`, kept to reuse
+    // their storage.
+    struct _ExpFrame {
+        const Exp *exp;
+        bool expanded;
+        // The slot of the function of a call, `NO_SLOT` otherwise.
+        uint32_t func;
+    };
+    struct _FlatFrame {
+        FlatId id;
+        bool expanded;
+        // The slot of the function of a call, `NO_SLOT` otherwise.
+        uint32_t func;
+    };
+    std::vector<_ExpFrame> _exp_frames;
+    std::vector<_FlatFrame> _flat_frames;
+    std::vector<ValuePtr> _values;
+    std::vector<ValuePtr> _args;
 };
 
 #elif TOLANG_BACKEND == PCODE
@@ -60,21 +197,51 @@ private:
 #include "pcode/PcodeModule.h"
 #include "pcode/PcodeInstruction.h"
 #include "pcode/PcodeInstructions.h"
-#include "pcode/PcodeSymbol.h"
 #include "pcode/PcodeBlock.h"
 #include "ast.h"
+#include "error.h"
+#include "flat_ast.h"
+#include "resolver.h"
 
 #include <string>
+#include <string_view>
 #include <map>
 #include <vector>
 
-class PcodeVisitor {
+class PcodeVisitor : public AstConsumer {
 private:
     PcodeModule &_module;
 
     PcodeBlockPtr _curBlock = nullptr;
 
-    PcodeSymbolTable _symbolTable;
+    bool _inMain = false;
+
+    // Code generation stops at the first error, with `stop_on_error`
+    bool _stopOnError = false;
+
+    bool stopped() const {
+        return _stopOnError && DiagnosticsEngine::current().has_error();
+    }
+
+    // Names are bound to slots by the resolver before code is generated
+    Resolver _resolver;
+
+    // What has been generated for each symbol, indexed by slot. Instructions
+    // refer to the entries of the module, so those are pointed to
+    struct SlotInfo {
+        PcodeVarPtr *variable = nullptr;
+        PcodeFuncPtr *function = nullptr;
+        // The position of a parameter among the arguments, from 1
+        int argument = 0;
+    };
+    std::vector<SlotInfo> _slots;
+
+    SlotInfo &slotOf(const Ident &ident) {
+        if (ident.slot >= _slots.size()) {
+            _slots.resize(_resolver.size());
+        }
+        return _slots[ident.slot];
+    }
 
     void createBlock() {
         if (_curBlock == nullptr) {
@@ -106,8 +273,46 @@ private:
     void visitNumber(const Number &node);
     void visitCond(const Cond &node);
 
+    void visitFlatStmt(const FlatAst &ast, const FlatStmt &node);
+    void visitFlatExp(const FlatAst &ast, FlatId root);
+
+    // Code generation shared by both layouts. Identifiers without a slot
+    // have errors, which the resolver has reported, so the code that uses
+    // them is never run.
+    void beginMain();
+    void beginFunction(const Ident &ident, const std::vector<const Ident *> &params);
+    void endFunction();
+    void genVarDecl(const Ident &ident);
+    void genGet(const Ident &ident);
+    void genPut();
+    void genTag(std::string_view name);
+    void genStore(const Ident &ident);
+    void genJumpIfTrue(std::string_view name);
+    void genJump(std::string_view name);
+    void genBinary(BinaryExp::BinaryOp binaryOp);
+    void genCall(const Ident &ident);
+    void genUnary(decltype(UnaryExp::op) unaryOp);
+    void genLoad(const Ident &ident);
+    void genNumber(float value);
+    void genCompare(decltype(Cond::op) condOp);
+
 public:
     void visit(const CompUnit &node);
+    void visit(FlatAst &ast);
+
+    // Shared expression nodes are generated at each use, but their errors
+    // are reported once
+    void memoize_exps(bool enable) { _resolver.memoize_exps(enable); }
+
+    // A program with errors is not emitted, so its code may be skipped
+    void stop_on_error(bool enable) { _stopOnError = enable; }
+
+    // Streaming interface for `Parser::parse(AstConsumer &)`
+    void begin(const CompUnit &root) override { _resolver.begin(root); }
+    void func_def(const FuncDef &node) override;
+    void var_decl(const VarDecl &node) override;
+    void stmt(const Stmt &node) override;
+    void end() override;
 
     PcodeVisitor(PcodeModule &pm) : _module(pm) {}
 };
@@ -0,0 +1,404 @@
+#include "tolang/ast_cache.h"
+#include "tolang/source.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+
+uint64_t hash_source(std::string_view source) {
+    // FNV-1a over 8-byte words, with the high half folded back in after
+    // each step so that every byte reaches the low bits of the hash
+    constexpr uint64_t PRIME = 0x100000001b3;
+    uint64_t hash = 0xcbf29ce484222325;
+    auto mix = [&](uint64_t word) {
+        hash = (hash ^ word) * PRIME;
+        hash ^= hash >> 32;
+    };
+
+    const char *p = source.data();
+    std::size_t size = source.size();
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        mix(word);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p, size);
+    mix(tail);
+    mix(source.size());
+    return hash;
+}
+
+namespace {
+
+// Bump the version whenever the layout of `FlatAst` changes.
+constexpr char MAGIC[8] = {'T', 'O', 'L', 'A', 'S', 'T', 0, 2};
+
+struct Header {
+    char magic[8];
+    uint64_t hash;
+};
+
+// `Ident` has a vtable and a view of its name, so only its ID is saved.
+struct CachedIdent {
+    SourceLoc loc;
+    NameId id;
+};
+
+constexpr std::size_t ALIGN = 8;
+
+class Writer {
+public:
+    template <typename T> void value(const T &value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        _bytes(&value, sizeof(T));
+    }
+
+    template <typename T> void array(const T *items, std::size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        value(uint64_t(count));
+        _bytes(items, count * sizeof(T));
+    }
+
+    template <typename T> void array(const std::vector<T> &items) {
+        array(items.data(), items.size());
+    }
+
+    const std::string &data() const { return _data; }
+
+private:
+    void _bytes(const void *data, std::size_t size) {
+        _data.append(static_cast<const char *>(data), size);
+        // keep every array 8-byte aligned in the file
+        _data.resize((_data.size() + ALIGN - 1) / ALIGN * ALIGN);
+    }
+
+    std::string _data;
+};
+
+/**
+ * @brief Read what a `Writer` wrote. Every read checks the bounds of the
+ * data, and a failed read fails all later reads.
+ */
+class Reader {
+public:
+    explicit Reader(std::string_view data) : _data(data) {}
+
+    template <typename T> bool value(T &value) {
+        const char *data = _bytes(sizeof(T));
+        if (data != nullptr) {
+            std::memcpy(&value, data, sizeof(T));
+        }
+        return _ok;
+    }
+
+    template <typename T> bool array(std::vector<T> &items) {
+        uint64_t count = 0;
+        if (!value(count) || count > _data.size() / sizeof(T)) {
+            return _ok = false;
+        }
+        const char *data = _bytes(count * sizeof(T));
+        if (data != nullptr) {
+            items.resize(count);
+            std::memcpy(items.data(), data, count * sizeof(T));
+        }
+        return _ok;
+    }
+
+    // Read an array of characters in place, without copying it.
+    bool text(std::string_view &text) {
+        uint64_t size = 0;
+        if (!value(size) || size > _data.size()) {
+            return _ok = false;
+        }
+        const char *data = _bytes(size);
+        if (data != nullptr) {
+            text = std::string_view(data, size);
+        }
+        return _ok;
+    }
+
+    bool at_end() const { return _ok && _data.empty(); }
+
+private:
+    const char *_bytes(std::size_t size) {
+        std::size_t padded = (size + ALIGN - 1) / ALIGN * ALIGN;
+        if (!_ok || padded > _data.size()) {
+            _ok = false;
+            return nullptr;
+        }
+        const char *data = _data.data();
+        _data.remove_prefix(padded);
+        return data;
+    }
+
+    std::string_view _data;
+    bool _ok = true;
+};
+
+// The arrays of a `FlatAst` that are saved as they are, in file order.
+template <typename Ast, typename Fn> void for_each_array(Ast &ast, Fn &&fn) {
+    fn(ast.func_defs);
+    fn(ast.var_decls);
+    fn(ast.stmts);
+    fn(ast.exps);
+    fn(ast.binary_exps);
+    fn(ast.call_exps);
+    fn(ast.unary_exps);
+    fn(ast.ident_exps);
+    fn(ast.numbers);
+    fn(ast.conds);
+    fn(ast.params);
+    fn(ast.args);
+}
+
+/**
+ * @brief Check that every index of a loaded tree is in the bounds of its
+ * array or `FLAT_NONE`, and that every kind and operator is in its range.
+ * @note Expressions must also be in post-order, as `flatten` stores them,
+ * since the walks of a flat tree rely on it to end.
+ */
+bool is_valid(const FlatAst &ast) {
+    auto in = [](FlatId id, std::size_t size) {
+        return id == FLAT_NONE || id < size;
+    };
+    // an operand comes before the expression `id`
+    auto operand = [](FlatId operand, std::size_t id) {
+        return operand == FLAT_NONE || operand < id;
+    };
+    // the range `[first, first + count)` of `params` or `args`
+    auto range = [](uint32_t first, uint32_t count, std::size_t size) {
+        return first <= size && count <= size - first;
+    };
+
+    std::size_t exps = ast.exps.size();
+    std::size_t idents = ast.idents.size();
+    for (std::size_t id = 0; id < exps; id++) {
+        const auto &exp = ast.exps[id];
+        if (exp.first > id) {
+            return false;
+        }
+        switch (exp.kind) {
+        case FlatExp::BINARY: {
+            if (exp.index >= ast.binary_exps.size()) {
+                return false;
+            }
+            const auto &node = ast.binary_exps[exp.index];
+            if (static_cast<unsigned>(node.op) > BinaryExp::MOD ||
+                !operand(node.lhs, id) || !operand(node.rhs, id)) {
+                return false;
+            }
+            break;
+        }
+        case FlatExp::CALL: {
+            if (exp.index >= ast.call_exps.size()) {
+                return false;
+            }
+            const auto &node = ast.call_exps[exp.index];
+            if (!in(node.ident, idents) ||
+                !range(node.first_arg, node.arg_count, ast.args.size())) {
+                return false;
+            }
+            for (uint32_t i = 0; i < node.arg_count; i++) {
+                if (!operand(ast.args[node.first_arg + i], id)) {
+                    return false;
+                }
+            }
+            break;
+        }
+        case FlatExp::UNARY: {
+            if (exp.index >= ast.unary_exps.size()) {
+                return false;
+            }
+            const auto &node = ast.unary_exps[exp.index];
+            if (static_cast<unsigned>(node.op) > UnaryExp::MINU ||
+                !operand(node.exp, id)) {
+                return false;
+            }
+            break;
+        }
+        case FlatExp::IDENT:
+            if (exp.index >= ast.ident_exps.size() ||
+                !in(ast.ident_exps[exp.index].ident, idents)) {
+                return false;
+            }
+            break;
+        case FlatExp::NUMBER:
+            if (exp.index >= ast.numbers.size()) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+
+    for (const auto &node : ast.conds) {
+        if (static_cast<unsigned>(node.op) > Cond::NE ||
+            !in(node.lhs, exps) || !in(node.rhs, exps)) {
+            return false;
+        }
+    }
+
+    for (const auto &node : ast.stmts) {
+        if (static_cast<unsigned>(node.kind) > FlatStmt::TO ||
+            !in(node.ident, idents) ||
+            !in(node.exp, node.kind == FlatStmt::IF ? ast.conds.size()
+                                                    : exps)) {
+            return false;
+        }
+    }
+
+    for (const auto &node : ast.func_defs) {
+        if (!in(node.ident, idents) ||
+            !range(node.first_param, node.param_count, ast.params.size()) ||
+            !in(node.exp, exps)) {
+            return false;
+        }
+    }
+
+    for (const auto &node : ast.var_decls) {
+        if (!in(node.ident, idents)) {
+            return false;
+        }
+    }
+
+    for (auto param : ast.params) {
+        if (!in(param, idents)) {
+            return false;
+        }
+    }
+    for (auto arg : ast.args) {
+        if (!in(arg, exps)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::string AstCache::path(std::string_view source) const {
+    return _path(hash_source(source));
+}
+
+std::string AstCache::_path(uint64_t hash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.tolast",
+                  static_cast<unsigned long long>(hash));
+    return (std::filesystem::path(_dir) / name).string();
+}
+
+std::optional<FlatAst> AstCache::load(std::string_view source) const {
+    uint64_t hash = hash_source(source);
+    SourceBuffer file;
+    try {
+        file = SourceBuffer::map_file(_path(hash));
+    } catch (const std::runtime_error &) {
+        return std::nullopt;
+    }
+    Reader reader(file.view());
+
+    // The hash only names the entry, so the source of the entry has to be
+    // the same too.
+    Header header;
+    std::string_view cached_source;
+    if (!reader.value(header) ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.hash != hash || !reader.text(cached_source) ||
+        cached_source != source) {
+        return std::nullopt;
+    }
+
+    FlatAst ast;
+    for_each_array(ast, [&](auto &items) { reader.array(items); });
+
+    std::vector<CachedIdent> idents;
+    std::vector<uint32_t> lengths;
+    std::vector<char> chars;
+    reader.array(idents);
+    reader.array(lengths);
+    reader.array(chars);
+    if (!reader.at_end()) {
+        return std::nullopt;
+    }
+
+    // names were saved in ID order, so interning them again in a fresh table
+    // gives back the same IDs
+    ast.names = std::make_shared<NameTable>();
+    std::size_t offset = 0;
+    for (auto length : lengths) {
+        if (length > chars.size() - offset) {
+            return std::nullopt;
+        }
+        ast.names->intern(std::string_view(chars.data() + offset, length));
+        offset += length;
+    }
+    if (ast.names->size() != lengths.size()) {
+        return std::nullopt;
+    }
+
+    ast.idents.reserve(idents.size());
+    for (const auto &ident : idents) {
+        if (ident.id >= ast.names->size()) {
+            return std::nullopt;
+        }
+        ast.idents.emplace_back(ident.loc, ident.id,
+                                ast.names->name(ident.id));
+    }
+    if (!is_valid(ast)) {
+        return std::nullopt;
+    }
+
+    ast.lines = std::make_shared<LineTable>(source);
+    return ast;
+}
+
+void AstCache::store(std::string_view source, const FlatAst &ast) const {
+    Writer writer;
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.hash = hash_source(source);
+    writer.value(header);
+    writer.array(source.data(), source.size());
+
+    for_each_array(ast, [&](const auto &items) { writer.array(items); });
+
+    std::vector<CachedIdent> idents;
+    idents.reserve(ast.idents.size());
+    for (const auto &ident : ast.idents) {
+        idents.push_back({ident.loc, ident.id});
+    }
+    writer.array(idents);
+
+    std::vector<uint32_t> lengths;
+    std::string chars;
+    for (NameId id = 0; id < ast.names->size(); id++) {
+        auto name = ast.names->name(id);
+        lengths.push_back(name.size());
+        chars += name;
+    }
+    writer.array(lengths);
+    writer.array(chars.data(), chars.size());
+
+    std::error_code ec;
+    std::filesystem::create_directories(_dir, ec);
+    auto target = _path(header.hash);
+    auto temp = target + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(temp, std::ios::out | std::ios::binary);
+        out.write(writer.data().data(), writer.data().size());
+        if (!out) {
+            std::filesystem::remove(temp, ec);
+            throw std::runtime_error("cannot write file " + temp);
+        }
+    }
+    std::filesystem::rename(temp, target, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        throw std::runtime_error("cannot write file " + target);
+    }
+}
@@ -0,0 +1,567 @@
+#include "tolang/ast_printer.h"
+#include "tolang/utils.h"
+#include <cmath>
+#include <cstdio>
+
+static std::string_view binary_op(const BinaryExp &node) {
+    switch (node.op) {
+    case BinaryExp::PLUS:
+        return "+";
+    case BinaryExp::MINU:
+        return "-";
+    case BinaryExp::MULT:
+        return "*";
+    case BinaryExp::DIV:
+        return "/";
+    case BinaryExp::MOD:
+        return "%";
+    }
+    return "?";
+}
+
+static std::string_view cond_op(const Cond &node) {
+    switch (node.op) {
+    case Cond::LT:
+        return "<";
+    case Cond::GT:
+        return ">";
+    case Cond::LE:
+        return "<=";
+    case Cond::GE:
+        return ">=";
+    case Cond::EQ:
+        return "==";
+    case Cond::NE:
+        return "!=";
+    }
+    return "?";
+}
+
+AstPrinter::AstPrinter(std::ostream &out, AstFormat format)
+    : _out(out), _format(format) {
+    _buffer.reserve(FLUSH_SIZE + FLUSH_SIZE / 4);
+}
+
+void AstPrinter::print(const CompUnit &root) {
+    auto print_nodes = [&](auto &&print_node) {
+        for (auto func_def : root.func_defs) {
+            if (func_def != nullptr) {
+                print_node(*func_def);
+                _end_node();
+            }
+        }
+        for (auto var_decl : root.var_decls) {
+            if (var_decl != nullptr) {
+                print_node(*var_decl);
+                _end_node();
+            }
+        }
+        for (auto stmt : root.stmts) {
+            if (stmt != nullptr) {
+                print_node(*stmt);
+                _end_node();
+            }
+        }
+    };
+
+    switch (_format) {
+    case AstFormat::TEXT:
+        print_nodes([this](const auto &node) { _text(node); });
+        _put("<CompUnit>\n");
+        break;
+    case AstFormat::SEXP:
+        print_nodes([this](const auto &node) {
+            _sexp(node);
+            _put('\n');
+        });
+        break;
+    case AstFormat::JSON:
+        _lines = root.lines.get();
+        print_nodes([this](const auto &node) {
+            _json(node);
+            _put('\n');
+        });
+        break;
+    }
+}
+
+void AstPrinter::flush() {
+    _out.write(_buffer.data(), _buffer.size());
+    _buffer.clear();
+}
+
+void AstPrinter::_put_number(float value) {
+    char text[32];
+    // `TEXT` prints like `std::ostream`, the others exactly
+    int length = std::snprintf(text, sizeof(text),
+                               _format == AstFormat::TEXT ? "%g" : "%.9g",
+                               static_cast<double>(value));
+    if (_format == AstFormat::JSON && !std::isfinite(value)) {
+        // JSON has no infinities, so they are written as strings
+        _put('"');
+        _put(std::string_view(text, length));
+        _put('"');
+        return;
+    }
+    _put(std::string_view(text, length));
+}
+
+void AstPrinter::_end_node() {
+    if (_buffer.size() >= FLUSH_SIZE) {
+        flush();
+    }
+}
+
+void AstPrinter::_exp(const Exp *root) {
+    // The printers of the formats put the beginning of a node, and push the
+    // rest of it, the operands with the text between and after them, so that
+    // deep expressions do not overflow the call stack. The first operand is
+    // returned to be printed right away.
+    _push(root);
+    while (!_items.empty()) {
+        auto item = _items.back();
+        _items.pop_back();
+        if (item.exp == nullptr) {
+            _put(item.text);
+            continue;
+        }
+        for (auto exp = item.exp; exp != nullptr;) {
+            switch (_format) {
+            case AstFormat::TEXT:
+                exp = _text(*exp);
+                break;
+            case AstFormat::SEXP:
+                exp = _sexp(*exp);
+                break;
+            case AstFormat::JSON:
+                exp = _json(*exp);
+                break;
+            }
+        }
+    }
+}
+
+void AstPrinter::_push(const Exp *exp) {
+    if (exp != nullptr) {
+        _items.push_back({exp, {}});
+        return;
+    }
+    // invalid ast
+    switch (_format) {
+    case AstFormat::TEXT:
+        break;
+    case AstFormat::SEXP:
+        _push("()");
+        break;
+    case AstFormat::JSON:
+        _push("null");
+        break;
+    }
+}
+
+const Exp *AstPrinter::_first(const Exp *exp) {
+    if (exp == nullptr) {
+        _push(exp);
+    }
+    return exp;
+}
+
+void AstPrinter::_text(const Ident *ident) {
+    if (ident == nullptr) { // invalid ast
+        return;
+    }
+    _put("IDENFR ");
+    _put(ident->value);
+    _put("\n<Ident>\n");
+}
+
+void AstPrinter::_text(const FuncDef &node) {
+    _put("FN fn\n");
+    _text(node.ident);
+    _put("LPARENT (\n");
+    for (std::size_t i = 0; i < node.func_f_params.size(); i++) {
+        if (i > 0) {
+            _put("COMMA ,\n");
+        }
+        _text(node.func_f_params[i]);
+    }
+    _put("<FuncFParams>\nRPARENT )\nRARROW =>\n");
+    _exp(node.exp);
+    _put("SEMICN ;\n<FuncDef>\n");
+}
+
+void AstPrinter::_text(const VarDecl &node) {
+    _put("VARTK var\n");
+    _text(node.ident);
+    _put("SEMICN ;\n<VarDecl>\n");
+}
+
+void AstPrinter::_text(const Stmt &node) {
+    std::visit(overloaded{
+                   [this](const GetStmt &node) {
+                       _put("GETTK get\n");
+                       _text(node.ident);
+                   },
+                   [this](const PutStmt &node) {
+                       _put("PUTTK put\n");
+                       _exp(node.exp);
+                   },
+                   [this](const TagStmt &node) {
+                       _put("TAGTK tag\n");
+                       _text(node.ident);
+                   },
+                   [this](const LetStmt &node) {
+                       _put("LETTK let\n");
+                       _text(node.ident);
+                       _put("ASSIGN =\n");
+                       _exp(node.exp);
+                   },
+                   [this](const IfStmt &node) {
+                       _put("IFTK if\n");
+                       if (node.cond != nullptr) {
+                           _text(*node.cond);
+                       }
+                       _put("TOTK to\n");
+                       _text(node.ident);
+                   },
+                   [this](const ToStmt &node) {
+                       _put("TOTK to\n");
+                       _text(node.ident);
+                   },
+               },
+               node);
+    _put("SEMICN ;\n<Stmt>\n");
+}
+
+void AstPrinter::_text(const Cond &node) {
+    static const std::string_view tokens[] = {
+        "LSS <\n", "GRE >\n", "LEQ <=\n", "GEQ >=\n", "EQL ==\n", "NEQ !=\n",
+    };
+    _exp(node.lhs);
+    _put(tokens[node.op]);
+    _exp(node.rhs);
+    _put("<Cond>\n");
+}
+
+const Exp *AstPrinter::_text(const Exp &exp) {
+    // the rest of a node is pushed in reverse
+    return std::visit(
+        overloaded{
+            [this](const BinaryExp &node) {
+                static const std::string_view tokens[] = {
+                    "PLUS +\n", "MINU -\n", "MULT *\n", "DIV /\n", "MOD %\n",
+                };
+                _push(node.op == BinaryExp::PLUS || node.op == BinaryExp::MINU
+                          ? "<AddExp>\n"
+                          : "<MulExp>\n");
+                if (node.rhs != nullptr) {
+                    _push(node.rhs);
+                    _push(tokens[node.op]);
+                }
+                return _first(node.lhs);
+            },
+            [this](const CallExp &node) {
+                _text(node.ident);
+                _put("LPARENT (\n");
+                _push("<FuncRParams>\nRPARENT )\n<CallExp>\n");
+                const auto &args = node.func_r_params;
+                for (auto i = args.size(); i > 1; i--) {
+                    _push(args[i - 1]);
+                    _push("COMMA ,\n");
+                }
+                return args.size() > 0 ? _first(args[0]) : nullptr;
+            },
+            [this](const UnaryExp &node) {
+                // like `Node::print`, only the parentheses of a binary
+                // operand are printed, and not the operator
+                bool parens = node.exp != nullptr &&
+                              std::holds_alternative<BinaryExp>(*node.exp);
+                if (parens) {
+                    _put("LPARENT (\n");
+                }
+                _push("<UnaryExp>\n");
+                if (parens) {
+                    _push("RPARENT )\n");
+                }
+                return _first(node.exp);
+            },
+            [this](const IdentExp &node) -> const Exp * {
+                _text(node.ident);
+                return nullptr;
+            },
+            [this](const Number &node) -> const Exp * {
+                _put("Number ");
+                _put_number(node.value);
+                _put("\n<Number>\n");
+                return nullptr;
+            },
+        },
+        exp);
+}
+
+void AstPrinter::_sexp(const Ident *ident) {
+    _put(ident != nullptr ? ident->value : "()");
+}
+
+void AstPrinter::_sexp(const FuncDef &node) {
+    _put("(fn ");
+    _sexp(node.ident);
+    _put(" (");
+    for (std::size_t i = 0; i < node.func_f_params.size(); i++) {
+        if (i > 0) {
+            _put(' ');
+        }
+        _sexp(node.func_f_params[i]);
+    }
+    _put(") ");
+    _exp(node.exp);
+    _put(')');
+}
+
+void AstPrinter::_sexp(const VarDecl &node) {
+    _put("(var ");
+    _sexp(node.ident);
+    _put(')');
+}
+
+void AstPrinter::_sexp(const Stmt &node) {
+    std::visit(overloaded{
+                   [this](const GetStmt &node) {
+                       _put("(get ");
+                       _sexp(node.ident);
+                   },
+                   [this](const PutStmt &node) {
+                       _put("(put ");
+                       _exp(node.exp);
+                   },
+                   [this](const TagStmt &node) {
+                       _put("(tag ");
+                       _sexp(node.ident);
+                   },
+                   [this](const LetStmt &node) {
+                       _put("(let ");
+                       _sexp(node.ident);
+                       _put(' ');
+                       _exp(node.exp);
+                   },
+                   [this](const IfStmt &node) {
+                       _put("(if ");
+                       if (node.cond != nullptr) {
+                           _sexp(*node.cond);
+                       } else {
+                           _put("()");
+                       }
+                       _put(' ');
+                       _sexp(node.ident);
+                   },
+                   [this](const ToStmt &node) {
+                       _put("(to ");
+                       _sexp(node.ident);
+                   },
+               },
+               node);
+    _put(')');
+}
+
+void AstPrinter::_sexp(const Cond &node) {
+    _put('(');
+    _put(cond_op(node));
+    _put(' ');
+    _exp(node.lhs);
+    _put(' ');
+    _exp(node.rhs);
+    _put(')');
+}
+
+const Exp *AstPrinter::_sexp(const Exp &exp) {
+    return std::visit(
+        overloaded{
+            [this](const BinaryExp &node) {
+                _put('(');
+                _put(binary_op(node));
+                _put(' ');
+                _push(")");
+                _push(node.rhs);
+                _push(" ");
+                return _first(node.lhs);
+            },
+            [this](const CallExp &node) -> const Exp * {
+                _put("(call ");
+                _sexp(node.ident);
+                _push(")");
+                const auto &args = node.func_r_params;
+                for (auto i = args.size(); i > 1; i--) {
+                    _push(args[i - 1]);
+                    _push(" ");
+                }
+                if (args.size() == 0) {
+                    return nullptr;
+                }
+                _put(' ');
+                return _first(args[0]);
+            },
+            [this](const UnaryExp &node) {
+                _put(node.op == UnaryExp::PLUS ? "(+ " : "(- ");
+                _push(")");
+                return _first(node.exp);
+            },
+            [this](const IdentExp &node) -> const Exp * {
+                _sexp(node.ident);
+                return nullptr;
+            },
+            [this](const Number &node) -> const Exp * {
+                _put_number(node.value);
+                return nullptr;
+            },
+        },
+        exp);
+}
+
+void AstPrinter::_json_line(SourceLoc loc) {
+    _put(",\"line\":");
+    _put(std::to_string(_lines->line(loc)));
+}
+
+void AstPrinter::_json(const Ident *ident) {
+    if (ident == nullptr) { // invalid ast
+        _put("null");
+        return;
+    }
+    // identifiers are letters, digits and `_`, so they need no escaping
+    _put('"');
+    _put(ident->value);
+    _put('"');
+}
+
+void AstPrinter::_json(const FuncDef &node) {
+    _put("{\"kind\":\"fn\"");
+    _json_line(node.loc);
+    _put(",\"name\":");
+    _json(node.ident);
+    _put(",\"params\":[");
+    for (std::size_t i = 0; i < node.func_f_params.size(); i++) {
+        if (i > 0) {
+            _put(',');
+        }
+        _json(node.func_f_params[i]);
+    }
+    _put("],\"exp\":");
+    _exp(node.exp);
+    _put('}');
+}
+
+void AstPrinter::_json(const VarDecl &node) {
+    _put("{\"kind\":\"var\"");
+    _json_line(node.loc);
+    _put(",\"name\":");
+    _json(node.ident);
+    _put('}');
+}
+
+void AstPrinter::_json(const Stmt &node) {
+    std::visit(overloaded{
+                   [this](const GetStmt &node) {
+                       _put("{\"kind\":\"get\"");
+                       _json_line(node.loc);
+                       _put(",\"name\":");
+                       _json(node.ident);
+                   },
+                   [this](const PutStmt &node) {
+                       _put("{\"kind\":\"put\"");
+                       _json_line(node.loc);
+                       _put(",\"exp\":");
+                       _exp(node.exp);
+                   },
+                   [this](const TagStmt &node) {
+                       _put("{\"kind\":\"tag\"");
+                       _json_line(node.loc);
+                       _put(",\"name\":");
+                       _json(node.ident);
+                   },
+                   [this](const LetStmt &node) {
+                       _put("{\"kind\":\"let\"");
+                       _json_line(node.loc);
+                       _put(",\"name\":");
+                       _json(node.ident);
+                       _put(",\"exp\":");
+                       _exp(node.exp);
+                   },
+                   [this](const IfStmt &node) {
+                       _put("{\"kind\":\"if\"");
+                       _json_line(node.loc);
+                       _put(",\"cond\":");
+                       if (node.cond != nullptr) {
+                           _json(*node.cond);
+                       } else {
+                           _put("null");
+                       }
+                       _put(",\"to\":");
+                       _json(node.ident);
+                   },
+                   [this](const ToStmt &node) {
+                       _put("{\"kind\":\"to\"");
+                       _json_line(node.loc);
+                       _put(",\"name\":");
+                       _json(node.ident);
+                   },
+               },
+               node);
+    _put('}');
+}
+
+void AstPrinter::_json(const Cond &node) {
+    _put("{\"op\":\"");
+    _put(cond_op(node));
+    _put("\",\"lhs\":");
+    _exp(node.lhs);
+    _put(",\"rhs\":");
+    _exp(node.rhs);
+    _put('}');
+}
+
+const Exp *AstPrinter::_json(const Exp &exp) {
+    return std::visit(
+        overloaded{
+            [this](const BinaryExp &node) {
+                _put("{\"kind\":\"binary\",\"op\":\"");
+                _put(binary_op(node));
+                _put("\",\"lhs\":");
+                _push("}");
+                _push(node.rhs);
+                _push(",\"rhs\":");
+                return _first(node.lhs);
+            },
+            [this](const CallExp &node) {
+                _put("{\"kind\":\"call\",\"name\":");
+                _json(node.ident);
+                _put(",\"args\":[");
+                _push("]}");
+                const auto &args = node.func_r_params;
+                for (auto i = args.size(); i > 1; i--) {
+                    _push(args[i - 1]);
+                    _push(",");
+                }
+                return args.size() > 0 ? _first(args[0]) : nullptr;
+            },
+            [this](const UnaryExp &node) {
+                _put(node.op == UnaryExp::PLUS
+                         ? "{\"kind\":\"unary\",\"op\":\"+\",\"exp\":"
+                         : "{\"kind\":\"unary\",\"op\":\"-\",\"exp\":");
+                _push("}");
+                return _first(node.exp);
+            },
+            [this](const IdentExp &node) -> const Exp * {
+                _put("{\"kind\":\"ident\",\"name\":");
+                _json(node.ident);
+                _put('}');
+                return nullptr;
+            },
+            [this](const Number &node) -> const Exp * {
+                _put("{\"kind\":\"number\",\"value\":");
+                _put_number(node.value);
+                _put('}');
+                return nullptr;
+            },
+        },
+        exp);
+}
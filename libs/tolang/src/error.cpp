@@ -0,0 +1,50 @@
+#include "tolang/error.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// The engine of the innermost `DiagnosticsScope` of each thread.
+thread_local DiagnosticsEngine *current_engine = nullptr;
+
+} // namespace
+
+DiagnosticsEngine &DiagnosticsEngine::current() {
+    if (current_engine != nullptr) {
+        return *current_engine;
+    }
+    thread_local DiagnosticsEngine default_engine;
+    return default_engine;
+}
+
+void DiagnosticsEngine::merge(DiagnosticsEngine &other) {
+    if (_errors.empty()) {
+        _errors = std::move(other._errors);
+    } else {
+        _errors.insert(_errors.end(),
+                       std::make_move_iterator(other._errors.begin()),
+                       std::make_move_iterator(other._errors.end()));
+    }
+    if (limit_reached()) {
+        _errors.erase(_errors.begin() + _error_limit, _errors.end());
+    }
+    other._errors.clear();
+}
+
+void DiagnosticsEngine::dump(std::ostream &out, const LineTable &lines) {
+    std::stable_sort(
+        _errors.begin(), _errors.end(),
+        [](const Error &a, const Error &b) { return a.loc < b.loc; });
+
+    for (const auto &err : _errors) {
+        auto pos = lines.line_column(err.loc);
+        out << pos.line << ":" << pos.column << ": " << err.msg << std::endl;
+    }
+}
+
+DiagnosticsScope::DiagnosticsScope(DiagnosticsEngine &engine)
+    : _previous(current_engine) {
+    current_engine = &engine;
+}
+
+DiagnosticsScope::~DiagnosticsScope() { current_engine = _previous; }
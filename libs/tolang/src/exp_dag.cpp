@@ -0,0 +1,193 @@
+#include "tolang/exp_dag.h"
+#include "tolang/utils.h"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Hash a node by its kind, its operator and the identity of its
+ * operands, without looking into the operands.
+ */
+struct ShallowHash {
+    std::size_t operator()(const Exp *exp) const {
+        std::size_t hash = exp->index();
+        auto mix = [&hash](std::size_t value) {
+            hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+        };
+        auto ptr = [](const void *ptr) {
+            return std::hash<const void *>()(ptr);
+        };
+        std::visit(overloaded{
+                       [&](const BinaryExp &node) {
+                           mix(node.op);
+                           mix(ptr(node.lhs));
+                           mix(ptr(node.rhs));
+                       },
+                       [&](const CallExp &node) {
+                           mix(node.ident != nullptr ? node.ident->id : -1);
+                           for (auto arg : node.func_r_params) {
+                               mix(ptr(arg));
+                           }
+                       },
+                       [&](const UnaryExp &node) {
+                           mix(node.op);
+                           mix(ptr(node.exp));
+                       },
+                       [&](const IdentExp &node) {
+                           mix(node.ident != nullptr ? node.ident->id : -1);
+                       },
+                       [&](const Number &node) {
+                           uint32_t bits;
+                           std::memcpy(&bits, &node.value, sizeof(bits));
+                           mix(bits);
+                       },
+                   },
+                   *exp);
+        return hash;
+    }
+};
+
+static bool same_name(const Ident *a, const Ident *b) {
+    if (a == nullptr || b == nullptr) {
+        return a == b;
+    }
+    return a->id == b->id;
+}
+
+/**
+ * @brief Compare two nodes like `ShallowHash` hashes them. Numbers are
+ * compared bit for bit, so that `0` and `-0` stay apart.
+ */
+struct ShallowEqual {
+    bool operator()(const Exp *a, const Exp *b) const {
+        if (a->index() != b->index()) {
+            return false;
+        }
+        return std::visit(
+            overloaded{
+                [&](const BinaryExp &node) {
+                    auto &other = std::get<BinaryExp>(*b);
+                    return node.op == other.op && node.lhs == other.lhs &&
+                           node.rhs == other.rhs;
+                },
+                [&](const CallExp &node) {
+                    auto &other = std::get<CallExp>(*b);
+                    return same_name(node.ident, other.ident) &&
+                           std::equal(node.func_r_params.begin(),
+                                      node.func_r_params.end(),
+                                      other.func_r_params.begin(),
+                                      other.func_r_params.end());
+                },
+                [&](const UnaryExp &node) {
+                    auto &other = std::get<UnaryExp>(*b);
+                    return node.op == other.op && node.exp == other.exp;
+                },
+                [&](const IdentExp &node) {
+                    return same_name(node.ident,
+                                     std::get<IdentExp>(*b).ident);
+                },
+                [&](const Number &node) {
+                    float value = std::get<Number>(*b).value;
+                    return std::memcmp(&node.value, &value, sizeof(value)) ==
+                           0;
+                },
+            },
+            *a);
+    }
+};
+
+class ExpSharer {
+public:
+    /**
+     * @brief Share the nodes of the expressions in `slots`, which may refer to
+     * each other's nodes but not to those of any other call.
+     */
+    void share(std::initializer_list<Exp **> slots) {
+        _nodes.clear();
+        for (auto slot : slots) {
+            _share(slot);
+        }
+        stats.nodes_after += _nodes.size();
+    }
+
+    ShareStats stats;
+
+private:
+    struct Frame {
+        Exp **slot;
+        bool expanded;
+    };
+
+    void _share(Exp **root) {
+        _frames.push_back({root, false});
+        while (!_frames.empty()) {
+            Frame &frame = _frames.back();
+            Exp **slot = frame.slot;
+            if (*slot == nullptr) { // invalid ast
+                _frames.pop_back();
+                continue;
+            }
+            if (!frame.expanded) {
+                frame.expanded = true;
+                stats.nodes_before++;
+                std::visit(overloaded{
+                               [this](BinaryExp &node) {
+                                   _frames.push_back({&node.lhs, false});
+                                   _frames.push_back({&node.rhs, false});
+                               },
+                               [this](CallExp &node) {
+                                   for (auto &arg : node.func_r_params) {
+                                       _frames.push_back({&arg, false});
+                                   }
+                               },
+                               [this](UnaryExp &node) {
+                                   _frames.push_back({&node.exp, false});
+                               },
+                               [](IdentExp &) {},
+                               [](Number &) {},
+                           },
+                           **slot);
+                continue;
+            }
+            _frames.pop_back();
+
+            // the operands are shared already, so the node is equal to
+            // another exactly if their operands are the same nodes
+            *slot = *_nodes.insert(*slot).first;
+        }
+    }
+
+    std::unordered_set<Exp *, ShallowHash, ShallowEqual> _nodes;
+    std::vector<Frame> _frames;
+};
+
+} // namespace
+
+ShareStats share_exps(CompUnit &root) {
+    ExpSharer sharer;
+    for (auto func_def : root.func_defs) {
+        sharer.share({&func_def->exp});
+    }
+    for (auto stmt : root.stmts) {
+        if (stmt == nullptr) { // invalid ast
+            continue;
+        }
+        std::visit(overloaded{
+                       [&](PutStmt &node) { sharer.share({&node.exp}); },
+                       [&](LetStmt &node) { sharer.share({&node.exp}); },
+                       [&](IfStmt &node) {
+                           if (node.cond != nullptr) {
+                               sharer.share(
+                                   {&node.cond->lhs, &node.cond->rhs});
+                           }
+                       },
+                       [](auto &) {},
+                   },
+                   *stmt);
+    }
+    return sharer.stats;
+}
@@ -0,0 +1,349 @@
+#include "tolang/flat_ast.h"
+#include "tolang/utils.h"
+#include <type_traits>
+
+namespace {
+
+/**
+ * @brief Append the nodes of a tree to a `FlatAst`, walking expressions with
+ * an explicit stack instead of recursion.
+ */
+class Flattener {
+public:
+    explicit Flattener(FlatAst &ast) : _ast(ast) {}
+
+    FlatId ident(const Ident *ident) {
+        if (ident == nullptr) {
+            return FLAT_NONE;
+        }
+        _ast.idents.push_back(*ident);
+        return _ast.idents.size() - 1;
+    }
+
+    FlatId exp(const Exp *root) {
+        _frames.push_back({root, false, 0});
+        while (!_frames.empty()) {
+            Frame &frame = _frames.back();
+            if (frame.exp == nullptr) { // invalid ast
+                _frames.pop_back();
+                _ids.push_back(FLAT_NONE);
+                continue;
+            }
+            if (!frame.expanded) {
+                // push the children in reverse, so that they are finished
+                // from left to right
+                frame.expanded = true;
+                frame.first = _ast.exps.size();
+                _expand(*frame.exp);
+                continue;
+            }
+            Frame done = frame;
+            _frames.pop_back();
+            _ids.push_back(_finish(done));
+        }
+        FlatId id = _ids.back();
+        _ids.pop_back();
+        return id;
+    }
+
+    FlatId cond(const Cond *cond) {
+        if (cond == nullptr) { // invalid ast
+            return FLAT_NONE;
+        }
+        FlatId lhs = exp(cond->lhs);
+        FlatId rhs = exp(cond->rhs);
+        _ast.conds.push_back({cond->loc, cond->op, lhs, rhs});
+        return _ast.conds.size() - 1;
+    }
+
+private:
+    struct Frame {
+        const Exp *exp;
+        bool expanded;
+        // The first node of the subtree, once the frame is expanded.
+        FlatId first;
+    };
+
+    void _push(const Exp *exp) { _frames.push_back({exp, false, 0}); }
+
+    void _expand(const Exp &exp) {
+        std::visit(overloaded{
+                       [this](const BinaryExp &node) {
+                           _push(node.rhs);
+                           _push(node.lhs);
+                       },
+                       [this](const CallExp &node) {
+                           for (auto i = node.func_r_params.size(); i > 0;
+                                i--) {
+                               _push(node.func_r_params[i - 1]);
+                           }
+                       },
+                       [this](const UnaryExp &node) { _push(node.exp); },
+                       [](const IdentExp &) {},
+                       [](const Number &) {},
+                   },
+                   exp);
+    }
+
+    FlatId _pop_id() {
+        FlatId id = _ids.back();
+        _ids.pop_back();
+        return id;
+    }
+
+    FlatId _finish(const Frame &frame) {
+        FlatExp flat = std::visit(
+            overloaded{
+                [this, &frame](const BinaryExp &node) {
+                    FlatId rhs = _pop_id();
+                    FlatId lhs = _pop_id();
+                    _ast.binary_exps.push_back({node.loc, node.op, lhs, rhs});
+                    return FlatExp{FlatExp::BINARY,
+                                   FlatId(_ast.binary_exps.size() - 1),
+                                   frame.first};
+                },
+                [this, &frame](const CallExp &node) {
+                    uint32_t count = node.func_r_params.size();
+                    uint32_t first = _ast.args.size();
+                    _ast.args.insert(_ast.args.end(), _ids.end() - count,
+                                     _ids.end());
+                    _ids.resize(_ids.size() - count);
+                    _ast.call_exps.push_back(
+                        {node.loc, ident(node.ident), first, count});
+                    return FlatExp{FlatExp::CALL,
+                                   FlatId(_ast.call_exps.size() - 1),
+                                   frame.first};
+                },
+                [this, &frame](const UnaryExp &node) {
+                    _ast.unary_exps.push_back({node.loc, node.op, _pop_id()});
+                    return FlatExp{FlatExp::UNARY,
+                                   FlatId(_ast.unary_exps.size() - 1),
+                                   frame.first};
+                },
+                [this, &frame](const IdentExp &node) {
+                    _ast.ident_exps.push_back({node.loc, ident(node.ident)});
+                    return FlatExp{FlatExp::IDENT,
+                                   FlatId(_ast.ident_exps.size() - 1),
+                                   frame.first};
+                },
+                [this, &frame](const Number &node) {
+                    _ast.numbers.push_back({node.loc, node.value});
+                    return FlatExp{FlatExp::NUMBER,
+                                   FlatId(_ast.numbers.size() - 1),
+                                   frame.first};
+                },
+            },
+            *frame.exp);
+        _ast.exps.push_back(flat);
+        return _ast.exps.size() - 1;
+    }
+
+    FlatAst &_ast;
+    std::vector<Frame> _frames;
+    // The finished subtrees whose parents are not finished yet.
+    std::vector<FlatId> _ids;
+};
+
+} // namespace
+
+FlatAst flatten(const CompUnit &root) {
+    FlatAst ast;
+    ast.names = root.names;
+    ast.lines = root.lines;
+    Flattener flattener(ast);
+
+    for (const auto &func_def : root.func_defs) {
+        FlatFuncDef flat;
+        flat.loc = func_def->loc;
+        flat.ident = flattener.ident(func_def->ident);
+        flat.first_param = ast.params.size();
+        flat.param_count = func_def->func_f_params.size();
+        for (const auto &param : func_def->func_f_params) {
+            ast.params.push_back(flattener.ident(param));
+        }
+        flat.exp = flattener.exp(func_def->exp);
+        ast.func_defs.push_back(flat);
+    }
+
+    for (const auto &var_decl : root.var_decls) {
+        ast.var_decls.push_back(
+            {var_decl->loc, flattener.ident(var_decl->ident)});
+    }
+
+    for (const auto &stmt : root.stmts) {
+        if (stmt == nullptr) { // invalid ast
+            continue;
+        }
+        ast.stmts.push_back(std::visit(
+            overloaded{
+                [&](const GetStmt &node) {
+                    return FlatStmt{FlatStmt::GET, node.loc,
+                                    flattener.ident(node.ident), FLAT_NONE};
+                },
+                [&](const PutStmt &node) {
+                    return FlatStmt{FlatStmt::PUT, node.loc, FLAT_NONE,
+                                    flattener.exp(node.exp)};
+                },
+                [&](const TagStmt &node) {
+                    return FlatStmt{FlatStmt::TAG, node.loc,
+                                    flattener.ident(node.ident), FLAT_NONE};
+                },
+                [&](const LetStmt &node) {
+                    FlatId ident = flattener.ident(node.ident);
+                    return FlatStmt{FlatStmt::LET, node.loc, ident,
+                                    flattener.exp(node.exp)};
+                },
+                [&](const IfStmt &node) {
+                    FlatId cond = flattener.cond(node.cond);
+                    return FlatStmt{FlatStmt::IF, node.loc,
+                                    flattener.ident(node.ident), cond};
+                },
+                [&](const ToStmt &node) {
+                    return FlatStmt{FlatStmt::TO, node.loc,
+                                    flattener.ident(node.ident), FLAT_NONE};
+                },
+            },
+            *stmt));
+    }
+
+    return ast;
+}
+
+std::unique_ptr<CompUnit> unflatten(const FlatAst &ast) {
+    auto root = std::make_unique<CompUnit>();
+    root->names = ast.names;
+    root->lines = ast.lines;
+    Arena &arena = root->arena;
+
+    std::vector<Ident *> idents;
+    idents.reserve(ast.idents.size());
+    for (const auto &ident : ast.idents) {
+        idents.push_back(arena.make<Ident>(ident));
+    }
+    auto ident = [&](FlatId id) {
+        return id != FLAT_NONE ? idents[id] : nullptr;
+    };
+
+    std::vector<Exp *> exps;
+    exps.reserve(ast.exps.size());
+    auto exp = [&](FlatId id) { return id != FLAT_NONE ? exps[id] : nullptr; };
+    std::vector<Exp *> args;
+    for (const auto &flat : ast.exps) {
+        switch (flat.kind) {
+        case FlatExp::BINARY: {
+            const auto &node = ast.binary_exps[flat.index];
+            BinaryExp binary_exp(node.op, exp(node.lhs), exp(node.rhs));
+            binary_exp.loc = node.loc;
+            exps.push_back(arena.make<Exp>(std::move(binary_exp)));
+            break;
+        }
+        case FlatExp::CALL: {
+            const auto &node = ast.call_exps[flat.index];
+            CallExp call_exp;
+            call_exp.loc = node.loc;
+            call_exp.ident = ident(node.ident);
+            args.clear();
+            for (uint32_t i = 0; i < node.arg_count; i++) {
+                args.push_back(exp(ast.args[node.first_arg + i]));
+            }
+            call_exp.func_r_params = arena.make_array(args.begin(), args.end());
+            exps.push_back(arena.make<Exp>(std::move(call_exp)));
+            break;
+        }
+        case FlatExp::UNARY: {
+            const auto &node = ast.unary_exps[flat.index];
+            UnaryExp unary_exp;
+            unary_exp.loc = node.loc;
+            unary_exp.op = node.op;
+            unary_exp.exp = exp(node.exp);
+            exps.push_back(arena.make<Exp>(std::move(unary_exp)));
+            break;
+        }
+        case FlatExp::IDENT: {
+            const auto &node = ast.ident_exps[flat.index];
+            IdentExp ident_exp;
+            ident_exp.loc = node.loc;
+            ident_exp.ident = ident(node.ident);
+            exps.push_back(arena.make<Exp>(std::move(ident_exp)));
+            break;
+        }
+        case FlatExp::NUMBER: {
+            const auto &node = ast.numbers[flat.index];
+            Number number;
+            number.loc = node.loc;
+            number.value = node.value;
+            exps.push_back(arena.make<Exp>(std::move(number)));
+            break;
+        }
+        }
+    }
+
+    for (const auto &flat : ast.func_defs) {
+        auto func_def = arena.make<FuncDef>();
+        func_def->loc = flat.loc;
+        func_def->ident = ident(flat.ident);
+        std::vector<Ident *> params;
+        for (uint32_t i = 0; i < flat.param_count; i++) {
+            params.push_back(ident(ast.params[flat.first_param + i]));
+        }
+        func_def->func_f_params =
+            arena.make_array(params.begin(), params.end());
+        func_def->exp = exp(flat.exp);
+        root->func_defs.push_back(func_def);
+    }
+
+    for (const auto &flat : ast.var_decls) {
+        auto var_decl = arena.make<VarDecl>();
+        var_decl->loc = flat.loc;
+        var_decl->ident = ident(flat.ident);
+        root->var_decls.push_back(var_decl);
+    }
+
+    // every kind of statement has an identifier, an expression or both
+    auto make_stmt = [&](auto node, const FlatStmt &flat) {
+        node.loc = flat.loc;
+        if constexpr (std::is_same_v<decltype(node), PutStmt>) {
+            node.exp = exp(flat.exp);
+        } else if constexpr (std::is_same_v<decltype(node), LetStmt>) {
+            node.ident = ident(flat.ident);
+            node.exp = exp(flat.exp);
+        } else {
+            node.ident = ident(flat.ident);
+        }
+        return arena.make<Stmt>(std::move(node));
+    };
+    for (const auto &flat : ast.stmts) {
+        switch (flat.kind) {
+        case FlatStmt::GET:
+            root->stmts.push_back(make_stmt(GetStmt(), flat));
+            break;
+        case FlatStmt::PUT:
+            root->stmts.push_back(make_stmt(PutStmt(), flat));
+            break;
+        case FlatStmt::TAG:
+            root->stmts.push_back(make_stmt(TagStmt(), flat));
+            break;
+        case FlatStmt::LET:
+            root->stmts.push_back(make_stmt(LetStmt(), flat));
+            break;
+        case FlatStmt::IF: {
+            IfStmt if_stmt;
+            if (flat.exp != FLAT_NONE) {
+                const auto &node = ast.conds[flat.exp];
+                if_stmt.cond = arena.make<Cond>();
+                if_stmt.cond->loc = node.loc;
+                if_stmt.cond->lhs = exp(node.lhs);
+                if_stmt.cond->op = node.op;
+                if_stmt.cond->rhs = exp(node.rhs);
+            }
+            root->stmts.push_back(make_stmt(if_stmt, flat));
+            break;
+        }
+        case FlatStmt::TO:
+            root->stmts.push_back(make_stmt(ToStmt(), flat));
+            break;
+        }
+    }
+
+    return root;
+}
@@ -0,0 +1,180 @@
+#include "tolang/fold.h"
+#include "tolang/utils.h"
+#include <cmath>
+#include <vector>
+
+static const Number *as_number(const Exp *exp) {
+    return exp != nullptr ? std::get_if<Number>(exp) : nullptr;
+}
+
+/**
+ * @brief Check if `exp` is the number `value`, telling `0` and `-0` apart.
+ */
+static bool is_number(const Exp *exp, float value) {
+    auto number = as_number(exp);
+    return number != nullptr && number->value == value &&
+           std::signbit(number->value) == std::signbit(value);
+}
+
+static void replace_with_number(Exp &exp, SourceLoc loc, float value) {
+    Number number;
+    number.loc = loc;
+    number.value = value;
+    exp = number;
+}
+
+static void fold_binary(Exp &exp, const BinaryExp &node) {
+    auto lhs = as_number(node.lhs);
+    auto rhs = as_number(node.rhs);
+    if (lhs != nullptr && rhs != nullptr) {
+        float value;
+        switch (node.op) {
+        case BinaryExp::PLUS:
+            value = lhs->value + rhs->value;
+            break;
+        case BinaryExp::MINU:
+            value = lhs->value - rhs->value;
+            break;
+        case BinaryExp::MULT:
+            value = lhs->value * rhs->value;
+            break;
+        case BinaryExp::DIV:
+            value = lhs->value / rhs->value;
+            break;
+        default:
+            return;
+        }
+        // leave a division by zero to run time
+        if (std::isfinite(value)) {
+            replace_with_number(exp, node.loc, value);
+        }
+        return;
+    }
+
+    const Exp *operand = nullptr;
+    switch (node.op) {
+    case BinaryExp::PLUS:
+        operand = is_number(node.rhs, -0.0f)   ? node.lhs
+                  : is_number(node.lhs, -0.0f) ? node.rhs
+                                               : nullptr;
+        break;
+    case BinaryExp::MINU:
+        operand = is_number(node.rhs, 0.0f) ? node.lhs : nullptr;
+        break;
+    case BinaryExp::MULT:
+        operand = is_number(node.rhs, 1.0f)   ? node.lhs
+                  : is_number(node.lhs, 1.0f) ? node.rhs
+                                              : nullptr;
+        break;
+    case BinaryExp::DIV:
+        operand = is_number(node.rhs, 1.0f) ? node.lhs : nullptr;
+        break;
+    default:
+        break;
+    }
+    if (operand != nullptr) {
+        exp = *operand;
+    }
+}
+
+static void fold_unary(Exp &exp, const UnaryExp &node) {
+    if (node.exp == nullptr) { // invalid ast
+        return;
+    }
+    if (node.op == UnaryExp::PLUS) {
+        exp = *node.exp;
+        return;
+    }
+    if (auto number = as_number(node.exp)) {
+        replace_with_number(exp, node.loc, -number->value);
+        return;
+    }
+    // `+` has been dropped from the operand already, so `-+-x` is caught too
+    auto inner = std::get_if<UnaryExp>(node.exp);
+    if (inner != nullptr && inner->op == UnaryExp::MINU &&
+        inner->exp != nullptr) {
+        exp = *inner->exp;
+    }
+}
+
+void fold(Exp *root) {
+    // Fold in post-order, so that an expression sees its operands folded.
+    struct Frame {
+        Exp *exp;
+        bool expanded;
+    };
+    std::vector<Frame> frames{{root, false}};
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        Exp *exp = frame.exp;
+        if (exp == nullptr) { // invalid ast
+            frames.pop_back();
+            continue;
+        }
+        if (!frame.expanded) {
+            frame.expanded = true;
+            std::visit(overloaded{
+                           [&](const BinaryExp &node) {
+                               frames.push_back({node.lhs, false});
+                               frames.push_back({node.rhs, false});
+                           },
+                           [&](const CallExp &node) {
+                               for (auto arg : node.func_r_params) {
+                                   frames.push_back({arg, false});
+                               }
+                           },
+                           [&](const UnaryExp &node) {
+                               frames.push_back({node.exp, false});
+                           },
+                           [](const IdentExp &) {},
+                           [](const Number &) {},
+                       },
+                       *exp);
+            continue;
+        }
+        frames.pop_back();
+
+        // the node is copied, since `exp` is overwritten by the fold
+        if (auto binary = std::get_if<BinaryExp>(exp)) {
+            fold_binary(*exp, BinaryExp(*binary));
+        } else if (auto unary = std::get_if<UnaryExp>(exp)) {
+            fold_unary(*exp, UnaryExp(*unary));
+        }
+    }
+}
+
+static void fold_stmt(const Stmt &stmt) {
+    std::visit(overloaded{
+                   [](const PutStmt &node) { fold(node.exp); },
+                   [](const LetStmt &node) { fold(node.exp); },
+                   [](const IfStmt &node) {
+                       if (node.cond != nullptr) {
+                           fold(node.cond->lhs);
+                           fold(node.cond->rhs);
+                       }
+                   },
+                   [](const auto &) {},
+               },
+               stmt);
+}
+
+void fold(CompUnit &root) {
+    for (auto func_def : root.func_defs) {
+        fold(func_def->exp);
+    }
+    for (auto stmt : root.stmts) {
+        if (stmt != nullptr) {
+            fold_stmt(*stmt);
+        }
+    }
+}
+
+void FoldingConsumer::func_def(const FuncDef &node) {
+    fold(node.exp);
+    _next.func_def(node);
+}
+
+void FoldingConsumer::stmt(const Stmt &node) {
+    fold_stmt(node);
+    _next.stmt(node);
+}
@@ -0,0 +1,64 @@
+#include "tolang/incremental_lexer.h"
+#include "tolang/lexer.h"
+#include "tolang/token.h"
+
+void IncrementalLexer::relex(TokenBuffer &tokens, std::string_view source,
+                             const TextEdit &edit) {
+    // The first token that ends at or after the edit may change: a token
+    // ending right at the edit was stopped by a character that is now
+    // replaced. Binary search works since the tokens are in source order.
+    std::size_t lo = 0;
+    std::size_t hi = tokens.size() - 1;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (tokens.offset(mid) + tokens.length(mid) >= edit.offset) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    std::size_t first = lo;
+
+    // restart right after the last unchanged token
+    Lexer lexer(source.data(), source.data() + source.size(), _names);
+    if (first > 0) {
+        lexer._cur += tokens.offset(first - 1) + tokens.length(first - 1);
+    }
+
+    std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(edit.new_length) -
+                           static_cast<std::ptrdiff_t>(edit.old_length);
+    std::size_t new_end = edit.offset + edit.new_length;
+    std::size_t old_end = edit.offset + edit.old_length;
+
+    // `old` walks the old tokens past the edit, looking for one that starts
+    // where a new token starts. The old EOF always matches the new EOF, so the
+    // loop ends there at the latest.
+    TokenBuffer scanned(source);
+    std::size_t old = first;
+    Token token;
+    for (;;) {
+        lexer._scan(token);
+
+        std::size_t offset = token.content.data() - source.data();
+        if (offset >= new_end) {
+            std::size_t old_offset = offset - shift;
+            while (old < tokens.size() && tokens.offset(old) < old_offset) {
+                old++;
+            }
+            if (old < tokens.size() && tokens.offset(old) == old_offset &&
+                old_offset >= old_end) {
+                _rescanned = scanned.size() + 1;
+                tokens.splice(first, old, scanned);
+                return;
+            }
+        }
+
+        scanned.push(token);
+        if (token.type == Token::TK_EOF) {
+            // only reached if `edit` does not describe the new source
+            _rescanned = scanned.size();
+            tokens.splice(first, tokens.size(), scanned);
+            return;
+        }
+    }
+}
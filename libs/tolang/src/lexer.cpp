@@ -1,122 +1,273 @@
 #include "tolang/lexer.h"
 #include "tolang/error.h"
+#include "tolang/keyword.h"
 #include "tolang/token.h"
+#include <charconv>
+#include <cmath>
 #include <ctype.h>
-#include <fstream>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 
-const std::unordered_map<std::string, Token::TokenType> Lexer::_keywords_table =
-    {
-        {"fn", Token::TK_FN},   {"var", Token::TK_VAR}, {"get", Token::TK_GET},
-        {"put", Token::TK_PUT}, {"tag", Token::TK_TAG}, {"let", Token::TK_LET},
-        {"if", Token::TK_IF},   {"to", Token::TK_TO},
-};
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-void Lexer::next(Token &token) {
-    std::string content;
-    char ch = _input.get();
-    content.append(1, ch);
-    if (isalpha(ch) || ch == '_') {
-        ch = _input.get();
-        while (isalnum(ch) || ch == '_') {
-            content.append(1, ch);
-            ch = _input.get();
+Lexer::Lexer(std::istream &in, NameTablePtr names)
+    : _names(std::move(names)), _owned(std::istreambuf_iterator<char>(in),
+                                       std::istreambuf_iterator<char>()) {
+    if (_owned.size() > MAX_SOURCE_SIZE) {
+        throw std::runtime_error("source too large");
+    }
+    _begin = _cur = _owned.data();
+    _end = _cur + _owned.size();
+}
+
+// The trivia skipping below handles a whole vector of characters per step.
+// x86-64 always has SSE2 (16 bytes per step), AVX2 (32 bytes per step) is used
+// when the compiler targets it, e.g. with `-march=native`. Other targets fall
+// back to the scalar loops, which also handle the tail of the buffer.
+
+/**
+ * @brief Skip blanks and newlines.
+ * @return The first character that is neither a blank nor a newline.
+ */
+static const char *skip_blanks(const char *p, const char *end) {
+#if defined(__AVX2__)
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    while (end - p >= 32) {
+        __m256i chunk =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i is_blank =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space),
+                                            _mm256_cmpeq_epi8(chunk, tab)),
+                            _mm256_cmpeq_epi8(chunk, newline));
+        uint32_t blanks = _mm256_movemask_epi8(is_blank);
+        if (blanks != 0xffffffffu) {
+            return p + __builtin_ctz(~blanks);
         }
-        _input.unget();
-        auto it = _keywords_table.find(content);
-        auto type = it == _keywords_table.end() ? Token::TK_IDENT : it->second;
-        token = Token(type, content, _lineno);
-    } else if (isdigit(ch)) {
-        if (ch != '0') {
-            ch = _input.get();
-            while (isdigit(ch)) {
-                content.append(1, ch);
-                ch = _input.get();
-            }
-        } else {
-            ch = _input.get();
+        p += 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i is_blank =
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                                      _mm_cmpeq_epi8(chunk, tab)),
+                         _mm_cmpeq_epi8(chunk, newline));
+        uint32_t blanks = _mm_movemask_epi8(is_blank);
+        if (blanks != 0xffffu) {
+            return p + __builtin_ctz(~blanks);
         }
-        if (ch == '.') {
-            content.append(1, ch);
-            ch = _input.get();
-            while (isdigit(ch)) {
-                content.append(1, ch);
-                ch = _input.get();
-            }
+        p += 16;
+    }
+#endif
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\n')) {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * @brief Skip the rest of a comment line.
+ * @return The newline that ends the comment, or `end`.
+ */
+static const char *skip_comment(const char *p, const char *end) {
+#if defined(__AVX2__)
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (end - p >= 32) {
+        __m256i chunk =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        uint32_t newlines =
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline));
+        if (newlines != 0) {
+            return p + __builtin_ctz(newlines);
         }
-        _input.unget();
-        token = Token(Token::TK_NUMBER, content, _lineno);
-    } else if (ch == '+') {
-        token = Token(Token::TK_PLUS, content, _lineno);
-    } else if (ch == '-') {
-        token = Token(Token::TK_MINU, content, _lineno);
-    } else if (ch == '*') {
-        token = Token(Token::TK_MULT, content, _lineno);
-    } else if (ch == '/') {
-        token = Token(Token::TK_DIV, content, _lineno);
-    } else if (ch == '<') {
-        ch = _input.get();
-        if (ch == '=') {
-            content.append(1, ch);
-            token = Token(Token::TK_LE, content, _lineno);
-        } else {
-            _input.unget();
-            token = Token(Token::TK_LT, content, _lineno);
+        p += 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        uint32_t newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        if (newlines != 0) {
+            return p + __builtin_ctz(newlines);
         }
-    } else if (ch == '>') {
-        ch = _input.get();
-        if (ch == '=') {
-            content.append(1, ch);
-            token = Token(Token::TK_GE, content, _lineno);
-        } else {
-            _input.unget();
-            token = Token(Token::TK_GT, content, _lineno);
+        p += 16;
+    }
+#endif
+    while (p != end && *p != '\n') {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * @brief Scan a number literal `[0-9]+(\.[0-9]*)?`, where the integer part has
+ * no leading zeros, and convert it to the nearest float.
+ * @param p The first digit.
+ * @param value The converted value.
+ * @return One past the last character of the literal.
+ */
+static const char *scan_number(const char *p, const char *end, float &value) {
+    const char *start = p;
+    // Accumulate the digits while scanning. `digits` counts the digits that
+    // went into `mantissa`, `scale` the digits after the decimal point.
+    uint64_t mantissa = *p - '0';
+    int digits = 1;
+    int scale = 0;
+    if (*p++ != '0') {
+        for (; p != end && isdigit(*p); p++, digits++) {
+            mantissa = mantissa * 10 + (*p - '0');
         }
-    } else if (ch == '=') {
-        ch = _input.get();
-        if (ch == '=') {
-            content.append(1, ch);
-            token = Token(Token::TK_EQ, content, _lineno);
-        } else if (ch == '>') {
-            content.append(1, ch);
-            token = Token(Token::TK_RARROW, content, _lineno);
-        } else {
-            _input.unget();
-            token = Token(Token::TK_ASSIGN, content, _lineno);
+    }
+    if (p != end && *p == '.') {
+        for (p++; p != end && isdigit(*p); p++, digits++, scale++) {
+            mantissa = mantissa * 10 + (*p - '0');
         }
-    } else if (ch == '!') {
-        ch = _input.get();
-        if (ch == '=') {
-            content.append(1, ch);
-            token = Token(Token::TK_NE, content, _lineno);
-        } else {
-            _input.unget();
-            token = Token(Token::TK_ERR, content, _lineno);
-            ErrorReporter::error(_lineno, "invalid character '!'");
+    }
+
+    // Fast path: a mantissa below 2^24 and a power of ten up to 10^10 are
+    // both exact in a float, so one correctly rounded division gives the
+    // correctly rounded result.
+    static constexpr float POWERS_OF_TEN[] = {1e0f, 1e1f, 1e2f, 1e3f,
+                                              1e4f, 1e5f, 1e6f, 1e7f,
+                                              1e8f, 1e9f, 1e10f};
+    if (digits <= 19 && mantissa < (1u << 24) && scale <= 10) {
+        value = static_cast<float>(mantissa) / POWERS_OF_TEN[scale];
+        return p;
+    }
+
+    // Slow path: a correctly rounded conversion that ignores the locale.
+#if defined(__cpp_lib_to_chars)
+    auto result = std::from_chars(start, p, value);
+    if (result.ec == std::errc::result_out_of_range) {
+        // too large for a float if the integer part is not zero, too small
+        // otherwise, as `std::strtof` rounds them
+        value = *start != '0' ? HUGE_VALF : 0.0f;
+    }
+#else
+    value = std::strtof(std::string(start, p).c_str(), nullptr);
+#endif
+    return p;
+}
+
+void Lexer::_skip_trivia() {
+    _cur = skip_blanks(_cur, _end);
+    while (_cur != _end && *_cur == '#') {
+        _cur = skip_comment(_cur, _end);
+        _cur = skip_blanks(_cur, _end);
+    }
+}
+
+void Lexer::next(Token &token) {
+    _scan(token);
+    if (token.type == Token::TK_ERR) {
+        auto &diagnostics = DiagnosticsEngine::current();
+        diagnostics.report_error(token.loc, "invalid character '" +
+                                                std::string(token.content) +
+                                                "'");
+        // stop at the error that reaches the limit, as if the input ended
+        if (diagnostics.limit_reached()) {
+            token = Token(Token::TK_EOF,
+                          std::string_view(token.content.data(), 0), token.loc);
+            _cur = _end;
         }
-    } else if (ch == ';') {
-        token = Token(Token::TK_SEMINCN, content, _lineno);
-    } else if (ch == ',') {
-        token = Token(Token::TK_COMMA, content, _lineno);
-    } else if (ch == '(') {
-        token = Token(Token::TK_LPARENT, content, _lineno);
-    } else if (ch == ')') {
-        token = Token(Token::TK_RPARENT, content, _lineno);
-    } else if (ch == '#') { // comment
-        while (ch != '\n' && ch != EOF) {
-            ch = _input.get();
+    }
+}
+
+void Lexer::_scan(Token &token) {
+    _skip_trivia();
+
+    // every token, EOF included, refers to the characters it is scanned from
+    const char *start = _cur;
+    SourceLoc loc(start - _begin);
+    Token::TokenType type;
+    NameId name = 0;
+    float value = 0;
+
+    if (_cur == _end) {
+        token = Token(Token::TK_EOF, std::string_view(start, 0), loc);
+        return;
+    }
+
+    char ch = *_cur++;
+    if (isalpha(ch) || ch == '_') {
+        while (_cur != _end && (isalnum(*_cur) || *_cur == '_')) {
+            _cur++;
+        }
+        // Since keywords are similar to identifiers, we can first identify a
+        // identifier and then check if it is a keyword.
+        type = keyword_type(std::string_view(start, _cur - start));
+        if (type == Token::TK_IDENT) {
+            name = _names->intern(std::string_view(start, _cur - start));
         }
-        _input.unget();
-        return next(token);
-    } else if (ch == '\n') {
-        _lineno++;
-        return next(token);
-    } else if (isblank(ch)) {
-        return next(token);
-    } else if (ch == EOF) {
-        token = Token(Token::TK_EOF, content, _lineno);
+    } else if (isdigit(ch)) {
+        _cur = scan_number(start, _end, value);
+        type = Token::TK_NUMBER;
     } else {
-        token = Token(Token::TK_ERR, content, _lineno);
-        ErrorReporter::error(_lineno, "invalid character '" + content + "'");
+        switch (ch) {
+        case '+':
+            type = Token::TK_PLUS;
+            break;
+        case '-':
+            type = Token::TK_MINU;
+            break;
+        case '*':
+            type = Token::TK_MULT;
+            break;
+        case '/':
+            type = Token::TK_DIV;
+            break;
+        case '<':
+            type = _match('=') ? Token::TK_LE : Token::TK_LT;
+            break;
+        case '>':
+            type = _match('=') ? Token::TK_GE : Token::TK_GT;
+            break;
+        case '=':
+            type = _match('=')   ? Token::TK_EQ
+                   : _match('>') ? Token::TK_RARROW
+                                 : Token::TK_ASSIGN;
+            break;
+        case '!':
+            type = _match('=') ? Token::TK_NE : Token::TK_ERR;
+            break;
+        case ';':
+            type = Token::TK_SEMINCN;
+            break;
+        case ',':
+            type = Token::TK_COMMA;
+            break;
+        case '(':
+            type = Token::TK_LPARENT;
+            break;
+        case ')':
+            type = Token::TK_RPARENT;
+            break;
+        default:
+            type = Token::TK_ERR;
+            break;
+        }
     }
+
+    token = Token(type, std::string_view(start, _cur - start), loc, name);
+    token.value = value;
+}
+
+void Lexer::tokenize(TokenBuffer &tokens) {
+    Token token;
+    do {
+        next(token);
+        tokens.push(token);
+    } while (token.type != Token::TK_EOF);
 }
@@ -0,0 +1,197 @@
+#include "tolang/parallel_lexer.h"
+#include "tolang/error.h"
+#include "tolang/lexer.h"
+#include "tolang/token.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+ParallelLexer::ParallelLexer(const char *begin, const char *end,
+                             NameTablePtr names, unsigned threads)
+    : _names(std::move(names)), _threads(threads), _begin(begin), _end(end) {
+    if (_threads == 0) {
+        _threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+struct ParallelLexer::_Chunk {
+    const char *begin;
+    const char *end;
+    NameTablePtr names = std::make_shared<NameTable>();
+    TokenBuffer tokens;
+    // the invalid characters, merged into the engine of the calling thread
+    // in source order
+    DiagnosticsEngine errors;
+
+    // With an error limit, the lex may have to end at an invalid character,
+    // so the chunk marks the number of tokens and names before each of them,
+    // and stops at the one that reaches the limit on its own.
+    struct ErrorMark {
+        std::size_t tokens;
+        std::size_t names;
+        SourceLoc loc;
+    };
+    std::size_t error_limit = 0;
+    std::vector<ErrorMark> error_marks;
+    // the number of local names to intern, fewer than those of `names` if the
+    // chunk is cut
+    std::size_t name_count = 0;
+
+    // where the chunk goes in the merged buffer
+    std::size_t first = 0;
+    std::vector<NameId> name_map;
+
+    _Chunk(const char *begin, const char *end, std::string_view source)
+        : begin(begin), end(end), tokens(source) {}
+
+    void lex() {
+        // lex from the start of the chunk, but locate the tokens in the whole
+        // source
+        auto source = tokens.source();
+        Lexer lexer(source.data(), end, names);
+        lexer._cur = begin;
+        // a rough guess of one token per four characters
+        tokens.reserve((end - begin) / 4);
+        Token token;
+        for (;;) {
+            lexer._scan(token);
+            if (token.type == Token::TK_EOF) {
+                break;
+            }
+            if (token.type == Token::TK_ERR) {
+                error_marks.push_back(
+                    {tokens.size(), names->size(), token.loc});
+                errors.report_error(token.loc, "invalid character '" +
+                                                   std::string(token.content) +
+                                                   "'");
+                if (error_limit != 0 && error_marks.size() >= error_limit) {
+                    break;
+                }
+            }
+            tokens.push(token);
+        }
+        name_count = names->size();
+    }
+
+    /**
+     * @brief End the chunk before its `i`-th invalid character.
+     */
+    void cut(std::size_t i) {
+        tokens.resize(error_marks[i].tokens);
+        name_count = error_marks[i].names;
+    }
+
+    void merge(TokenBuffer &merged) const {
+        for (std::size_t i = 0; i < tokens.size(); i++) {
+            Token token = tokens.get(i);
+            if (token.type == Token::TK_IDENT) {
+                token.name = name_map[token.name];
+            }
+            merged.set(first + i, token);
+        }
+    }
+};
+
+/**
+ * @brief Split the source after newlines into at most `count` chunks of
+ * roughly equal size.
+ */
+static std::vector<const char *> split_points(const char *begin,
+                                              const char *end,
+                                              std::size_t count) {
+    std::vector<const char *> points{begin};
+    std::size_t size = end - begin;
+    for (std::size_t i = 1; i < count; i++) {
+        const char *target = begin + size * i / count;
+        if (target < points.back()) {
+            continue;
+        }
+        auto newline =
+            static_cast<const char *>(std::memchr(target, '\n', end - target));
+        if (newline == nullptr) {
+            break;
+        }
+        points.push_back(newline + 1);
+    }
+    points.push_back(end);
+    return points;
+}
+
+void ParallelLexer::tokenize(TokenBuffer &tokens) {
+    std::size_t size = _end - _begin;
+    std::size_t count = std::min<std::size_t>(_threads, size / MIN_CHUNK_SIZE);
+    if (count <= 1) {
+        Lexer lexer(_begin, _end, _names);
+        lexer.tokenize(tokens);
+        return;
+    }
+
+    auto points = split_points(_begin, _end, count);
+    auto &diagnostics = DiagnosticsEngine::current();
+    std::vector<_Chunk> chunks;
+    chunks.reserve(points.size() - 1);
+    for (std::size_t i = 0; i + 1 < points.size(); i++) {
+        chunks.emplace_back(points[i], points[i + 1], tokens.source());
+        chunks.back().error_limit = diagnostics.error_limit();
+    }
+
+    // the calling thread takes the first chunk itself
+    auto run = [&chunks](auto work) {
+        std::vector<std::thread> workers;
+        for (std::size_t i = 1; i < chunks.size(); i++) {
+            workers.emplace_back([&work, &chunk = chunks[i]] { work(chunk); });
+        }
+        work(chunks[0]);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    };
+
+    run([](_Chunk &chunk) { chunk.lex(); });
+
+    // With an error limit, end the tokens at the invalid character that
+    // reaches it, as a serial lex does, and drop the chunks after it.
+    SourceLoc eof_loc(_end - _begin);
+    if (std::size_t limit = diagnostics.error_limit(); limit != 0) {
+        std::size_t errors = diagnostics.errors().size();
+        for (std::size_t i = 0; i < chunks.size(); i++) {
+            auto &marks = chunks[i].error_marks;
+            if (!marks.empty() && errors + marks.size() >= limit) {
+                std::size_t last = errors < limit ? limit - errors - 1 : 0;
+                chunks[i].cut(last);
+                eof_loc = marks[last].loc;
+                chunks.erase(chunks.begin() + i + 1, chunks.end());
+                break;
+            }
+            errors += marks.size();
+        }
+    }
+
+    // Lay the chunks out one after another. Interning the local names in the
+    // order of their local IDs keeps the order of first appearance, so the
+    // shared IDs match those of a serial lex.
+    std::size_t first = tokens.size();
+    for (auto &chunk : chunks) {
+        chunk.first = first;
+        first += chunk.tokens.size();
+
+        chunk.name_map.resize(chunk.name_count);
+        for (NameId id = 0; id < chunk.name_map.size(); id++) {
+            chunk.name_map[id] = _names->intern(chunk.names->name(id));
+        }
+    }
+    tokens.resize(first + 1);
+
+    run([&tokens](_Chunk &chunk) { chunk.merge(tokens); });
+
+    // report invalid characters in source order, as the serial lexer does
+    for (auto &chunk : chunks) {
+        diagnostics.merge(chunk.errors);
+    }
+
+    tokens.set(first, Token(Token::TK_EOF,
+                            std::string_view(_begin + eof_loc.offset, 0),
+                            eof_loc));
+}
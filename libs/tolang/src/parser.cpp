@@ -1,54 +1,135 @@
 #include "tolang/parser.h"
 #include "tolang/error.h"
 #include "tolang/token.h"
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <thread>
 
-std::unique_ptr<CompUnit> Parser::parse() {
-    _lexer.next(_token);
-    _lexer.next(_pre_read);
-    auto comp_unit = _parse_comp_unit();
-    if (_token.type != Token::TK_EOF) {
-        ErrorReporter::error(_token.lineno, "expect end of file");
+std::unique_ptr<CompUnit> Parser::parse() { return _parse(nullptr); }
+
+std::unique_ptr<CompUnit> Parser::parse(AstConsumer &consumer) {
+    return _parse(&consumer);
+}
+
+std::unique_ptr<CompUnit> Parser::parse_parallel(unsigned threads) {
+    _threads = threads;
+    if (_threads == 0) {
+        _threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return _parse(nullptr);
+}
+
+bool Parser::_fill(std::size_t k) {
+    if (_lexer == nullptr) {
+        return false;
+    }
+    // Drop the tokens that have been parsed, which are never read again.
+    if (_index >= WINDOW_SIZE) {
+        std::vector<Token> rest;
+        for (std::size_t i = _index; i < _window->size(); i++) {
+            rest.push_back(_window->get(i));
+        }
+        _window->resize(0);
+        for (const auto &token : rest) {
+            _window->push(token);
+        }
+        _index = 0;
+    }
+    // Pull a batch of tokens at a time, but end it after an invalid
+    // character, so that the lexer does not report errors far ahead of the
+    // parser.
+    Token token;
+    while (_index + k >= _window->size()) {
+        if (_window->size() > 0 &&
+            _window->type(_window->size() - 1) == Token::TK_EOF) {
+            return false;
+        }
+        for (std::size_t i = 0; i < FILL_BATCH; i++) {
+            _lexer->next(token);
+            _window->push(token);
+            if (token.type == Token::TK_EOF || token.type == Token::TK_ERR) {
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+std::unique_ptr<CompUnit> Parser::_parse(AstConsumer *consumer) {
+    // with a lexer, pull the first token
+    _fill(0);
+    auto comp_unit = _parse_comp_unit(consumer);
+    if (_type() != Token::TK_EOF && !_stopped()) {
+        _error(_loc(), "expect end of file");
+    }
+    if (consumer != nullptr) {
+        consumer->end();
     }
     return comp_unit;
 }
 
-std::unique_ptr<CompUnit> Parser::_parse_comp_unit() {
+std::unique_ptr<CompUnit> Parser::_parse_comp_unit(AstConsumer *consumer) {
     auto comp_unit = std::make_unique<CompUnit>();
-    comp_unit->lineno = _token.lineno;
-
-    while (_token.type != Token::TK_VAR && _token.type != Token::TK_GET &&
-           _token.type != Token::TK_PUT && _token.type != Token::TK_TAG &&
-           _token.type != Token::TK_LET && _token.type != Token::TK_IF &&
-           _token.type != Token::TK_TO && _token.type != Token::TK_EOF) {
-        if (_token.type == Token::TK_FN) {
-            comp_unit->func_defs.push_back(_parse_func_def());
+    _arena = &comp_unit->arena;
+    comp_unit->loc = _loc();
+    comp_unit->names = _names;
+    comp_unit->lines = std::make_shared<LineTable>(_tokens->source());
+    if (consumer != nullptr) {
+        consumer->begin(*comp_unit);
+    }
+
+    // Hand a finished node to the consumer and free it, or add it to the
+    // tree.
+    auto add = [&](auto *node, auto &nodes, auto consume) {
+        if (consumer == nullptr) {
+            nodes.push_back(node);
+            return;
+        }
+        if (node != nullptr) {
+            (consumer->*consume)(*node);
+        }
+        _arena->reset();
+    };
+
+    if (_threads > 1 && _lexer == nullptr && consumer == nullptr) {
+        _parse_func_defs_parallel(*comp_unit);
+    }
+
+    while (_type() != Token::TK_VAR && _type() != Token::TK_GET &&
+           _type() != Token::TK_PUT && _type() != Token::TK_TAG &&
+           _type() != Token::TK_LET && _type() != Token::TK_IF &&
+           _type() != Token::TK_TO && _type() != Token::TK_EOF &&
+           !_stopped()) {
+        if (_type() == Token::TK_FN) {
+            add(_parse_func_def(), comp_unit->func_defs,
+                &AstConsumer::func_def);
         } else {
-            ErrorReporter::error(_token.lineno, "expect function definition");
+            _error(_loc(), "expect function definition");
             _recover();
         }
     }
 
-    while (_token.type != Token::TK_GET && _token.type != Token::TK_PUT &&
-           _token.type != Token::TK_TAG && _token.type != Token::TK_LET &&
-           _token.type != Token::TK_IF && _token.type != Token::TK_TO &&
-           _token.type != Token::TK_EOF) {
-        if (_token.type == Token::TK_VAR) {
-            comp_unit->var_decls.push_back(_parse_var_decl());
+    while (_type() != Token::TK_GET && _type() != Token::TK_PUT &&
+           _type() != Token::TK_TAG && _type() != Token::TK_LET &&
+           _type() != Token::TK_IF && _type() != Token::TK_TO &&
+           _type() != Token::TK_EOF && !_stopped()) {
+        if (_type() == Token::TK_VAR) {
+            add(_parse_var_decl(), comp_unit->var_decls,
+                &AstConsumer::var_decl);
         } else {
-            ErrorReporter::error(_token.lineno, "expect variable declaration");
+            _error(_loc(), "expect variable declaration");
             _recover();
         }
     }
 
-    while (_token.type != Token::TK_EOF) {
-        if (_token.type == Token::TK_GET || _token.type == Token::TK_PUT ||
-            _token.type == Token::TK_TAG || _token.type == Token::TK_LET ||
-            _token.type == Token::TK_IF || _token.type == Token::TK_TO) {
-            comp_unit->stmts.push_back(_parse_stmt());
+    while (_type() != Token::TK_EOF && !_stopped()) {
+        if (_type() == Token::TK_GET || _type() == Token::TK_PUT ||
+            _type() == Token::TK_TAG || _type() == Token::TK_LET ||
+            _type() == Token::TK_IF || _type() == Token::TK_TO) {
+            add(_parse_stmt(), comp_unit->stmts, &AstConsumer::stmt);
         } else {
-            ErrorReporter::error(_token.lineno, "expect statement");
+            _error(_loc(), "expect statement");
             _recover();
         }
     }
@@ -56,266 +137,403 @@ std::unique_ptr<CompUnit> Parser::_parse_comp_unit() {
     return comp_unit;
 }
 
-std::unique_ptr<FuncDef> Parser::_parse_func_def() {
-    auto func_def = std::make_unique<FuncDef>();
-    func_def->lineno = _token.lineno;
+void Parser::_parse_func_defs_parallel(CompUnit &comp_unit) {
+    std::size_t size = _tokens->size();
+    if (size < 2 * MIN_PARALLEL_TOKENS || _type() != Token::TK_FN) {
+        return;
+    }
+
+    // A function definition holds no `;`, so the definitions start at the
+    // current token and after every `;` followed by `fn`. The section ends
+    // after the first `;` followed by anything else.
+    std::size_t first = _index;
+    std::size_t end = size - 1;
+    std::vector<std::size_t> starts{first};
+    for (std::size_t i = first; i + 1 < size; i++) {
+        if (_tokens->type(i) != Token::TK_SEMINCN) {
+            continue;
+        }
+        if (_tokens->type(i + 1) != Token::TK_FN) {
+            end = i + 1;
+            break;
+        }
+        starts.push_back(i + 1);
+    }
+    starts.push_back(end);
+
+    std::size_t count =
+        std::min<std::size_t>(_threads, (end - first) / MIN_PARALLEL_TOKENS);
+    if (count <= 1) {
+        return;
+    }
+
+    // Give each thread a run of whole definitions with about the same number
+    // of tokens, into its own arena and error buffer.
+    struct Chunk {
+        std::size_t first_func;
+        std::size_t last_func;
+        Arena arena;
+        std::vector<FuncDef *> func_defs;
+        DiagnosticsEngine errors;
+        bool valid = false;
+    };
+    std::vector<Chunk> chunks(count);
+    for (std::size_t i = 0; i < count; i++) {
+        std::size_t target = first + (end - first) * i / count;
+        chunks[i].first_func =
+            std::lower_bound(starts.begin(), starts.end() - 1, target) -
+            starts.begin();
+        if (i > 0) {
+            chunks[i - 1].last_func = chunks[i].first_func;
+        }
+    }
+    chunks.back().last_func = starts.size() - 1;
+
+    auto work = [this, &starts](Chunk &chunk) {
+        DiagnosticsScope scope(chunk.errors);
+        Parser parser(*_tokens, _names);
+        parser._arena = &chunk.arena;
+        parser._index = starts[chunk.first_func];
+        for (auto i = chunk.first_func; i < chunk.last_func; i++) {
+            chunk.func_defs.push_back(parser._parse_func_def());
+        }
+        chunk.valid =
+            !chunk.errors.has_error() &&
+            parser._index == starts[chunk.last_func];
+    };
+
+    // the calling thread takes the first chunk itself
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < count; i++) {
+        workers.emplace_back([&work, &chunk = chunks[i]] { work(chunk); });
+    }
+    work(chunks[0]);
+    for (auto &worker : workers) {
+        worker.join();
+    }
 
-    _match(_token, Token::TK_FN);
+    for (const auto &chunk : chunks) {
+        if (!chunk.valid) {
+            return;
+        }
+    }
+    for (auto &chunk : chunks) {
+        comp_unit.func_defs.insert(comp_unit.func_defs.end(),
+                                   chunk.func_defs.begin(),
+                                   chunk.func_defs.end());
+        comp_unit.arena.adopt(chunk.arena);
+    }
+
+    _index = end;
+}
+
+FuncDef *Parser::_parse_func_def() {
+    auto func_def = _arena->make<FuncDef>();
+    func_def->loc = _loc();
+
+    _match(Token::TK_FN);
 
     func_def->ident = _parse_ident();
 
-    _match(_token, Token::TK_LPARENT);
+    _match(Token::TK_LPARENT);
 
-    if (_token.type != Token::TK_RPARENT) {
-        _parse_func_f_params(func_def->func_f_params);
+    if (_type() != Token::TK_RPARENT) {
+        func_def->func_f_params = _parse_func_f_params();
     }
 
-    _match(_token, Token::TK_RPARENT);
+    _match(Token::TK_RPARENT);
 
-    _match(_token, Token::TK_RARROW);
+    _match(Token::TK_RARROW);
 
     func_def->exp = _parse_exp();
 
-    _match(_token, Token::TK_SEMINCN);
+    _match(Token::TK_SEMINCN);
 
     return func_def;
 }
 
-void Parser::_parse_func_f_params(
-    std::vector<std::unique_ptr<Ident>> &func_f_params) {
-    func_f_params.push_back(_parse_ident());
-    while (_token.type == Token::TK_COMMA) {
+ArenaArray<Ident *> Parser::_parse_func_f_params() {
+    _ident_stack.clear();
+    _ident_stack.push_back(_parse_ident());
+    while (_type() == Token::TK_COMMA) {
         _next_token();
-        func_f_params.push_back(_parse_ident());
+        _ident_stack.push_back(_parse_ident());
     }
+    return _arena->make_array(_ident_stack.begin(), _ident_stack.end());
 }
 
-std::unique_ptr<VarDecl> Parser::_parse_var_decl() {
-    auto var_decl = std::make_unique<VarDecl>();
-    var_decl->lineno = _token.lineno;
+VarDecl *Parser::_parse_var_decl() {
+    auto var_decl = _arena->make<VarDecl>();
+    var_decl->loc = _loc();
 
-    _match(_token, Token::TK_VAR);
+    _match(Token::TK_VAR);
 
     var_decl->ident = _parse_ident();
 
-    _match(_token, Token::TK_SEMINCN);
+    _match(Token::TK_SEMINCN);
 
     return var_decl;
 }
 
-std::unique_ptr<Stmt> Parser::_parse_stmt() {
-    switch (_token.type) {
+Stmt *Parser::_parse_stmt() {
+    switch (_type()) {
     case Token::TK_GET: {
         GetStmt get_stmt;
-        get_stmt.lineno = _token.lineno;
+        get_stmt.loc = _loc();
 
         _next_token();
 
         get_stmt.ident = _parse_ident();
 
-        _match(_token, Token::TK_SEMINCN);
+        _match(Token::TK_SEMINCN);
 
-        return std::make_unique<Stmt>(std::move(get_stmt));
+        return _arena->make<Stmt>(std::move(get_stmt));
     }
     case Token::TK_PUT: {
         PutStmt put_stmt;
-        put_stmt.lineno = _token.lineno;
+        put_stmt.loc = _loc();
 
         _next_token();
 
         put_stmt.exp = _parse_exp();
 
-        _match(_token, Token::TK_SEMINCN);
+        _match(Token::TK_SEMINCN);
 
-        return std::make_unique<Stmt>(std::move(put_stmt));
+        return _arena->make<Stmt>(std::move(put_stmt));
     }
     case Token::TK_TAG: {
         TagStmt tag_stmt;
-        tag_stmt.lineno = _token.lineno;
+        tag_stmt.loc = _loc();
 
         _next_token();
 
         tag_stmt.ident = _parse_ident();
 
-        _match(_token, Token::TK_SEMINCN);
+        _match(Token::TK_SEMINCN);
 
-        return std::make_unique<Stmt>(std::move(tag_stmt));
+        return _arena->make<Stmt>(std::move(tag_stmt));
     }
     case Token::TK_LET: {
         LetStmt let_stmt;
-        let_stmt.lineno = _token.lineno;
+        let_stmt.loc = _loc();
 
         _next_token();
 
         let_stmt.ident = _parse_ident();
 
-        _match(_token, Token::TK_ASSIGN);
+        _match(Token::TK_ASSIGN);
 
         let_stmt.exp = _parse_exp();
 
-        _match(_token, Token::TK_SEMINCN);
+        _match(Token::TK_SEMINCN);
 
-        return std::make_unique<Stmt>(std::move(let_stmt));
+        return _arena->make<Stmt>(std::move(let_stmt));
     }
     case Token::TK_IF: {
         IfStmt if_stmt;
-        if_stmt.lineno = _token.lineno;
+        if_stmt.loc = _loc();
 
         _next_token();
 
         if_stmt.cond = _parse_cond();
 
-        _match(_token, Token::TK_TO);
+        _match(Token::TK_TO);
 
         if_stmt.ident = _parse_ident();
 
-        _match(_token, Token::TK_SEMINCN);
+        _match(Token::TK_SEMINCN);
 
-        return std::make_unique<Stmt>(std::move(if_stmt));
+        return _arena->make<Stmt>(std::move(if_stmt));
     }
     case Token::TK_TO: {
         ToStmt to_stmt;
-        to_stmt.lineno = _token.lineno;
+        to_stmt.loc = _loc();
 
         _next_token();
 
         to_stmt.ident = _parse_ident();
 
-        _match(_token, Token::TK_SEMINCN);
+        _match(Token::TK_SEMINCN);
 
-        return std::make_unique<Stmt>(std::move(to_stmt));
+        return _arena->make<Stmt>(std::move(to_stmt));
     }
     default:
-        ErrorReporter::error(_token.lineno, "expect statement");
+        _error(_loc(), "expect statement");
         _recover();
         return nullptr;
     }
 }
 
-std::unique_ptr<Exp> Parser::_parse_exp() { return _parse_add_exp(); }
-
-std::unique_ptr<Exp> Parser::_parse_add_exp() {
-    auto lineno = _token.lineno;
-
-    auto exp = _parse_mul_exp();
-    while (_token.type == Token::TK_PLUS || _token.type == Token::TK_MINU) {
-        BinaryExp binary_exp;
-        binary_exp.lineno = lineno;
-        binary_exp.lhs = std::move(exp);
-        binary_exp.op =
-            _token.type == Token::TK_PLUS ? BinaryExp::PLUS : BinaryExp::MINU;
-
-        _next_token();
-        auto rhs = _parse_mul_exp();
-        binary_exp.rhs = std::move(rhs);
-        exp = std::make_unique<Exp>(std::move(binary_exp));
-    }
+Exp *Parser::_parse_exp() {
+    // The expression is parsed with `_exp_frames` instead of recursion, one
+    // frame per rule that waits for an operand, so that deeply nested
+    // expressions take no native stack. The tree is the same as the one of
+    // the grammar:
+    //
+    //   AddExp   -> MulExp { ('+' | '-') MulExp }
+    //   MulExp   -> UnaryExp { ('*' | '/') UnaryExp }
+    //   UnaryExp -> Ident '(' [ Exp { ',' Exp } ] ')' | '(' Exp ')'
+    //             | Ident | Number | ('+' | '-') UnaryExp
+    std::size_t base = _exp_frames.size();
+    _push_exp_frame(_ExpFrame::ADD);
+    _push_exp_frame(_ExpFrame::MUL);
+    Exp *exp;
+    do {
+        exp = _parse_operand();
+    } while (_reduce_exp(base, exp));
     return exp;
 }
 
-std::unique_ptr<Exp> Parser::_parse_mul_exp() {
-    auto lineno = _token.lineno;
-
-    auto exp = _parse_unary_exp();
-    while (_token.type == Token::TK_MULT || _token.type == Token::TK_DIV) {
-        BinaryExp binary_exp;
-        binary_exp.lineno = lineno;
-        binary_exp.lhs = std::move(exp);
-        switch (_token.type) {
-        case Token::TK_MULT:
-            binary_exp.op = BinaryExp::MULT;
+Exp *Parser::_parse_operand() {
+    while (true) {
+        if (_type() == Token::TK_IDENT &&
+            _peek(1) == Token::TK_LPARENT) {
+            auto loc = _loc();
+            auto ident = _parse_ident();
+
+            _match(Token::TK_LPARENT);
+
+            if (_type() != Token::TK_RPARENT) {
+                // parse the arguments, then finish the call in `_reduce_exp`
+                auto &frame = _push_exp_frame(_ExpFrame::CALL);
+                frame.loc = loc;
+                frame.ident = ident;
+                frame.first = _exp_stack.size();
+                _push_exp_frame(_ExpFrame::ADD);
+                _push_exp_frame(_ExpFrame::MUL);
+                continue;
+            }
+
+            _match(Token::TK_RPARENT);
+
+            CallExp call_exp;
+            call_exp.loc = loc;
+            call_exp.ident = ident;
+            return _arena->make<Exp>(std::move(call_exp));
+        }
+
+        switch (_type()) {
+        case Token::TK_IDENT: {
+            IdentExp lval_exp;
+            lval_exp.loc = _loc();
+            lval_exp.ident = _parse_ident();
+            return _arena->make<Exp>(std::move(lval_exp));
+        }
+        case Token::TK_NUMBER:
+            return _parse_number();
+        case Token::TK_LPARENT:
+            _next_token();
+            _push_exp_frame(_ExpFrame::PAREN);
+            _push_exp_frame(_ExpFrame::ADD);
+            _push_exp_frame(_ExpFrame::MUL);
             break;
-        case Token::TK_DIV:
-            binary_exp.op = BinaryExp::DIV;
+        case Token::TK_PLUS:
+        case Token::TK_MINU:
+            _push_exp_frame(_ExpFrame::UNARY).op = _type();
+            _next_token();
             break;
         default:
-            throw std::runtime_error("unreachable code");
+            _error(_loc(), "expect unary expression");
+            _recover();
+            return nullptr;
         }
-
-        _next_token();
-        binary_exp.rhs = _parse_unary_exp();
-        exp = std::make_unique<Exp>(std::move(binary_exp));
     }
-    return exp;
 }
 
-std::unique_ptr<Exp> Parser::_parse_unary_exp() {
-    if (_token.type == Token::TK_IDENT && _pre_read.type == Token::TK_LPARENT) {
-        CallExp call_exp;
-        call_exp.lineno = _token.lineno;
-
-        call_exp.ident = _parse_ident();
-
-        _match(_token, Token::TK_LPARENT);
-
-        if (_token.type != Token::TK_RPARENT) {
-            _parse_func_r_params(call_exp.func_r_params);
+bool Parser::_reduce_exp(std::size_t base, Exp *&exp) {
+    while (_exp_frames.size() > base) {
+        auto &frame = _exp_frames.back();
+        switch (frame.kind) {
+        case _ExpFrame::ADD:
+        case _ExpFrame::MUL: {
+            if (frame.pending) {
+                BinaryExp binary_exp;
+                binary_exp.loc = frame.loc;
+                binary_exp.lhs = frame.lhs;
+                switch (frame.op) {
+                case Token::TK_PLUS:
+                    binary_exp.op = BinaryExp::PLUS;
+                    break;
+                case Token::TK_MINU:
+                    binary_exp.op = BinaryExp::MINU;
+                    break;
+                case Token::TK_MULT:
+                    binary_exp.op = BinaryExp::MULT;
+                    break;
+                case Token::TK_DIV:
+                    binary_exp.op = BinaryExp::DIV;
+                    break;
+                default:
+                    throw std::runtime_error("unreachable code");
+                }
+                binary_exp.rhs = exp;
+                exp = _arena->make<Exp>(std::move(binary_exp));
+            }
+
+            bool is_add = frame.kind == _ExpFrame::ADD;
+            if (is_add ? _type() == Token::TK_PLUS ||
+                             _type() == Token::TK_MINU
+                       : _type() == Token::TK_MULT ||
+                             _type() == Token::TK_DIV) {
+                frame.pending = true;
+                frame.lhs = exp;
+                frame.op = _type();
+                _next_token();
+                if (is_add) {
+                    _push_exp_frame(_ExpFrame::MUL);
+                }
+                return true;
+            }
+            break;
         }
-
-        _match(_token, Token::TK_RPARENT);
-
-        return std::make_unique<Exp>(std::move(call_exp));
-    } else if (_token.type == Token::TK_IDENT ||
-               _token.type == Token::TK_NUMBER ||
-               _token.type == Token::TK_LPARENT) {
-        return _parse_primary_exp();
-    } else if (_token.type == Token::TK_PLUS || _token.type == Token::TK_MINU) {
-        UnaryExp unary_exp;
-        unary_exp.lineno = _token.lineno;
-        unary_exp.op =
-            _token.type == Token::TK_PLUS ? UnaryExp::PLUS : UnaryExp::MINU;
-
-        _next_token();
-        unary_exp.exp = _parse_unary_exp();
-        return std::make_unique<Exp>(std::move(unary_exp));
-    } else {
-        ErrorReporter::error(_token.lineno, "expect unary expression");
-        _recover();
-        return nullptr;
-    }
-}
-
-std::unique_ptr<Exp> Parser::_parse_primary_exp() {
-    switch (_token.type) {
-    case Token::TK_LPARENT: {
-        _next_token();
-        auto exp = _parse_exp();
-
-        _match(_token, Token::TK_RPARENT);
-
-        return exp;
-    }
-    case Token::TK_IDENT: {
-        IdentExp lval_exp;
-        lval_exp.lineno = _token.lineno;
-        lval_exp.ident = _parse_ident();
-        return std::make_unique<Exp>(std::move(lval_exp));
-    }
-    case Token::TK_NUMBER: {
-        return _parse_number();
-    }
-    default:
-        ErrorReporter::error(_token.lineno, "expect primary expression");
-        _recover();
-        return nullptr;
-    }
-}
-
-void Parser::_parse_func_r_params(
-    std::vector<std::unique_ptr<Exp>> &func_r_params) {
-    func_r_params.push_back(_parse_exp());
-    while (_token.type == Token::TK_COMMA) {
-        _next_token();
-        func_r_params.push_back(_parse_exp());
+        case _ExpFrame::UNARY: {
+            UnaryExp unary_exp;
+            unary_exp.loc = frame.loc;
+            unary_exp.op =
+                frame.op == Token::TK_PLUS ? UnaryExp::PLUS : UnaryExp::MINU;
+            unary_exp.exp = exp;
+            exp = _arena->make<Exp>(std::move(unary_exp));
+            break;
+        }
+        case _ExpFrame::PAREN:
+            _match(Token::TK_RPARENT);
+            break;
+        case _ExpFrame::CALL: {
+            // Arguments of nested calls are collected above those of the
+            // outer call, and are moved into the arena before the outer call
+            // continues.
+            _exp_stack.push_back(exp);
+            if (_type() == Token::TK_COMMA) {
+                _next_token();
+                _push_exp_frame(_ExpFrame::ADD);
+                _push_exp_frame(_ExpFrame::MUL);
+                return true;
+            }
+
+            CallExp call_exp;
+            call_exp.loc = frame.loc;
+            call_exp.ident = frame.ident;
+            call_exp.func_r_params = _arena->make_array(
+                _exp_stack.begin() + frame.first, _exp_stack.end());
+            _exp_stack.resize(frame.first);
+
+            _match(Token::TK_RPARENT);
+
+            exp = _arena->make<Exp>(std::move(call_exp));
+            break;
+        }
+        }
+        _exp_frames.pop_back();
     }
+    return false;
 }
 
-std::unique_ptr<Cond> Parser::_parse_cond() {
-    auto cond = std::make_unique<Cond>();
-    cond->lineno = _token.lineno;
+Cond *Parser::_parse_cond() {
+    auto cond = _arena->make<Cond>();
+    cond->loc = _loc();
 
     cond->lhs = _parse_exp();
-    switch (_token.type) {
+    switch (_type()) {
     case Token::TK_LT:
         cond->op = Cond::LT;
         _next_token();
@@ -341,44 +559,42 @@ std::unique_ptr<Cond> Parser::_parse_cond() {
         _next_token();
         break;
     default:
-        ErrorReporter::error(_token.lineno, "expect comparison operator");
+        _error(_loc(), "expect comparison operator");
         break;
     }
     cond->rhs = _parse_exp();
     return cond;
 }
 
-std::unique_ptr<Ident> Parser::_parse_ident() {
-    if (_token.type == Token::TK_IDENT) {
-        auto ident = std::make_unique<Ident>();
-        ident->lineno = _token.lineno;
-        ident->value = _token.content;
+Ident *Parser::_parse_ident() {
+    if (_type() == Token::TK_IDENT) {
+        NameId name = _tokens->name(_index);
+        auto ident = _arena->make<Ident>(_loc(), name, _names->name(name));
         _next_token();
         return ident;
     } else {
-        ErrorReporter::error(_token.lineno, "expect identifier");
+        _error(_loc(), "expect identifier");
         return nullptr;
     }
 }
 
-std::unique_ptr<Exp> Parser::_parse_number() {
-    if (_token.type == Token::TK_NUMBER) {
+Exp *Parser::_parse_number() {
+    if (_type() == Token::TK_NUMBER) {
         Number number;
-        number.lineno = _token.lineno;
-        // number is float, so use std::stof
-        number.value = std::stof(_token.content);
+        number.loc = _loc();
+        // the lexer has already converted the literal
+        number.value = _tokens->value(_index);
         _next_token();
-        return std::make_unique<Exp>(number);
+        return _arena->make<Exp>(std::move(number));
     } else {
-        ErrorReporter::error(_token.lineno, "expect number");
+        _error(_loc(), "expect number");
         return nullptr;
     }
 }
 
-void Parser::_match(const Token &token, Token::TokenType expected) {
-    if (token.type != expected) {
-        ErrorReporter::error(_token.lineno,
-                             "expect '" + token_type_to_string(expected) + "'");
+void Parser::_match(Token::TokenType expected) {
+    if (_type() != expected) {
+        _error(_loc(), "expect '" + token_type_to_string(expected) + "'");
     } else {
         _next_token();
     }
@@ -0,0 +1,547 @@
+#include "tolang/resolver.h"
+#include "tolang/error.h"
+#include "tolang/utils.h"
+
+// The checks below mirror those the code generators made while they looked
+// names up themselves, so that the same errors are reported and the same
+// parts of an erroneous program are skipped.
+
+void Resolver::resolve(const CompUnit &root) {
+    begin(root);
+    for (auto &elm : root.func_defs) {
+        func_def(*elm);
+    }
+    for (auto &elm : root.var_decls) {
+        var_decl(*elm);
+    }
+    for (auto &elm : root.stmts) {
+        if (elm == nullptr) { // invalid ast
+            continue;
+        }
+        stmt(*elm);
+    }
+    end();
+}
+
+void Resolver::func_def(const FuncDef &node) {
+    if (node.ident == nullptr) { // invalid ast
+        return;
+    }
+    _exp_results.clear();
+
+    std::vector<Ident *> params;
+    for (auto ident : node.func_f_params) {
+        if (ident == nullptr) { // invalid ast
+            continue;
+        }
+        params.push_back(ident);
+    }
+    if (!_begin_func_def(*node.ident, node.loc, params)) {
+        return;
+    }
+
+    // the scope of a function whose body has errors is left open, like the
+    // code generators did
+    if (node.exp == nullptr || !_resolve_exp(*node.exp)) {
+        return;
+    }
+    _table.pop_scope();
+}
+
+void Resolver::var_decl(const VarDecl &node) {
+    _begin_main();
+    if (node.ident == nullptr) { // invalid ast
+        return;
+    }
+    _define_var(*node.ident);
+}
+
+void Resolver::stmt(const Stmt &node) {
+    _begin_main();
+    _exp_results.clear();
+    std::visit(overloaded{
+                   [this](const GetStmt &node) {
+                       if (node.ident != nullptr) {
+                           _use_any(*node.ident);
+                       }
+                   },
+                   [this](const PutStmt &node) {
+                       if (node.exp != nullptr) {
+                           _resolve_exp(*node.exp);
+                       }
+                   },
+                   [this](const TagStmt &node) {
+                       if (node.ident != nullptr) {
+                           _define_tag(*node.ident);
+                       }
+                   },
+                   [this](const LetStmt &node) {
+                       if (node.ident == nullptr ||
+                           !_use_variable(*node.ident)) {
+                           return;
+                       }
+                       if (node.exp != nullptr) {
+                           _resolve_exp(*node.exp);
+                       }
+                   },
+                   [this](const IfStmt &node) {
+                       // the tag is only looked up if the condition is valid
+                       if (node.cond != nullptr &&
+                           _resolve_cond(*node.cond) &&
+                           node.ident != nullptr) {
+                           _use_tag(*node.ident);
+                       }
+                   },
+                   [this](const ToStmt &node) {
+                       if (node.ident != nullptr) {
+                           _use_tag(*node.ident);
+                       }
+                   },
+               },
+               node);
+}
+
+void Resolver::end() {
+    _begin_main();
+    _end_main();
+}
+
+void Resolver::resolve(FlatAst &ast) {
+    _names = ast.names;
+    _lines = ast.lines.get();
+
+    for (auto &node : ast.func_defs) {
+        if (node.ident == FLAT_NONE) { // invalid ast
+            continue;
+        }
+        std::vector<Ident *> params;
+        for (uint32_t i = 0; i < node.param_count; i++) {
+            auto param = ast.params[node.first_param + i];
+            if (param == FLAT_NONE) { // invalid ast
+                continue;
+            }
+            params.push_back(&ast.idents[param]);
+        }
+        if (!_begin_func_def(ast.idents[node.ident], node.loc, params)) {
+            continue;
+        }
+        if (_resolve_flat_exp(ast, node.exp)) {
+            _table.pop_scope();
+        }
+    }
+
+    _begin_main();
+    for (auto &node : ast.var_decls) {
+        if (node.ident == FLAT_NONE) { // invalid ast
+            continue;
+        }
+        _define_var(ast.idents[node.ident]);
+    }
+    for (auto &node : ast.stmts) {
+        _resolve_flat_stmt(ast, node);
+    }
+    _end_main();
+}
+
+void Resolver::_resolve_flat_stmt(FlatAst &ast, const FlatStmt &node) {
+    Ident *ident = node.ident != FLAT_NONE ? &ast.idents[node.ident] : nullptr;
+    switch (node.kind) {
+    case FlatStmt::GET:
+        if (ident != nullptr) {
+            _use_any(*ident);
+        }
+        break;
+    case FlatStmt::PUT:
+        _resolve_flat_exp(ast, node.exp);
+        break;
+    case FlatStmt::TAG:
+        if (ident != nullptr) {
+            _define_tag(*ident);
+        }
+        break;
+    case FlatStmt::LET:
+        if (ident != nullptr && _use_variable(*ident)) {
+            _resolve_flat_exp(ast, node.exp);
+        }
+        break;
+    case FlatStmt::IF: {
+        if (node.exp == FLAT_NONE) {
+            break;
+        }
+        const auto &cond = ast.conds[node.exp];
+        if (cond.lhs == FLAT_NONE || cond.rhs == FLAT_NONE) {
+            break;
+        }
+        bool lhs = _resolve_flat_exp(ast, cond.lhs);
+        bool rhs = _resolve_flat_exp(ast, cond.rhs);
+        if (lhs && rhs && ident != nullptr) {
+            _use_tag(*ident);
+        }
+        break;
+    }
+    case FlatStmt::TO:
+        if (ident != nullptr) {
+            _use_tag(*ident);
+        }
+        break;
+    }
+}
+
+void Resolver::_begin_main() {
+    if (_in_main) {
+        return;
+    }
+    _in_main = true;
+    _table.push_scope();
+}
+
+void Resolver::_end_main() {
+    _in_main = false;
+    _table.pop_scope();
+}
+
+bool Resolver::_begin_func_def(Ident &ident, SourceLoc loc,
+                               const std::vector<Ident *> &params) {
+    uint32_t slot = _table.size();
+    if (!_table.add_symbol(Symbol(SymbolType::FUNC, ident.id, ident.value, loc,
+                                  params.size()))) {
+        auto pre_defined = _table.get_symbol(ident.id);
+        DiagnosticsEngine::error(
+            loc, "redefine function " + std::string(ident.value) +
+                     ", previous defined at line " +
+                     std::to_string(_line(pre_defined->loc)));
+        return false;
+    }
+    ident.slot = slot;
+
+    _table.push_scope();
+
+    // a redefined parameter still gets a slot, since it is still an argument
+    // of the function, but its name refers to the first one
+    for (auto param : params) {
+        param->slot = _table.size();
+        if (!_table.add_symbol(Symbol(SymbolType::VAR, param->id, param->value,
+                                      param->loc))) {
+            auto pre_defined = _table.get_symbol(param->id);
+            DiagnosticsEngine::error(
+                param->loc, "redefine parameter " + std::string(param->value) +
+                                ", previous defined at line " +
+                                std::to_string(_line(pre_defined->loc)));
+        }
+    }
+    return true;
+}
+
+void Resolver::_define_var(Ident &ident) {
+    uint32_t slot = _table.size();
+    if (!_table.add_symbol(
+            Symbol(SymbolType::VAR, ident.id, ident.value, ident.loc))) {
+        auto pre_defined = _table.get_symbol(ident.id);
+        DiagnosticsEngine::error(
+            ident.loc, "redefine variable " + std::string(ident.value) +
+                           ", previous defined at line " +
+                           std::to_string(_line(pre_defined->loc)));
+        return;
+    }
+    ident.slot = slot;
+}
+
+void Resolver::_use_any(Ident &ident) {
+    auto symbol = _table.get_symbol(ident.id);
+    if (symbol == nullptr) {
+        DiagnosticsEngine::error(ident.loc, "undefined symbol " +
+                                                std::string(ident.value));
+        return;
+    }
+    ident.slot = symbol->slot;
+}
+
+void Resolver::_define_tag(Ident &ident) {
+    if (!_table.exist_in_scope(ident.id)) {
+        ident.slot = _table.size();
+        _table.add_symbol(
+            Symbol(SymbolType::TAG, ident.id, ident.value, ident.loc));
+        return;
+    }
+    // a tag that has been jumped to is defined here, and may be defined again
+    _use_tag(ident);
+}
+
+void Resolver::_use_tag(Ident &ident) {
+    if (!_table.exist_in_scope(ident.id)) {
+        // a jump forward, to a tag that has no location until it is defined
+        ident.slot = _table.size();
+        _table.add_symbol(Symbol(SymbolType::TAG, ident.id, ident.value,
+                                 SourceLoc::invalid()));
+        return;
+    }
+    auto symbol = _table.get_symbol(ident.id);
+    if (symbol->type != SymbolType::TAG) {
+        DiagnosticsEngine::error(
+            ident.loc, std::string(ident.value) + " is not a tag, but a " +
+                           symbol_type_to_string(symbol->type) +
+                           ", defined at line " +
+                           std::to_string(_line(symbol->loc)));
+        return;
+    }
+    ident.slot = symbol->slot;
+}
+
+bool Resolver::_use_variable(Ident &ident) {
+    auto symbol = _table.get_symbol(ident.id);
+    if (symbol == nullptr) {
+        DiagnosticsEngine::error(ident.loc, "undefined symbol " +
+                                                std::string(ident.value));
+        return false;
+    }
+    if (symbol->type != SymbolType::VAR) {
+        DiagnosticsEngine::error(
+            ident.loc, std::string(ident.value) + " is not a variable, but a " +
+                           symbol_type_to_string(symbol->type) +
+                           ", defined at line " +
+                           std::to_string(_line(symbol->loc)));
+        return false;
+    }
+    ident.slot = symbol->slot;
+    return true;
+}
+
+bool Resolver::_use_function(Ident &ident, std::size_t args_count) {
+    auto symbol = _table.get_symbol(ident.id);
+    if (symbol == nullptr) {
+        DiagnosticsEngine::error(ident.loc, "undefined symbol " +
+                                                std::string(ident.value));
+        return false;
+    }
+    if (symbol->type != SymbolType::FUNC) {
+        DiagnosticsEngine::error(
+            ident.loc, std::string(ident.value) + " is not a function, but a " +
+                           symbol_type_to_string(symbol->type) +
+                           ", defined at line " +
+                           std::to_string(_line(symbol->loc)));
+        return false;
+    }
+
+    if (symbol->params_count != args_count) {
+        DiagnosticsEngine::error(
+            ident.loc, "params number not matched in function call " +
+                           std::string(ident.value) + ", expect " +
+                           std::to_string(symbol->params_count) +
+                           " but got " + std::to_string(args_count));
+        return false;
+    }
+    ident.slot = symbol->slot;
+    return true;
+}
+
+bool Resolver::_resolve_exp(const Exp &root) {
+    // Walk the expression with an explicit stack, so that deep expressions do
+    // not overflow the call stack. A node is checked before its children, and
+    // a call that cannot be made skips its arguments.
+    bool ok = true;
+    _exp_frames.push_back({&root, false, true});
+    if (!_memoize_exps) {
+        // The result is whether every node checked is free of errors, so a
+        // node is done once it is checked. The left operands of binary
+        // expressions, which chains of them nest in, are walked down without
+        // going through the stack.
+        while (!_exp_frames.empty()) {
+            auto exp = _exp_frames.back().exp;
+            _exp_frames.pop_back();
+            auto binary = std::get_if<BinaryExp>(exp);
+            while (binary != nullptr && binary->lhs != nullptr &&
+                   binary->rhs != nullptr) {
+                _exp_frames.push_back({binary->rhs, false, true});
+                exp = binary->lhs;
+                binary = std::get_if<BinaryExp>(exp);
+            }
+            ok = _expand_exp(*exp) && ok;
+        }
+        return ok;
+    }
+
+    // The result of every node is kept, so a node is finished after its
+    // children, whose results are folded into it.
+    while (!_exp_frames.empty()) {
+        auto top = _exp_frames.size() - 1;
+        auto &frame = _exp_frames[top];
+        const auto &exp = *frame.exp;
+        if (!frame.expanded) {
+            frame.expanded = true;
+            auto it = _exp_results.find(&exp);
+            // pushing the children may move the frame
+            if (it != _exp_results.end()) {
+                frame.ok = it->second;
+            } else {
+                _exp_frames[top].ok = _expand_exp(exp);
+            }
+            if (_exp_frames.size() > top + 1) {
+                continue;
+            }
+        }
+        auto done = _exp_frames.back();
+        _exp_frames.pop_back();
+        _exp_results.emplace(done.exp, done.ok);
+        if (_exp_frames.empty()) {
+            ok = done.ok;
+        } else if (!done.ok) {
+            _exp_frames.back().ok = false;
+        }
+    }
+    return ok;
+}
+
+bool Resolver::_expand_exp(const Exp &exp) {
+    return std::visit(
+        overloaded{
+            [this](const BinaryExp &node) {
+                if (node.lhs == nullptr || node.rhs == nullptr) { // invalid ast
+                    return false;
+                }
+                _exp_frames.push_back({node.rhs, false, true});
+                _exp_frames.push_back({node.lhs, false, true});
+                return true;
+            },
+            [this](const CallExp &node) {
+                if (node.ident == nullptr ||
+                    !_use_function(*node.ident, node.func_r_params.size())) {
+                    return false;
+                }
+                bool ok = true;
+                for (auto i = node.func_r_params.size(); i > 0; i--) {
+                    auto arg = node.func_r_params[i - 1];
+                    if (arg == nullptr) {
+                        ok = false;
+                        continue;
+                    }
+                    _exp_frames.push_back({arg, false, true});
+                }
+                return ok;
+            },
+            [this](const UnaryExp &node) {
+                if (node.exp == nullptr) { // invalid ast
+                    return false;
+                }
+                _exp_frames.push_back({node.exp, false, true});
+                return true;
+            },
+            [this](const IdentExp &node) {
+                return node.ident != nullptr && _use_variable(*node.ident);
+            },
+            [](const Number &) { return true; },
+        },
+        exp);
+}
+
+bool Resolver::_resolve_cond(const Cond &node) {
+    if (node.lhs == nullptr || node.rhs == nullptr) { // invalid ast
+        return false;
+    }
+    bool lhs = _resolve_exp(*node.lhs);
+    bool rhs = _resolve_exp(*node.rhs);
+    return lhs && rhs;
+}
+
+bool Resolver::_resolve_flat_exp(FlatAst &ast, FlatId root) {
+    if (root == FLAT_NONE) { // invalid ast
+        return false;
+    }
+
+    // Walk the expression like `Visitor::_visit_flat_exp`, which checks a call
+    // before its arguments and skips them if it cannot be made.
+    _flat_frames.push_back({root, false, false});
+    while (!_flat_frames.empty()) {
+        auto &frame = _flat_frames.back();
+        const auto &exp = ast.exps[frame.id];
+        if (!frame.expanded) {
+            frame.expanded = true;
+            switch (exp.kind) {
+            case FlatExp::BINARY: {
+                const auto &node = ast.binary_exps[exp.index];
+                if (node.lhs != FLAT_NONE && node.rhs != FLAT_NONE) {
+                    _flat_frames.push_back({node.rhs, false, false});
+                    _flat_frames.push_back({node.lhs, false, false});
+                }
+                break;
+            }
+            case FlatExp::CALL: {
+                const auto &node = ast.call_exps[exp.index];
+                if (node.ident == FLAT_NONE ||
+                    !_use_function(ast.idents[node.ident], node.arg_count)) {
+                    break;
+                }
+                frame.callable = true;
+                for (uint32_t i = node.arg_count; i > 0; i--) {
+                    auto arg = ast.args[node.first_arg + i - 1];
+                    if (arg != FLAT_NONE) {
+                        _flat_frames.push_back({arg, false, false});
+                    }
+                }
+                break;
+            }
+            case FlatExp::UNARY: {
+                const auto &node = ast.unary_exps[exp.index];
+                if (node.exp != FLAT_NONE) {
+                    _flat_frames.push_back({node.exp, false, false});
+                }
+                break;
+            }
+            case FlatExp::IDENT:
+            case FlatExp::NUMBER:
+                break;
+            }
+            continue;
+        }
+        auto done = frame;
+        _flat_frames.pop_back();
+
+        bool ok = false;
+        switch (exp.kind) {
+        case FlatExp::BINARY: {
+            const auto &node = ast.binary_exps[exp.index];
+            if (node.lhs != FLAT_NONE && node.rhs != FLAT_NONE) {
+                bool rhs = _flat_results.back();
+                _flat_results.pop_back();
+                ok = _flat_results.back() && rhs;
+                _flat_results.pop_back();
+            }
+            break;
+        }
+        case FlatExp::CALL: {
+            if (!done.callable) {
+                break;
+            }
+            const auto &node = ast.call_exps[exp.index];
+            ok = true;
+            for (uint32_t i = 0; i < node.arg_count; i++) {
+                if (ast.args[node.first_arg + i] == FLAT_NONE) {
+                    ok = false;
+                    continue;
+                }
+                ok = ok && _flat_results.back();
+                _flat_results.pop_back();
+            }
+            break;
+        }
+        case FlatExp::UNARY:
+            if (ast.unary_exps[exp.index].exp != FLAT_NONE) {
+                ok = _flat_results.back();
+                _flat_results.pop_back();
+            }
+            break;
+        case FlatExp::IDENT: {
+            auto ident = ast.ident_exps[exp.index].ident;
+            ok = ident != FLAT_NONE && _use_variable(ast.idents[ident]);
+            break;
+        }
+        case FlatExp::NUMBER:
+            ok = true;
+            break;
+        }
+        _flat_results.push_back(ok);
+    }
+
+    bool ok = _flat_results.back();
+    _flat_results.pop_back();
+    return ok;
+}
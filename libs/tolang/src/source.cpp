@@ -0,0 +1,91 @@
+#include "tolang/source.h"
+#include "tolang/source_loc.h"
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceBuffer::SourceBuffer(std::string content) : _owned(std::move(content)) {
+    if (_owned.size() > MAX_SOURCE_SIZE) {
+        throw std::runtime_error("source too large");
+    }
+    _data = _owned.data();
+    _size = _owned.size();
+}
+
+SourceBuffer SourceBuffer::map_file(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open file " + path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        throw std::runtime_error("not a regular file " + path);
+    }
+
+    if (static_cast<uint64_t>(st.st_size) > MAX_SOURCE_SIZE) {
+        close(fd);
+        throw std::runtime_error("file too large " + path);
+    }
+
+    SourceBuffer buffer;
+    if (st.st_size == 0) { // mmap rejects empty mappings
+        close(fd);
+        return buffer;
+    }
+
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("cannot map file " + path);
+    }
+    // the lexer reads the file front to back exactly once
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+    buffer._data = static_cast<const char *>(addr);
+    buffer._size = st.st_size;
+    buffer._mapped = true;
+    return buffer;
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer &&other) noexcept {
+    *this = std::move(other);
+}
+
+SourceBuffer &SourceBuffer::operator=(SourceBuffer &&other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    _release();
+
+    _mapped = other._mapped;
+    _size = other._size;
+    if (_mapped) {
+        _data = other._data;
+    } else {
+        // `_data` may point into the small string buffer of `other._owned`,
+        // so it has to be re-derived after the move
+        _owned = std::move(other._owned);
+        _data = _size == 0 ? "" : _owned.data();
+    }
+
+    other._data = "";
+    other._size = 0;
+    other._mapped = false;
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer() { _release(); }
+
+void SourceBuffer::_release() {
+    if (_mapped) {
+        munmap(const_cast<char *>(_data), _size);
+    }
+    _owned.clear();
+    _data = "";
+    _size = 0;
+    _mapped = false;
+}
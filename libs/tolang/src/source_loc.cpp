@@ -0,0 +1,26 @@
+#include "tolang/source_loc.h"
+#include <algorithm>
+#include <cstring>
+
+LineTable::LineTable(std::string_view source) : _starts{0} {
+    const char *begin = source.data();
+    const char *end = begin + source.size();
+    for (const char *p = begin; p != end; p++) {
+        p = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (p == nullptr) {
+            break;
+        }
+        _starts.push_back(p + 1 - begin);
+    }
+}
+
+int LineTable::line(SourceLoc loc) const {
+    // the last line that starts at or before the location
+    return std::upper_bound(_starts.begin(), _starts.end(), loc.offset) -
+           _starts.begin();
+}
+
+LineColumn LineTable::line_column(SourceLoc loc) const {
+    int line = this->line(loc);
+    return {line, static_cast<int>(loc.offset - _starts[line - 1]) + 1};
+}
@@ -2,23 +2,20 @@
 
 #if TOLANG_BACKEND == LLVM
 
-#include "tolang/error.h"
 #include "tolang/utils.h"
 #include "llvm/ir/Llvm.h"
 #include "llvm/ir/value/ConstantData.h"
 
 void Visitor::visit(const CompUnit &node) {
+    _resolver.resolve(node);
+    if (_stopped()) {
+        return;
+    }
+
     for (auto &elm : node.func_defs) {
         _visit_func_def(*elm);
     }
-
-    // create main function
-    auto context = _ir_module->Context();
-    _cur_func = Function::New(context->GetInt32Ty(), "main");
-    _ir_module->AddMainFunction(_cur_func);
-    _cur_block = _cur_func->NewBasicBlock();
-
-    _cur_scope = _cur_scope->push_scope();
+    _begin_main();
     for (auto &elm : node.var_decls) {
         _visit_var_decl(*elm);
     }
@@ -28,78 +25,108 @@ void Visitor::visit(const CompUnit &node) {
         }
         _visit_stmt(*elm);
     }
-    _cur_scope = _cur_scope->pop_scope();
+    _end_main();
+}
 
-    _cur_block->InsertInstruction(
-        ReturnInst::New(ConstantData::New(context->GetInt32Ty(), 0)));
+void Visitor::begin(const CompUnit &root) { _resolver.begin(root); }
 
-    _cur_block = nullptr;
-    _cur_func = nullptr;
+void Visitor::func_def(const FuncDef &node) {
+    _resolver.func_def(node);
+    if (_stopped()) {
+        return;
+    }
+    _visit_func_def(node);
 }
 
-void Visitor::_visit_func_def(const FuncDef &node) {
-    if (node.ident == nullptr) { // invalid ast
+void Visitor::var_decl(const VarDecl &node) {
+    _resolver.var_decl(node);
+    if (_stopped()) {
         return;
     }
+    _begin_main();
+    _visit_var_decl(node);
+}
 
-    std::vector<std::shared_ptr<VariableSymbol>> param_symbols;
-    for (auto &ident : node.func_f_params) {
-        if (ident == nullptr) { // invalid ast
-            continue;
-        }
-        // here we don't create ir argument, just create symbol
-        param_symbols.push_back(std::make_shared<VariableSymbol>(
-            ident->value, nullptr, ident->lineno));
+void Visitor::stmt(const Stmt &node) {
+    _resolver.stmt(node);
+    if (_stopped()) {
+        return;
     }
+    _begin_main();
+    _visit_stmt(node);
+}
 
-    // create ir function
-    auto context = _ir_module->Context();
-    std::vector<ArgumentPtr> args;
-    for (auto &param_symbol : param_symbols) {
-        auto arg = Argument::New(context->GetFloatTy(), param_symbol->name);
-        args.push_back(arg);
-        param_symbol->value = arg;
+void Visitor::end() {
+    _resolver.end();
+    if (_stopped()) {
+        return;
     }
-    _cur_func = Function::New(context->GetFloatTy(), node.ident->value, args);
-
-    // create function symbol
-    auto symbol = std::make_shared<FunctionSymbol>(
-        node.ident->value, _cur_func, node.lineno, param_symbols.size());
+    _begin_main();
+    _end_main();
+}
 
-    // try to add function symbol to current scope
-    if (!_cur_scope->add_symbol(symbol)) {
-        auto pre_defined = _cur_scope->get_symbol(node.ident->value);
-        ErrorReporter::error(node.lineno,
-                             "redefine function " + node.ident->value +
-                                 ", previous defined at line " +
-                                 std::to_string(pre_defined->lineno));
+void Visitor::visit(FlatAst &ast) {
+    _resolver.resolve(ast);
+    if (_stopped()) {
         return;
     }
 
-    // if success, add function to module
-    _ir_module->AddFunction(_cur_func);
+    for (auto &func_def : ast.func_defs) {
+        _visit_flat_func_def(ast, func_def);
+    }
 
-    // then create entry block
+    _begin_main();
+    for (auto &var_decl : ast.var_decls) {
+        if (var_decl.ident == FLAT_NONE) { // invalid ast
+            continue;
+        }
+        _gen_var_decl(ast.idents[var_decl.ident]);
+    }
+    for (auto &stmt : ast.stmts) {
+        _visit_flat_stmt(ast, stmt);
+    }
+    _end_main();
+}
+
+void Visitor::_begin_main() {
+    if (_in_main) {
+        return;
+    }
+    _in_main = true;
+
+    // create main function
+    auto context = _ir_module->Context();
+    _cur_func = Function::New(context->GetInt32Ty(), "main");
+    _ir_module->AddMainFunction(_cur_func);
     _cur_block = _cur_func->NewBasicBlock();
+}
 
-    // new scope for function
-    _cur_scope = _cur_scope->push_scope();
+void Visitor::_end_main() {
+    _in_main = false;
 
-    for (auto &param_symbol : param_symbols) {
-        if (!_cur_scope->add_symbol(param_symbol)) {
-            auto pre_defined = _cur_scope->get_symbol(param_symbol->name);
-            ErrorReporter::error(param_symbol->lineno,
-                                 "redefine parameter " + param_symbol->name +
-                                     ", previous defined at line " +
-                                     std::to_string(pre_defined->lineno));
-        }
+    auto context = _ir_module->Context();
+    _cur_block->InsertInstruction(
+        ReturnInst::New(ConstantData::New(context->GetInt32Ty(), 0)));
 
-        // alloca & store inst should be inserted at the first block
-        auto alloca = AllocaInst::New(context->GetFloatTy());
-        _cur_block->InsertInstruction(alloca);
-        auto store = StoreInst::New(param_symbol->value, alloca);
-        _cur_block->InsertInstruction(store);
-        param_symbol->value = alloca;
+    _cur_block = nullptr;
+    _cur_func = nullptr;
+}
+
+void Visitor::_visit_func_def(const FuncDef &node) {
+    if (node.ident == nullptr) { // invalid ast
+        return;
+    }
+    _exp_values.clear();
+
+    std::vector<const Ident *> params;
+    for (auto &ident : node.func_f_params) {
+        if (ident == nullptr) { // invalid ast
+            continue;
+        }
+        params.push_back(ident);
+    }
+    if (!_begin_func_def(*node.ident, params)) {
+        return;
     }
 
     // our tiny function body only contains a return statement
@@ -110,38 +137,18 @@ void Visitor::_visit_func_def(const FuncDef &node) {
     if (val == nullptr) {
         return;
     }
-    _cur_block->InsertInstruction(ReturnInst::New(val));
-
-    _cur_scope = _cur_scope->pop_scope();
-
-    _cur_block = nullptr;
-    _cur_func = nullptr;
+    _end_func_def(val);
 }
 
 void Visitor::_visit_var_decl(const VarDecl &node) {
     if (node.ident == nullptr) { // invalid ast
         return;
     }
-
-    auto context = _ir_module->Context();
-    auto alloca = AllocaInst::New(context->GetFloatTy());
-    auto symbol = std::make_shared<VariableSymbol>(node.ident->value, alloca,
-                                                   node.ident->lineno);
-
-    if (!_cur_scope->add_symbol(symbol)) {
-        auto pre_defined = _cur_scope->get_symbol(node.ident->value);
-        ErrorReporter::error(node.ident->lineno,
-                             "redefine variable " + node.ident->value +
-                                 ", previous defined at line " +
-                                 std::to_string(pre_defined->lineno));
-        return;
-    }
-
-    // alloca inst should be inserted at the first block
-    (*_cur_func->BasicBlockBegin())->InsertInstruction(alloca);
+    _gen_var_decl(*node.ident);
 }
 
 void Visitor::_visit_stmt(const Stmt &node) {
+    _exp_values.clear();
     std::visit(overloaded{
                    [this](const GetStmt &node) { _visit_get_stmt(node); },
                    [this](const PutStmt &node) { _visit_put_stmt(node); },
@@ -157,17 +164,7 @@ void Visitor::_visit_get_stmt(const GetStmt &node) {
     if (node.ident == nullptr) { // invalid ast
         return;
     }
-
-    auto symbol = _cur_scope->get_symbol(node.ident->value);
-    if (symbol == nullptr) {
-        ErrorReporter::error(node.ident->lineno,
-                             "undefined symbol " + node.ident->value);
-        return;
-    }
-    auto input = InputInst::New(_ir_module->Context());
-    _cur_block->InsertInstruction(input);
-    auto store = StoreInst::New(input, symbol->value);
-    _cur_block->InsertInstruction(store);
+    _gen_get(*node.ident);
 }
 
 void Visitor::_visit_put_stmt(const PutStmt &node) {
@@ -185,49 +182,7 @@ void Visitor::_visit_tag_stmt(const TagStmt &node) {
     if (node.ident == nullptr) { // invalid ast
         return;
     }
-
-    if (_cur_scope->exist_in_scope(node.ident->value)) {
-        auto symbol = _cur_scope->get_symbol(node.ident->value);
-        if (symbol->type != SymbolType::TAG) {
-            ErrorReporter::error(node.ident->lineno,
-                                 node.ident->value + " is not a tag, but a " +
-                                     symbol_type_to_string(symbol->type) +
-                                     ", defined at line " +
-                                     std::to_string(symbol->lineno));
-            return;
-        }
-
-        auto tag_symbol = std::dynamic_pointer_cast<TagSymbol>(symbol);
-
-        // create new label
-        auto jump = JumpInst::New(_ir_module->Context());
-        _cur_block->InsertInstruction(jump);
-        _cur_block = _cur_func->NewBasicBlock();
-        jump->SetTarget(_cur_block);
-        auto label = _cur_block;
-        tag_symbol->target = label;
-
-        // backpatching all jump inst before tag
-        for (auto &inst : tag_symbol->jump_insts) {
-            if (auto branch = dynamic_cast<BranchInst *>(inst)) {
-                branch->SetTrueBlock(label);
-            } else if (auto jump = dynamic_cast<JumpInst *>(inst)) {
-                jump->SetTarget(label);
-            }
-        }
-
-    } else {
-        auto jump = JumpInst::New(_ir_module->Context());
-        _cur_block->InsertInstruction(jump);
-        _cur_block = _cur_func->NewBasicBlock();
-        jump->SetTarget(_cur_block);
-        auto label = _cur_block;
-
-        auto symbol = std::make_shared<TagSymbol>(node.ident->value, nullptr,
-                                                  node.ident->lineno);
-        symbol->target = label;
-        _cur_scope->add_symbol(symbol);
-    }
+    _gen_tag(*node.ident);
 }
 
 void Visitor::_visit_let_stmt(const LetStmt &node) {
@@ -235,23 +190,10 @@ void Visitor::_visit_let_stmt(const LetStmt &node) {
         return;
     }
 
-    auto symbol = _cur_scope->get_symbol(node.ident->value);
-    if (symbol == nullptr) {
-        ErrorReporter::error(node.ident->lineno,
-                             "undefined symbol " + node.ident->value);
-        return;
-    }
-    if (symbol->type != SymbolType::VAR) {
-        ErrorReporter::error(node.ident->lineno,
-                             node.ident->value + " is not a variable, but a " +
-                                 symbol_type_to_string(symbol->type) +
-                                 ", defined at line " +
-                                 std::to_string(symbol->lineno));
+    if (node.ident->slot == NO_SLOT) {
         return;
     }
 
-    auto var_symbol = std::dynamic_pointer_cast<VariableSymbol>(symbol);
-
     if (node.exp == nullptr) { // invalid ast
         return;
     }
@@ -260,11 +202,9 @@ void Visitor::_visit_let_stmt(const LetStmt &node) {
         return;
     }
 
-    // get var symbol's addr (alloca inst)
-    auto addr = var_symbol->value;
-
-    // store value to addr
-    _cur_block->InsertInstruction(StoreInst::New(exp_val, addr));
+    // store value to var symbol's addr (alloca inst)
+    _cur_block->InsertInstruction(
+        StoreInst::New(exp_val, _slot(node.ident->slot).value));
 }
 
 void Visitor::_visit_if_stmt(const IfStmt &node) {
@@ -273,116 +213,483 @@ void Visitor::_visit_if_stmt(const IfStmt &node) {
     }
 
     auto val = _visit_cond(*node.cond);
-    if (val == nullptr) {
+    if (val == nullptr || node.ident == nullptr) {
         return;
     }
-
-    if (_cur_scope->exist_in_scope(node.ident->value)) {
-        auto symbol = _cur_scope->get_symbol(node.ident->value);
-        if (symbol->type != SymbolType::TAG) {
-            ErrorReporter::error(node.ident->lineno,
-                                 node.ident->value + " is not a tag, but a " +
-                                     symbol_type_to_string(symbol->type) +
-                                     ", defined at line " +
-                                     std::to_string(symbol->lineno));
-            return;
-        }
-
-        auto jump = BranchInst::New(val, nullptr, nullptr);
-        _cur_block->InsertInstruction(jump);
-        _cur_block = _cur_func->NewBasicBlock();
-        jump->SetFalseBlock(_cur_block);
-
-        // if the tag is not declared, add jump inst to symbol.
-        // otherwise set the target of jump to tag
-        auto tag_symbol = std::static_pointer_cast<TagSymbol>(symbol);
-        if (tag_symbol->target) {
-            jump->SetTrueBlock(tag_symbol->target);
-        } else {
-            tag_symbol->jump_insts.push_back(jump);
-        }
-
-    } else {
-        auto jump = BranchInst::New(val, nullptr, nullptr);
-        _cur_block->InsertInstruction(jump);
-        _cur_block = _cur_func->NewBasicBlock();
-        jump->SetFalseBlock(_cur_block);
-
-        auto symbol =
-            std::make_shared<TagSymbol>(node.ident->value, nullptr, -1);
-        _cur_scope->add_symbol(symbol);
-        // add jump inst to symbol
-        symbol->jump_insts.push_back(jump);
-    }
+    _gen_branch(val, *node.ident);
 }
 
 void Visitor::_visit_to_stmt(const ToStmt &node) {
     if (node.ident == nullptr) { // invalid ast
         return;
     }
+    _gen_jump(*node.ident);
+}
 
-    if (_cur_scope->exist_in_scope(node.ident->value)) {
-        auto symbol = _cur_scope->get_symbol(node.ident->value);
-        if (symbol->type != SymbolType::TAG) {
-            ErrorReporter::error(node.ident->lineno,
-                                 node.ident->value + " is not a tag, but a " +
-                                     symbol_type_to_string(symbol->type) +
-                                     ", defined at line " +
-                                     std::to_string(symbol->lineno));
-            return;
+ValuePtr Visitor::_visit_exp(const Exp &root) {
+    // Walk the expression with an explicit stack like `_visit_flat_exp`, so
+    // that deep expressions do not overflow the call stack.
+    _exp_frames.push_back({&root, false, NO_SLOT});
+    while (!_exp_frames.empty()) {
+        auto &frame = _exp_frames.back();
+        const auto &exp = *frame.exp;
+        if (!frame.expanded) {
+            if (_memoize_exps) {
+                auto it = _exp_values.find(&exp);
+                if (it != _exp_values.end()) {
+                    _exp_frames.pop_back();
+                    _values.push_back(it->second);
+                    continue;
+                }
+            }
+            frame.expanded = true;
+            _expand_exp(exp);
+            continue;
         }
-
-        auto jump = JumpInst::New(_ir_module->Context());
-        _cur_block->InsertInstruction(jump);
-        _cur_block = _cur_func->NewBasicBlock();
-
-        // if the tag is not declared, add jump inst to symbol.
-        // otherwise set the target of jump to tag
-        auto tag_symbol = std::static_pointer_cast<TagSymbol>(symbol);
-        if (tag_symbol->target) {
-            jump->SetTarget(tag_symbol->target);
-        } else {
-            tag_symbol->jump_insts.push_back(jump);
+        auto done = frame;
+        _exp_frames.pop_back();
+        auto val = _finish_exp(exp, done.func);
+        if (_memoize_exps) {
+            _exp_values.emplace(&exp, val);
         }
-    } else {
-        auto jump = JumpInst::New(_ir_module->Context());
-        _cur_block->InsertInstruction(jump);
-        _cur_block = _cur_func->NewBasicBlock();
+        _values.push_back(val);
+    }
 
-        auto symbol =
-            std::make_shared<TagSymbol>(node.ident->value, nullptr, -1);
-        _cur_scope->add_symbol(symbol);
+    auto val = _values.back();
+    _values.pop_back();
+    return val;
+}
 
-        // add jump inst to symbol
-        symbol->jump_insts.push_back(jump);
-    }
+void Visitor::_expand_exp(const Exp &exp) {
+    std::visit(
+        overloaded{
+            [this](const BinaryExp &node) {
+                if (node.lhs != nullptr && node.rhs != nullptr) {
+                    _exp_frames.push_back({node.rhs, false, NO_SLOT});
+                    _exp_frames.push_back({node.lhs, false, NO_SLOT});
+                }
+            },
+            [this](const CallExp &node) {
+                if (node.ident == nullptr || node.ident->slot == NO_SLOT) {
+                    return;
+                }
+                _exp_frames.back().func = node.ident->slot;
+                for (auto i = node.func_r_params.size(); i > 0; i--) {
+                    auto arg = node.func_r_params[i - 1];
+                    if (arg != nullptr) {
+                        _exp_frames.push_back({arg, false, NO_SLOT});
+                    }
+                }
+            },
+            [this](const UnaryExp &node) {
+                if (node.exp != nullptr) {
+                    _exp_frames.push_back({node.exp, false, NO_SLOT});
+                }
+            },
+            [](const IdentExp &) {},
+            [](const Number &) {},
+        },
+        exp);
 }
 
-ValuePtr Visitor::_visit_exp(const Exp &node) {
+ValuePtr Visitor::_finish_exp(const Exp &exp, uint32_t func) {
     return std::visit(
         overloaded{
-            [this](const BinaryExp &node) { return _visit_binary_exp(node); },
-            [this](const CallExp &node) { return _visit_call_exp(node); },
-            [this](const UnaryExp &node) { return _visit_unary_exp(node); },
-            [this](const IdentExp &node) { return _visit_ident_exp(node); },
-            [this](const Number &node) { return _visit_number(node); },
+            [this](const BinaryExp &node) -> ValuePtr {
+                if (node.lhs == nullptr ||
+                    node.rhs == nullptr) { // invalid ast
+                    return nullptr;
+                }
+                auto right_val = _values.back();
+                _values.pop_back();
+                auto left_val = _values.back();
+                _values.pop_back();
+                return _gen_binary(node.op, left_val, right_val);
+            },
+            [this, func](const CallExp &node) -> ValuePtr {
+                if (func == NO_SLOT) {
+                    return nullptr;
+                }
+                std::size_t visited = 0;
+                for (auto arg : node.func_r_params) {
+                    visited += arg != nullptr;
+                }
+                _pop_args(visited);
+                return _gen_call(func, _args);
+            },
+            [this](const UnaryExp &node) -> ValuePtr {
+                if (node.exp == nullptr) { // invalid ast
+                    return nullptr;
+                }
+                auto val = _values.back();
+                _values.pop_back();
+                return _gen_unary(node.op, val);
+            },
+            [this](const IdentExp &node) -> ValuePtr {
+                if (node.ident == nullptr) { // invalid ast
+                    return nullptr;
+                }
+                return _gen_load(*node.ident);
+            },
+            [this](const Number &node) { return _gen_number(node.value); },
         },
-        node);
+        exp);
 }
 
-ValuePtr Visitor::_visit_binary_exp(const BinaryExp &node) {
+void Visitor::_pop_args(std::size_t count) {
+    _args.clear();
+    for (auto it = _values.end() - count; it != _values.end(); ++it) {
+        if (*it != nullptr) {
+            _args.push_back(*it);
+        }
+    }
+    _values.resize(_values.size() - count);
+}
+
+ValuePtr Visitor::_visit_cond(const Cond &node) {
     if (node.lhs == nullptr || node.rhs == nullptr) { // invalid ast
         return nullptr;
     }
     auto left_val = _visit_exp(*node.lhs);
     auto right_val = _visit_exp(*node.rhs);
+    return _gen_compare(node.op, left_val, right_val);
+}
+
+void Visitor::_visit_flat_func_def(const FlatAst &ast,
+                                   const FlatFuncDef &node) {
+    if (node.ident == FLAT_NONE) { // invalid ast
+        return;
+    }
+
+    std::vector<const Ident *> params;
+    for (uint32_t i = 0; i < node.param_count; i++) {
+        auto param = ast.params[node.first_param + i];
+        if (param == FLAT_NONE) { // invalid ast
+            continue;
+        }
+        params.push_back(&ast.idents[param]);
+    }
+    if (!_begin_func_def(ast.idents[node.ident], params)) {
+        return;
+    }
+
+    auto val = _visit_flat_exp(ast, node.exp);
+    if (val == nullptr) {
+        return;
+    }
+    _end_func_def(val);
+}
+
+void Visitor::_visit_flat_stmt(const FlatAst &ast, const FlatStmt &node) {
+    // the checks mirror those of the `_visit_*_stmt` functions
+    const Ident *ident =
+        node.ident != FLAT_NONE ? &ast.idents[node.ident] : nullptr;
+    switch (node.kind) {
+    case FlatStmt::GET:
+        if (ident != nullptr) {
+            _gen_get(*ident);
+        }
+        break;
+    case FlatStmt::PUT: {
+        auto val = _visit_flat_exp(ast, node.exp);
+        if (val != nullptr) {
+            _cur_block->InsertInstruction(OutputInst::New(val));
+        }
+        break;
+    }
+    case FlatStmt::TAG:
+        if (ident != nullptr) {
+            _gen_tag(*ident);
+        }
+        break;
+    case FlatStmt::LET: {
+        if (ident == nullptr || ident->slot == NO_SLOT) {
+            break;
+        }
+        auto exp_val = _visit_flat_exp(ast, node.exp);
+        if (exp_val != nullptr) {
+            _cur_block->InsertInstruction(
+                StoreInst::New(exp_val, _slot(ident->slot).value));
+        }
+        break;
+    }
+    case FlatStmt::IF: {
+        if (node.exp == FLAT_NONE) {
+            break;
+        }
+        const auto &cond = ast.conds[node.exp];
+        if (cond.lhs == FLAT_NONE || cond.rhs == FLAT_NONE) {
+            break;
+        }
+        auto left_val = _visit_flat_exp(ast, cond.lhs);
+        auto right_val = _visit_flat_exp(ast, cond.rhs);
+        auto val = _gen_compare(cond.op, left_val, right_val);
+        if (val != nullptr && ident != nullptr) {
+            _gen_branch(val, *ident);
+        }
+        break;
+    }
+    case FlatStmt::TO:
+        if (ident != nullptr) {
+            _gen_jump(*ident);
+        }
+        break;
+    }
+}
+
+ValuePtr Visitor::_visit_flat_exp(const FlatAst &ast, FlatId root) {
+    if (root == FLAT_NONE) { // invalid ast
+        return nullptr;
+    }
+
+    // Walk the expression with an explicit stack. A node is expanded before
+    // its children are visited, so that a call is checked first, and finished
+    // after them, when the values of its children are on top of `_values`.
+    _flat_frames.push_back({root, false, NO_SLOT});
+    while (!_flat_frames.empty()) {
+        auto &frame = _flat_frames.back();
+        const auto &exp = ast.exps[frame.id];
+        if (!frame.expanded) {
+            frame.expanded = true;
+            _expand_flat_exp(ast, exp);
+            continue;
+        }
+        auto done = frame;
+        _flat_frames.pop_back();
+        _values.push_back(_finish_flat_exp(ast, exp, done.func));
+    }
+
+    auto val = _values.back();
+    _values.pop_back();
+    return val;
+}
+
+void Visitor::_expand_flat_exp(const FlatAst &ast, const FlatExp &exp) {
+    switch (exp.kind) {
+    case FlatExp::BINARY: {
+        const auto &node = ast.binary_exps[exp.index];
+        if (node.lhs != FLAT_NONE && node.rhs != FLAT_NONE) {
+            _flat_frames.push_back({node.rhs, false, NO_SLOT});
+            _flat_frames.push_back({node.lhs, false, NO_SLOT});
+        }
+        break;
+    }
+    case FlatExp::CALL: {
+        const auto &node = ast.call_exps[exp.index];
+        if (node.ident == FLAT_NONE || ast.idents[node.ident].slot == NO_SLOT) {
+            break;
+        }
+        _flat_frames.back().func = ast.idents[node.ident].slot;
+        for (uint32_t i = node.arg_count; i > 0; i--) {
+            auto arg = ast.args[node.first_arg + i - 1];
+            if (arg != FLAT_NONE) {
+                _flat_frames.push_back({arg, false, NO_SLOT});
+            }
+        }
+        break;
+    }
+    case FlatExp::UNARY: {
+        const auto &node = ast.unary_exps[exp.index];
+        if (node.exp != FLAT_NONE) {
+            _flat_frames.push_back({node.exp, false, NO_SLOT});
+        }
+        break;
+    }
+    case FlatExp::IDENT:
+    case FlatExp::NUMBER:
+        break;
+    }
+}
+
+ValuePtr Visitor::_finish_flat_exp(const FlatAst &ast, const FlatExp &exp,
+                                   uint32_t func) {
+    switch (exp.kind) {
+    case FlatExp::BINARY: {
+        const auto &node = ast.binary_exps[exp.index];
+        if (node.lhs == FLAT_NONE || node.rhs == FLAT_NONE) { // invalid ast
+            return nullptr;
+        }
+        auto right_val = _values.back();
+        _values.pop_back();
+        auto left_val = _values.back();
+        _values.pop_back();
+        return _gen_binary(node.op, left_val, right_val);
+    }
+    case FlatExp::CALL: {
+        if (func == NO_SLOT) {
+            return nullptr;
+        }
+        const auto &node = ast.call_exps[exp.index];
+        std::size_t visited = 0;
+        for (uint32_t i = 0; i < node.arg_count; i++) {
+            visited += ast.args[node.first_arg + i] != FLAT_NONE;
+        }
+        _pop_args(visited);
+        return _gen_call(func, _args);
+    }
+    case FlatExp::UNARY: {
+        const auto &node = ast.unary_exps[exp.index];
+        if (node.exp == FLAT_NONE) { // invalid ast
+            return nullptr;
+        }
+        auto val = _values.back();
+        _values.pop_back();
+        return _gen_unary(node.op, val);
+    }
+    case FlatExp::IDENT: {
+        const auto &node = ast.ident_exps[exp.index];
+        if (node.ident == FLAT_NONE) { // invalid ast
+            return nullptr;
+        }
+        return _gen_load(ast.idents[node.ident]);
+    }
+    case FlatExp::NUMBER:
+        return _gen_number(ast.numbers[exp.index].value);
+    }
+    return nullptr; // unreachable
+}
+
+bool Visitor::_begin_func_def(const Ident &ident,
+                              const std::vector<const Ident *> &params) {
+    if (ident.slot == NO_SLOT) { // redefined
+        return false;
+    }
+
+    // create ir function
+    auto context = _ir_module->Context();
+    std::vector<ArgumentPtr> args;
+    for (auto param : params) {
+        args.push_back(
+            Argument::New(context->GetFloatTy(), std::string(param->value)));
+    }
+    _cur_func =
+        Function::New(context->GetFloatTy(), std::string(ident.value), args);
+    _slot(ident.slot).value = _cur_func;
+
+    _ir_module->AddFunction(_cur_func);
+
+    // then create entry block
+    _cur_block = _cur_func->NewBasicBlock();
+
+    for (std::size_t i = 0; i < params.size(); i++) {
+        // alloca & store inst should be inserted at the first block
+        auto alloca = AllocaInst::New(context->GetFloatTy());
+        _cur_block->InsertInstruction(alloca);
+        auto store = StoreInst::New(args[i], alloca);
+        _cur_block->InsertInstruction(store);
+        _slot(params[i]->slot).value = alloca;
+    }
+    return true;
+}
+
+void Visitor::_end_func_def(ValuePtr val) {
+    _cur_block->InsertInstruction(ReturnInst::New(val));
+
+    _cur_block = nullptr;
+    _cur_func = nullptr;
+}
+
+void Visitor::_gen_var_decl(const Ident &ident) {
+    if (ident.slot == NO_SLOT) { // redefined
+        return;
+    }
+
+    // alloca inst should be inserted at the first block
+    auto alloca = AllocaInst::New(_ir_module->Context()->GetFloatTy());
+    (*_cur_func->BasicBlockBegin())->InsertInstruction(alloca);
+    _slot(ident.slot).value = alloca;
+}
+
+void Visitor::_gen_get(const Ident &ident) {
+    if (ident.slot == NO_SLOT) {
+        return;
+    }
+    auto input = InputInst::New(_ir_module->Context());
+    _cur_block->InsertInstruction(input);
+    auto store = StoreInst::New(input, _slot(ident.slot).value);
+    _cur_block->InsertInstruction(store);
+}
+
+void Visitor::_gen_tag(const Ident &ident) {
+    if (ident.slot == NO_SLOT) {
+        return;
+    }
+    auto &tag = _slot(ident.slot);
+
+    // create new label
+    auto jump = JumpInst::New(_ir_module->Context());
+    _cur_block->InsertInstruction(jump);
+    _cur_block = _cur_func->NewBasicBlock();
+    jump->SetTarget(_cur_block);
+    auto label = _cur_block;
+    tag.target = label;
+
+    // backpatching all jump inst before tag
+    for (auto &inst : tag.jump_insts) {
+        if (inst->Is<BranchInst>()) {
+            inst->As<BranchInst>()->SetTrueBlock(label);
+        } else if (inst->Is<JumpInst>()) {
+            inst->As<JumpInst>()->SetTarget(label);
+        }
+    }
+}
+
+void Visitor::_gen_branch(ValuePtr cond, const Ident &ident) {
+    if (ident.slot == NO_SLOT) {
+        return;
+    }
+    auto &tag = _slot(ident.slot);
+
+    auto jump = BranchInst::New(cond, nullptr, nullptr);
+    _cur_block->InsertInstruction(jump);
+    _cur_block = _cur_func->NewBasicBlock();
+    jump->SetFalseBlock(_cur_block);
+
+    // if the tag is not declared, add jump inst to symbol.
+    // otherwise set the target of jump to tag
+    if (tag.target) {
+        jump->SetTrueBlock(tag.target);
+    } else {
+        tag.jump_insts.push_back(jump);
+    }
+}
+
+void Visitor::_gen_jump(const Ident &ident) {
+    if (ident.slot == NO_SLOT) {
+        return;
+    }
+    auto &tag = _slot(ident.slot);
+
+    auto jump = JumpInst::New(_ir_module->Context());
+    _cur_block->InsertInstruction(jump);
+    _cur_block = _cur_func->NewBasicBlock();
+
+    // if the tag is not declared, add jump inst to symbol.
+    // otherwise set the target of jump to tag
+    if (tag.target) {
+        jump->SetTarget(tag.target);
+    } else {
+        tag.jump_insts.push_back(jump);
+    }
+}
+
+Visitor::_Slot &Visitor::_slot(uint32_t slot) {
+    // slots are given out while a tree is streamed, too
+    if (slot >= _slots.size()) {
+        _slots.resize(_resolver.size());
+    }
+    return _slots[slot];
+}
+
+ValuePtr Visitor::_gen_binary(BinaryExp::BinaryOp op, ValuePtr left_val,
+                              ValuePtr right_val) {
     if (!left_val || !right_val) {
         return nullptr;
     }
 
     // get ir binary op type, just map from ast to ir
     BinaryOpType ir_op;
-    switch (node.op) {
+    switch (op) {
     case BinaryExp::PLUS:
         ir_op = BinaryOpType::Add;
         break;
@@ -408,77 +715,28 @@ ValuePtr Visitor::_visit_binary_exp(const BinaryExp &node) {
     return val;
 }
 
-ValuePtr Visitor::_visit_call_exp(const CallExp &node) {
-    if (node.ident == nullptr) { // invalid ast
-        return nullptr;
-    }
-
-    auto symbol = _cur_scope->get_symbol(node.ident->value);
-    if (symbol == nullptr) {
-        ErrorReporter::error(node.ident->lineno,
-                             "undefined symbol " + node.ident->value);
-        return nullptr;
-    }
-    if (symbol->type != SymbolType::FUNC) {
-        ErrorReporter::error(node.ident->lineno,
-                             node.ident->value + " is not a function, but a " +
-                                 symbol_type_to_string(symbol->type) +
-                                 ", defined at line " +
-                                 std::to_string(symbol->lineno));
-        return nullptr;
-    }
-
-    auto func_symbol = std::static_pointer_cast<FunctionSymbol>(symbol);
-
-    if (func_symbol->params_count != node.func_r_params.size()) {
-        ErrorReporter::error(
-            node.ident->lineno,
-            "params number not matched in function call " + node.ident->value +
-                ", expect " + std::to_string(func_symbol->params_count) +
-                " but got " + std::to_string(node.func_r_params.size()));
-        return nullptr;
-    }
-
-    std::vector<ValuePtr> values;
-    for (auto &exp : node.func_r_params) {
-        if (exp == nullptr) { // invalid ast
-            continue;
-        }
-        auto exp_val = _visit_exp(*exp);
-        if (exp_val == nullptr) {
-            continue;
-        }
-        values.push_back(exp_val);
-    }
-
-    if (values.size() != func_symbol->params_count) { // invalid ast
+ValuePtr Visitor::_gen_call(uint32_t func,
+                            const std::vector<ValuePtr> &values) {
+    if (values.size() != _resolver.symbol(func).params_count) { // invalid ast
         return nullptr;
     }
 
     // create call inst
-    std::vector<ValuePtr> params;
-    for (auto &val : values) {
-        params.push_back(val);
-    }
     auto call =
-        CallInst::New(static_cast<FunctionPtr>(func_symbol->value), params);
+        CallInst::New(static_cast<FunctionPtr>(_slot(func).value), values);
     _cur_block->InsertInstruction(call);
 
     return call;
 }
 
-ValuePtr Visitor::_visit_unary_exp(const UnaryExp &node) {
-    if (node.exp == nullptr) { // invalid ast
-        return nullptr;
-    }
-    auto exp_val = _visit_exp(*node.exp);
+ValuePtr Visitor::_gen_unary(decltype(UnaryExp::op) op, ValuePtr exp_val) {
     if (exp_val == nullptr) {
         return nullptr;
     }
 
     // get ir unary op type, just map from ast to ir
     UnaryOpType ir_op;
-    switch (node.op) {
+    switch (op) {
     case UnaryExp::MINU:
         ir_op = UnaryOpType::Neg;
         break;
@@ -495,54 +753,31 @@ ValuePtr Visitor::_visit_unary_exp(const UnaryExp &node) {
     return val;
 }
 
-ValuePtr Visitor::_visit_ident_exp(const IdentExp &node) {
-    if (node.ident == nullptr) { // invalid ast
-        return nullptr;
-    }
-
-    auto symbol = _cur_scope->get_symbol(node.ident->value);
-    if (symbol == nullptr) {
-        ErrorReporter::error(node.ident->lineno,
-                             "undefined symbol " + node.ident->value);
-        return nullptr;
-    }
-    if (symbol->type != SymbolType::VAR) {
-        ErrorReporter::error(node.ident->lineno,
-                             node.ident->value + " is not a variable, but a " +
-                                 symbol_type_to_string(symbol->type) +
-                                 ", defined at line " +
-                                 std::to_string(symbol->lineno));
+ValuePtr Visitor::_gen_load(const Ident &ident) {
+    if (ident.slot == NO_SLOT) {
         return nullptr;
     }
 
     // load value from addr
-    auto var_symbol = std::static_pointer_cast<VariableSymbol>(symbol);
-    auto addr = var_symbol->value;
-    auto val = LoadInst::New(addr);
+    auto val = LoadInst::New(_slot(ident.slot).value);
     _cur_block->InsertInstruction(val);
 
     return val;
 }
 
-ValuePtr Visitor::_visit_number(const Number &node) {
+ValuePtr Visitor::_gen_number(float value) {
     // return const value
-    auto val =
-        ConstantData::New(_ir_module->Context()->GetFloatTy(), node.value);
-    return val;
+    return ConstantData::New(_ir_module->Context()->GetFloatTy(), value);
 }
 
-ValuePtr Visitor::_visit_cond(const Cond &node) {
-    if (node.lhs == nullptr || node.rhs == nullptr) { // invalid ast
-        return nullptr;
-    }
-    auto left_val = _visit_exp(*node.lhs);
-    auto right_val = _visit_exp(*node.rhs);
+ValuePtr Visitor::_gen_compare(decltype(Cond::op) op, ValuePtr left_val,
+                               ValuePtr right_val) {
     if (left_val == nullptr || right_val == nullptr) {
         return nullptr;
     }
 
     CompareOpType ir_op;
-    switch (node.op) {
+    switch (op) {
     case Cond::EQ:
         ir_op = CompareOpType::Equal;
         break;
@@ -574,14 +809,16 @@ ValuePtr Visitor::_visit_cond(const Cond &node) {
 #elif TOLANG_BACKEND == PCODE
 
 void PcodeVisitor::visit(const CompUnit &node) {
+    _resolver.resolve(node);
+    if (stopped()) {
+        return;
+    }
+
     for (auto &elm : node.func_defs) {
         visitFuncDef(*elm);
     }
 
-    createBlock();
-    auto label = PcodeInstruction::create<PcodeLabelInst>("_Main");
-    _curBlock->insertInst(label);
-    _module.addLabel("_Main", _curBlock);
+    beginMain();
 
     for (auto &elm : node.var_decls) {
         visitVarDecl(*elm);
@@ -592,18 +829,90 @@ void PcodeVisitor::visit(const CompUnit &node) {
     }
 }
 
-void PcodeVisitor::visitFuncDef(const FuncDef &node) {
+void PcodeVisitor::func_def(const FuncDef &node) {
+    _resolver.func_def(node);
+    if (stopped()) {
+        return;
+    }
+    visitFuncDef(node);
+}
+
+void PcodeVisitor::var_decl(const VarDecl &node) {
+    _resolver.var_decl(node);
+    if (stopped()) {
+        return;
+    }
+    beginMain();
+    visitVarDecl(node);
+}
+
+void PcodeVisitor::stmt(const Stmt &node) {
+    _resolver.stmt(node);
+    if (stopped()) {
+        return;
+    }
+    beginMain();
+    visitStmt(node);
+}
+
+void PcodeVisitor::end() {
+    _resolver.end();
+    if (stopped()) {
+        return;
+    }
+    beginMain();
+}
+
+void PcodeVisitor::visit(FlatAst &ast) {
+    _resolver.resolve(ast);
+    if (stopped()) {
+        return;
+    }
+
+    for (auto &funcDef : ast.func_defs) {
+        std::vector<const Ident *> params;
+        for (uint32_t i = 0; i < funcDef.param_count; i++) {
+            params.push_back(&ast.idents[ast.params[funcDef.first_param + i]]);
+        }
+        beginFunction(ast.idents[funcDef.ident], params);
+        visitFlatExp(ast, funcDef.exp);
+        endFunction();
+    }
+
+    beginMain();
+
+    for (auto &varDecl : ast.var_decls) {
+        genVarDecl(ast.idents[varDecl.ident]);
+    }
+
+    for (auto &stmt : ast.stmts) {
+        visitFlatStmt(ast, stmt);
+    }
+}
+
+void PcodeVisitor::beginMain() {
+    if (_inMain) {
+        return;
+    }
+    _inMain = true;
+
+    createBlock();
+    auto label = PcodeInstruction::create<PcodeLabelInst>("_Main");
+    _curBlock->insertInst(label);
+    _module.addLabel("_Main", _curBlock);
+}
+
+void PcodeVisitor::beginFunction(const Ident &ident, const std::vector<const Ident *> &params) {
     // Get function name and parameter count
-    auto funcName = node.ident->value;
-    auto paramCounter = node.func_f_params.size();
+    auto funcName = std::string(ident.value);
+    auto paramCounter = params.size();
 
     // Create a pcode function object
     auto pcodeFunc = PcodeFunction::create(funcName, paramCounter);
     _module.addFunction(funcName, pcodeFunc);
-
-    // Add to symbol table
-    auto symbol = PcodeSymbol::create(funcName, PcodeSymbol::P_FUNC);
-    _symbolTable.insertSymbol(symbol);
+    if (ident.slot != NO_SLOT) {
+        slotOf(ident).function = &_module.getFunction(funcName);
+    }
 
     // Create a new block with a label as the first inst
     createBlock();
@@ -611,34 +920,48 @@ void PcodeVisitor::visitFuncDef(const FuncDef &node) {
     _module.addLabel(funcName, _curBlock);
     _curBlock->insertInst(label);
 
-    // Create a new symbol table node for function parameters
-    _symbolTable.pushScope();
-    
-    for (auto &param : node.func_f_params) {
-        auto symbol = PcodeSymbol::create(param->value, PcodeSymbol::P_VAR);
-        _symbolTable.insertSymbol(symbol);
+    // Parameters are loaded by their position among the arguments
+    for (std::size_t i = 0; i < params.size(); i++) {
+        if (params[i]->slot != NO_SLOT) {
+            slotOf(*params[i]).argument = i + 1;
+        }
     }
+}
 
-    visitExp(*node.exp);
-    _symbolTable.popScope();
-
+void PcodeVisitor::endFunction() {
     // Add a return instruction manually
     auto ret = PcodeInstruction::create<PcodeReturnInst>();
     _curBlock->insertInst(ret);
 }
 
+void PcodeVisitor::visitFuncDef(const FuncDef &node) {
+    std::vector<const Ident *> params;
+    for (auto &param : node.func_f_params) {
+        params.push_back(param);
+    }
+    beginFunction(*node.ident, params);
+    visitExp(*node.exp);
+    endFunction();
+}
+
 void PcodeVisitor::visitVarDecl(const VarDecl &node) {
-    auto content = node.ident->value;
-    // Maintain symbol table
-    auto symbol = PcodeSymbol::create(content, PcodeSymbol::P_VAR);
-    _symbolTable.insertSymbol(symbol);
+    genVarDecl(*node.ident);
+}
+
+void PcodeVisitor::genVarDecl(const Ident &ident) {
+    if (ident.slot == NO_SLOT) {
+        return;
+    }
+    auto content = std::string(ident.value);
 
     // Maintain variable list of the visitor
     auto var = PcodeVariable::create(content);
     _module.addVariable(content, var);
+    auto &slot = slotOf(ident);
+    slot.variable = &_module.getVariable(content);
 
     // Add pcode instruction
-    auto def = PcodeInstruction::create<PcodeDefineInst>(_module.getVariable(content));
+    auto def = PcodeInstruction::create<PcodeDefineInst>(*slot.variable);
     _curBlock->insertInst(def);
 }
 
@@ -655,42 +978,88 @@ void PcodeVisitor::visitStmt(const Stmt &node) {
 }
 
 void PcodeVisitor::visitGetStmt(const GetStmt &node) {
+    genGet(*node.ident);
+}
+
+void PcodeVisitor::visitPutStmt(const PutStmt &node) {
+    visitExp(*node.exp);
+    genPut();
+}
+
+void PcodeVisitor::visitTagStmt(const TagStmt &node) {
+    genTag(node.ident->value);
+}
+
+void PcodeVisitor::visitLetStmt(const LetStmt &node) {
+    visitExp(*node.exp);
+    genStore(*node.ident);
+}
+
+void PcodeVisitor::visitIfStmt(const IfStmt &node) {
+    visitCond(*node.cond);
+    genJumpIfTrue(node.ident->value);
+}
+
+void PcodeVisitor::visitToStmt(const ToStmt &node) {
+    genJump(node.ident->value);
+}
+
+void PcodeVisitor::visitFlatStmt(const FlatAst &ast, const FlatStmt &node) {
+    switch (node.kind) {
+        case FlatStmt::GET: genGet(ast.idents[node.ident]); break;
+        case FlatStmt::PUT: visitFlatExp(ast, node.exp); genPut(); break;
+        case FlatStmt::TAG: genTag(ast.idents[node.ident].value); break;
+        case FlatStmt::LET:
+            visitFlatExp(ast, node.exp);
+            genStore(ast.idents[node.ident]);
+            break;
+        case FlatStmt::IF: {
+            const auto &cond = ast.conds[node.exp];
+            visitFlatExp(ast, cond.lhs);
+            visitFlatExp(ast, cond.rhs);
+            genCompare(cond.op);
+            genJumpIfTrue(ast.idents[node.ident].value);
+            break;
+        }
+        case FlatStmt::TO: genJump(ast.idents[node.ident].value); break;
+    }
+}
+
+void PcodeVisitor::genGet(const Ident &ident) {
     auto read = PcodeInstruction::create<PcodeReadInst>();
     _curBlock->insertInst(read);
 
-    auto store = PcodeInstruction::create<PcodeStoreInst>(_module.getVariable(node.ident->value));
-    _curBlock->insertInst(store);
+    genStore(ident);
 }
 
-void PcodeVisitor::visitPutStmt(const PutStmt &node) {
-    visitExp(*node.exp);
-    
+void PcodeVisitor::genPut() {
     auto write = PcodeInstruction::create<PcodeWriteInst>();
     _curBlock->insertInst(write);
 }
 
-void PcodeVisitor::visitTagStmt(const TagStmt &node) {
-    auto content = node.ident->value;
+void PcodeVisitor::genTag(std::string_view name) {
+    auto content = std::string(name);
     createBlock();
     auto label = PcodeInstruction::create<PcodeLabelInst>(content);
     _curBlock->insertInst(label);
     _module.addLabel(content, _curBlock);
 }
 
-void PcodeVisitor::visitLetStmt(const LetStmt &node) {
-    visitExp(*node.exp);
-    auto store = PcodeInstruction::create<PcodeStoreInst>(_module.getVariable(node.ident->value));
+void PcodeVisitor::genStore(const Ident &ident) {
+    if (ident.slot == NO_SLOT) {
+        return;
+    }
+    auto store = PcodeInstruction::create<PcodeStoreInst>(*slotOf(ident).variable);
     _curBlock->insertInst(store);
 }
 
-void PcodeVisitor::visitIfStmt(const IfStmt &node) {
-    visitCond(*node.cond);
-    auto jit = PcodeInstruction::create<PcodeJumpIfTrueInst>(node.ident->value);
+void PcodeVisitor::genJumpIfTrue(std::string_view name) {
+    auto jit = PcodeInstruction::create<PcodeJumpIfTrueInst>(std::string(name));
     _curBlock->insertInst(jit);
 }
 
-void PcodeVisitor::visitToStmt(const ToStmt &node) {
-    auto jump = PcodeInstruction::create<PcodeJumpInst>(node.ident->value);
+void PcodeVisitor::genJump(std::string_view name) {
+    auto jump = PcodeInstruction::create<PcodeJumpInst>(std::string(name));
     _curBlock->insertInst(jump);
 }
 
@@ -709,8 +1078,57 @@ void PcodeVisitor::visitExp(const Exp &node) {
 void PcodeVisitor::visitBinaryExp(const BinaryExp &node) {
     visitExp(*node.lhs);
     visitExp(*node.rhs);
+    genBinary(node.op);
+}
+
+void PcodeVisitor::visitCallExp(const CallExp &node) {
+    for (auto &param : node.func_r_params) {
+        visitExp(*param);
+    }
+    genCall(*node.ident);
+}
+
+void PcodeVisitor::visitUnaryExp(const UnaryExp &node) {
+    visitExp(*node.exp);
+    genUnary(node.op);
+}
+
+void PcodeVisitor::visitIdentExp(const IdentExp &node) {
+    genLoad(*node.ident);
+}
+
+void PcodeVisitor::visitNumber(const Number &node) {
+    genNumber(node.value);
+}
+
+void PcodeVisitor::visitCond(const Cond &node) {
+    visitExp(*node.lhs);
+    visitExp(*node.rhs);
+    genCompare(node.op);
+}
+
+void PcodeVisitor::visitFlatExp(const FlatAst &ast, FlatId root) {
+    // The operands of a node come right before it in post-order, so the
+    // subtree is emitted by one pass over its range.
+    for (FlatId id = ast.exps[root].first; id <= root; id++) {
+        const auto &exp = ast.exps[id];
+        switch (exp.kind) {
+            case FlatExp::BINARY: genBinary(ast.binary_exps[exp.index].op); break;
+            case FlatExp::CALL:
+                genCall(ast.idents[ast.call_exps[exp.index].ident]);
+                break;
+            case FlatExp::UNARY: genUnary(ast.unary_exps[exp.index].op); break;
+            case FlatExp::IDENT:
+                genLoad(ast.idents[ast.ident_exps[exp.index].ident]);
+                break;
+            case FlatExp::NUMBER: genNumber(ast.numbers[exp.index].value); break;
+        }
+    }
+}
+
+void PcodeVisitor::genBinary(BinaryExp::BinaryOp binaryOp) {
     PcodeOperationInst::OperationType op;
-    switch (node.op) {
+    switch (binaryOp) {
         case BinaryExp::PLUS: op = PcodeOperationInst::ADD; break;
         case BinaryExp::MINU: op = PcodeOperationInst::SUB; break;
         case BinaryExp::MULT: op = PcodeOperationInst::MUL; break;
@@ -721,45 +1139,43 @@ void PcodeVisitor::visitBinaryExp(const BinaryExp &node) {
     _curBlock->insertInst(opr);
 }
 
-void PcodeVisitor::visitCallExp(const CallExp &node) {
-    for (auto &param : node.func_r_params) {
-        visitExp(*param);
+void PcodeVisitor::genCall(const Ident &ident) {
+    if (ident.slot == NO_SLOT) {
+        return;
     }
-    auto call = PcodeInstruction::create<PcodeCallInst>(_module.getFunction(node.ident->value));
+    auto call = PcodeInstruction::create<PcodeCallInst>(*slotOf(ident).function);
     _curBlock->insertInst(call);
 }
 
-void PcodeVisitor::visitUnaryExp(const UnaryExp &node) {
-    visitExp(*node.exp);
-    if (node.op == UnaryExp::MINU) {
+void PcodeVisitor::genUnary(decltype(UnaryExp::op) unaryOp) {
+    if (unaryOp == UnaryExp::MINU) {
         auto opr = PcodeInstruction::create<PcodeOperationInst>(PcodeOperationInst::NEG);
         _curBlock->insertInst(opr);
     }
 }
 
-void PcodeVisitor::visitIdentExp(const IdentExp &node) {
-    if (_symbolTable.inFunctionScope()) {
-        int index = _symbolTable.getIndexOf(node.ident->value);
-        if (index > 0) {
-            auto arg = PcodeInstruction::create<PcodeArgumentInst>(index);
-            _curBlock->insertInst(arg);
-        }
+void PcodeVisitor::genLoad(const Ident &ident) {
+    if (ident.slot == NO_SLOT) {
+        return;
+    }
+    auto &slot = slotOf(ident);
+    if (slot.argument > 0) {
+        auto arg = PcodeInstruction::create<PcodeArgumentInst>(slot.argument);
+        _curBlock->insertInst(arg);
     } else {
-        auto load = PcodeInstruction::create<PcodeLoadInst>(_module.getVariable(node.ident->value));
+        auto load = PcodeInstruction::create<PcodeLoadInst>(*slot.variable);
         _curBlock->insertInst(load);
     }
 }
 
-void PcodeVisitor::visitNumber(const Number &node) {
-    auto li = PcodeInstruction::create<PcodeLoadImmediateInst>(node.value);
+void PcodeVisitor::genNumber(float value) {
+    auto li = PcodeInstruction::create<PcodeLoadImmediateInst>(value);
     _curBlock->insertInst(li);
 }
 
-void PcodeVisitor::visitCond(const Cond &node) {
-    visitExp(*node.lhs);
-    visitExp(*node.rhs);
+void PcodeVisitor::genCompare(decltype(Cond::op) condOp) {
     PcodeOperationInst::OperationType op;
-    switch (node.op) {
+    switch (condOp) {
         case Cond::EQ: op = PcodeOperationInst::EQL; break;
         case Cond::NE: op = PcodeOperationInst::NEQ; break;
         case Cond::LT: op = PcodeOperationInst::LES; break;
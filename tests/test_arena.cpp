@@ -0,0 +1,84 @@
+#include "doctest.h"
+
+#include "tolang/arena.h"
+#include <cstdint>
+#include <vector>
+
+TEST_CASE("testing arena") {
+    Arena arena;
+    CHECK_EQ(arena.reserved(), 0);
+
+    // objects are aligned and never overlap
+    char *ch = arena.make<char>('a');
+    double *number = arena.make<double>(1.5);
+    CHECK_EQ(reinterpret_cast<uintptr_t>(number) % alignof(double), 0);
+    CHECK_EQ(*ch, 'a');
+    CHECK_EQ(*number, 1.5);
+
+    // a large allocation gets a block of its own
+    std::size_t before = arena.reserved();
+    arena.allocate(1 << 20, 16);
+    CHECK_GE(arena.reserved(), before + (1 << 20));
+
+    std::vector<int> items = {1, 2, 3};
+    auto array = arena.make_array(items.begin(), items.end());
+    CHECK_EQ(array.size(), 3);
+    CHECK_EQ(array[0], 1);
+    CHECK_EQ(array[2], 3);
+    items[0] = 0;
+    CHECK_EQ(array[0], 1);
+
+    auto empty = arena.make_array(items.end(), items.end());
+    CHECK(empty.empty());
+    CHECK(empty.begin() == empty.end());
+
+    // only the largest block survives a reset
+    std::size_t largest = arena.reserved() - before;
+    arena.reset();
+    CHECK_LE(arena.reserved(), largest);
+    CHECK_GE(arena.reserved(), 1 << 20);
+    CHECK_EQ(*arena.make<int>(7), 7);
+}
+
+TEST_CASE("testing arena reset keeps the largest block") {
+    Arena arena;
+    arena.make<int>(1);
+    arena.allocate(1 << 20, 16);
+    std::size_t large = arena.reserved();
+    // the next block is small again, and becomes the last one
+    arena.allocate(1 << 10, 16);
+    CHECK_GT(arena.reserved(), large);
+
+    arena.reset();
+    CHECK_GE(arena.reserved(), 1 << 20);
+    CHECK_LT(arena.reserved(), large);
+
+    // the kept block takes the large allocation again without growing
+    std::size_t reserved = arena.reserved();
+    arena.allocate(1 << 20, 16);
+    CHECK_EQ(arena.reserved(), reserved);
+}
+
+TEST_CASE("testing arena adopt") {
+    Arena arena;
+    Arena other;
+    int *value = other.make<int>(1);
+    other.allocate(1 << 20, 16);
+    std::size_t reserved = other.reserved();
+
+    arena.make<int>(2);
+    std::size_t before = arena.reserved();
+    arena.adopt(other);
+    CHECK_EQ(arena.reserved(), before + reserved);
+    CHECK_EQ(other.reserved(), 0);
+    CHECK_EQ(*value, 1);
+
+    // both arenas keep allocating where they left off
+    CHECK_EQ(*arena.make<int>(3), 3);
+    CHECK_EQ(*other.make<int>(4), 4);
+
+    Arena empty;
+    empty.adopt(arena);
+    CHECK_EQ(*value, 1);
+    CHECK_EQ(*empty.make<int>(5), 5);
+}
@@ -0,0 +1,108 @@
+#include "doctest.h"
+
+#include "tolang/ast_cache.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+static std::string print(CompUnit &root) {
+    std::ostringstream out;
+    root.print(out);
+    return out.str();
+}
+
+TEST_CASE("testing ast cache") {
+    std::string input = "fn f(a, b) => a * -b;\n"
+                        "var x;\n"
+                        "get x;\n"
+                        "let x = f(1, x + 2) - 3;\n"
+                        "if x < 0 to end;\n"
+                        "put x;\n"
+                        "tag end;\n";
+    Lexer lexer(input.data(), input.data() + input.size());
+    Parser parser(lexer);
+    auto root = parser.parse();
+
+    auto dir = std::filesystem::temp_directory_path() /
+               ("tolang-test-cache-" + std::to_string(getpid()));
+    AstCache cache(dir.string());
+    CHECK_FALSE(cache.load(input).has_value());
+    cache.store(input, flatten(*root));
+
+    auto ast = cache.load(input);
+    REQUIRE(ast.has_value());
+    CHECK_EQ(print(*unflatten(*ast)), print(*root));
+    CHECK_EQ(ast->names->size(), root->names->size());
+    CHECK_EQ(ast->lines->size(), root->lines->size());
+
+    // any other source misses, even with the same size
+    std::string other = input;
+    other[input.find('3')] = '4';
+    CHECK_FALSE(cache.load(other).has_value());
+
+    // and so does the entry of another source under the same name, as if
+    // their hashes collided
+    auto path = cache.path(input);
+    cache.store(other, flatten(*root));
+    std::filesystem::copy_file(
+        cache.path(other), path,
+        std::filesystem::copy_options::overwrite_existing);
+    CHECK_FALSE(cache.load(input).has_value());
+
+    // so does a truncated entry
+    cache.store(input, flatten(*root));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    CHECK_FALSE(cache.load(input).has_value());
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("testing ast cache on corrupt entries") {
+    std::string input = "fn f(a, b) => a * -b;\n"
+                        "var x;\n"
+                        "get x;\n"
+                        "let x = f(1, x + 2) - 3;\n"
+                        "if x < 0 to end;\n"
+                        "put x;\n"
+                        "tag end;\n";
+    Lexer lexer(input.data(), input.data() + input.size());
+    Parser parser(lexer);
+    auto root = parser.parse();
+
+    auto dir = std::filesystem::temp_directory_path() /
+               ("tolang-test-corrupt-" + std::to_string(getpid()));
+    AstCache cache(dir.string());
+    cache.store(input, flatten(*root));
+    auto path = cache.path(input);
+    std::string entry;
+    {
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        std::ostringstream content;
+        content << in.rdbuf();
+        entry = content.str();
+    }
+
+    // every word of the entry, set to values that are out of any range, must
+    // either miss or give a tree that is safe to walk
+    for (std::size_t offset = 0; offset + 4 <= entry.size(); offset += 4) {
+        for (uint32_t word : {0x000000ffu, 0x0000ffffu, 0x7fffffffu}) {
+            std::string corrupt = entry;
+            std::memcpy(corrupt.data() + offset, &word, 4);
+            {
+                std::ofstream out(path, std::ios::out | std::ios::binary);
+                out.write(corrupt.data(), corrupt.size());
+            }
+            auto ast = cache.load(input);
+            if (ast.has_value()) {
+                print(*unflatten(*ast));
+            }
+        }
+    }
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,115 @@
+#include "doctest.h"
+
+#include "tolang/ast_printer.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include <sstream>
+#include <string>
+
+static const std::string INPUT = "fn f(a, b) => a * -(b + 2);\n"
+                                 "var x;\n"
+                                 "get x;\n"
+                                 "let x = f(1.5, x + 2) - 3;\n"
+                                 "if x <= 0 to end;\n"
+                                 "put +x;\n"
+                                 "to end;\n"
+                                 "tag end;\n";
+
+static std::string print(const std::string &input, AstFormat format) {
+    Lexer lexer(input.data(), input.data() + input.size());
+    auto root = Parser(lexer).parse();
+    std::ostringstream out;
+    AstPrinter(out, format).print(*root);
+    return out.str();
+}
+
+TEST_CASE("testing ast printer in text") {
+    Lexer lexer(INPUT.data(), INPUT.data() + INPUT.size());
+    auto root = Parser(lexer).parse();
+    std::ostringstream expected;
+    root->print(expected);
+    CHECK_EQ(print(INPUT, AstFormat::TEXT), expected.str());
+}
+
+TEST_CASE("testing ast printer in s-expressions") {
+    CHECK_EQ(print(INPUT, AstFormat::SEXP),
+             "(fn f (a b) (* a (- (+ b 2))))\n"
+             "(var x)\n"
+             "(get x)\n"
+             "(let x (- (call f 1.5 (+ x 2)) 3))\n"
+             "(if (<= x 0) end)\n"
+             "(put (+ x))\n"
+             "(to end)\n"
+             "(tag end)\n");
+}
+
+TEST_CASE("testing ast printer in json lines") {
+    CHECK_EQ(
+        print(INPUT, AstFormat::JSON),
+        "{\"kind\":\"fn\",\"line\":1,\"name\":\"f\",\"params\":[\"a\",\"b\"],"
+        "\"exp\":{\"kind\":\"binary\",\"op\":\"*\",\"lhs\":{\"kind\":"
+        "\"ident\",\"name\":\"a\"},\"rhs\":{\"kind\":\"unary\",\"op\":\"-\","
+        "\"exp\":{\"kind\":\"binary\",\"op\":\"+\",\"lhs\":{\"kind\":"
+        "\"ident\",\"name\":\"b\"},\"rhs\":{\"kind\":\"number\",\"value\":"
+        "2}}}}}\n"
+        "{\"kind\":\"var\",\"line\":2,\"name\":\"x\"}\n"
+        "{\"kind\":\"get\",\"line\":3,\"name\":\"x\"}\n"
+        "{\"kind\":\"let\",\"line\":4,\"name\":\"x\",\"exp\":{\"kind\":"
+        "\"binary\",\"op\":\"-\",\"lhs\":{\"kind\":\"call\",\"name\":\"f\","
+        "\"args\":[{\"kind\":\"number\",\"value\":1.5},{\"kind\":\"binary\","
+        "\"op\":\"+\",\"lhs\":{\"kind\":\"ident\",\"name\":\"x\"},\"rhs\":{"
+        "\"kind\":\"number\",\"value\":2}}]},\"rhs\":{\"kind\":\"number\","
+        "\"value\":3}}}\n"
+        "{\"kind\":\"if\",\"line\":5,\"cond\":{\"op\":\"<=\",\"lhs\":{"
+        "\"kind\":\"ident\",\"name\":\"x\"},\"rhs\":{\"kind\":\"number\","
+        "\"value\":0}},\"to\":\"end\"}\n"
+        "{\"kind\":\"put\",\"line\":6,\"exp\":{\"kind\":\"unary\",\"op\":"
+        "\"+\",\"exp\":{\"kind\":\"ident\",\"name\":\"x\"}}}\n"
+        "{\"kind\":\"to\",\"line\":7,\"name\":\"end\"}\n"
+        "{\"kind\":\"tag\",\"line\":8,\"name\":\"end\"}\n");
+}
+
+TEST_CASE("testing ast printer on large trees") {
+    // more output than one buffer, which is flushed between nodes
+    std::string input;
+    for (int i = 0; i < 10000; i++) {
+        input += "let x = x * 0.1 + " + std::to_string(i) + ";\n";
+    }
+    Lexer lexer(input.data(), input.data() + input.size());
+    auto root = Parser(lexer).parse();
+    std::ostringstream expected;
+    root->print(expected);
+    auto actual = print(input, AstFormat::TEXT);
+    CHECK_GT(actual.size(), AstPrinter::FLUSH_SIZE);
+    CHECK_EQ(actual, expected.str());
+}
+
+TEST_CASE("testing ast printer on deep expressions") {
+    // no format takes native stack per level
+    constexpr int DEPTH = 1000000;
+    std::string input = "var x;\nlet x = x";
+    for (int i = 0; i < DEPTH; i++) {
+        input += " + 1";
+    }
+    input += ";\n";
+
+    auto sexp = print(input, AstFormat::SEXP);
+    CHECK_EQ(sexp.substr(0, 24), "(var x)\n(let x (+ (+ (+ ");
+    CHECK_EQ(sexp.substr(sexp.size() - 10), "1) 1) 1))\n");
+
+    auto json = print(input, AstFormat::JSON);
+    std::size_t sums = 0;
+    for (auto pos = json.find("\"binary\""); pos != std::string::npos;
+         pos = json.find("\"binary\"", pos + 1)) {
+        sums++;
+    }
+    CHECK_EQ(sums, DEPTH);
+
+    auto text = print(input, AstFormat::TEXT);
+    std::size_t adds = 0;
+    for (auto pos = text.find("<AddExp>"); pos != std::string::npos;
+         pos = text.find("<AddExp>", pos + 1)) {
+        adds++;
+    }
+    CHECK_EQ(adds, DEPTH);
+}
@@ -0,0 +1,232 @@
+#include "doctest.h"
+
+#include "tolang/error.h"
+#include "tolang/lexer.h"
+#include "tolang/parallel_lexer.h"
+#include "tolang/parser.h"
+#include "tolang/token_buffer.h"
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::string dump(DiagnosticsEngine &engine, const std::string &input) {
+    std::ostringstream out;
+    engine.dump(out, LineTable(input));
+    return out.str();
+}
+
+TEST_CASE("testing diagnostics scopes") {
+    DiagnosticsEngine outer, inner;
+    auto &fallback = DiagnosticsEngine::current();
+    {
+        DiagnosticsScope outer_scope(outer);
+        CHECK_EQ(&DiagnosticsEngine::current(), &outer);
+        {
+            DiagnosticsScope inner_scope(inner);
+            DiagnosticsEngine::error(SourceLoc(1), "inner");
+        }
+        DiagnosticsEngine::error(SourceLoc(2), "outer");
+    }
+    CHECK_EQ(&DiagnosticsEngine::current(), &fallback);
+
+    REQUIRE_EQ(inner.errors().size(), 1);
+    CHECK_EQ(inner.errors()[0].msg, "inner");
+    REQUIRE_EQ(outer.errors().size(), 1);
+    CHECK_EQ(outer.errors()[0].msg, "outer");
+
+    outer.clear();
+    CHECK_FALSE(outer.has_error());
+}
+
+TEST_CASE("testing diagnostics order") {
+    std::string input = "a\nb\nc\n";
+    DiagnosticsEngine engine, other;
+    engine.report_error(SourceLoc(4), "third");
+    engine.report_error(SourceLoc(0), "first");
+    other.report_error(SourceLoc(4), "fourth");
+    other.report_error(SourceLoc(2), "second");
+    engine.merge(other);
+    CHECK_FALSE(other.has_error());
+
+    // errors at the same location keep the order they were reported in
+    CHECK_EQ(dump(engine, input), "1:1: first\n"
+                                  "2:1: second\n"
+                                  "3:1: third\n"
+                                  "3:1: fourth\n");
+}
+
+TEST_CASE("testing concurrent compilations") {
+    // each thread reports to its own engine, and sees only its own errors
+    const int count = 8;
+    std::vector<std::string> inputs;
+    for (int i = 0; i < count; i++) {
+        std::string input;
+        for (int j = 0; j <= i; j++) {
+            input += "let x = 1 $;\nput x +;\n";
+        }
+        inputs.push_back(input);
+    }
+    std::vector<std::string> dumps(count);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < count; i++) {
+        threads.emplace_back([&, i] {
+            DiagnosticsEngine engine;
+            DiagnosticsScope scope(engine);
+            const auto &input = inputs[i];
+            Lexer lexer(input.data(), input.data() + input.size());
+            Parser(lexer).parse();
+            dumps[i] = dump(engine, input);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (int i = 0; i < count; i++) {
+        DiagnosticsEngine engine;
+        DiagnosticsScope scope(engine);
+        const auto &input = inputs[i];
+        Lexer lexer(input.data(), input.data() + input.size());
+        Parser(lexer).parse();
+        CHECK_EQ(dumps[i], dump(engine, input));
+        CHECK_GT(engine.errors().size(), i);
+    }
+}
+
+TEST_CASE("testing diagnostics of the parallel lexer") {
+    std::string input;
+    for (int i = 0; input.size() < 3 * ParallelLexer::MIN_CHUNK_SIZE + 100;
+         i++) {
+        input += i % 1000 == 0 ? "let v = a @ 0.5;\n" : "let v = a * 0.5;\n";
+    }
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+
+    DiagnosticsEngine serial_errors;
+    {
+        DiagnosticsScope scope(serial_errors);
+        Lexer serial(begin, end);
+        TokenBuffer tokens(serial.source());
+        serial.tokenize(tokens);
+    }
+
+    DiagnosticsEngine parallel_errors;
+    {
+        DiagnosticsScope scope(parallel_errors);
+        ParallelLexer parallel(begin, end, std::make_shared<NameTable>(), 3);
+        TokenBuffer tokens(parallel.source());
+        parallel.tokenize(tokens);
+    }
+
+    REQUIRE_EQ(parallel_errors.errors().size(), serial_errors.errors().size());
+    CHECK_GT(serial_errors.errors().size(), 100);
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < serial_errors.errors().size(); i++) {
+        auto &a = serial_errors.errors()[i];
+        auto &b = parallel_errors.errors()[i];
+        mismatches += a.loc.offset != b.loc.offset || a.msg != b.msg;
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+TEST_CASE("testing the error limit") {
+    DiagnosticsEngine engine, other;
+    engine.set_error_limit(3);
+    engine.report_error(SourceLoc(0), "first");
+    other.report_error(SourceLoc(1), "second");
+    other.report_error(SourceLoc(2), "third");
+    other.report_error(SourceLoc(3), "fourth");
+    engine.merge(other);
+    CHECK(engine.limit_reached());
+    engine.report_error(SourceLoc(4), "fifth");
+    REQUIRE_EQ(engine.errors().size(), 3);
+    CHECK_EQ(engine.errors().back().msg, "third");
+
+    // with no limit, every error is kept
+    engine.set_error_limit(0);
+    CHECK_FALSE(engine.limit_reached());
+    engine.report_error(SourceLoc(4), "fifth");
+    CHECK_EQ(engine.errors().size(), 4);
+}
+
+TEST_CASE("testing the parser with an error limit") {
+    std::string input;
+    for (int i = 0; i < 100; i++) {
+        input += "let x = 1 $;\nput x +;\n";
+    }
+
+    DiagnosticsEngine engine;
+    DiagnosticsScope scope(engine);
+    engine.set_error_limit(5);
+    Lexer lexer(input.data(), input.data() + input.size());
+    auto root = Parser(lexer).parse();
+    REQUIRE_EQ(engine.errors().size(), 5);
+    CHECK(engine.limit_reached());
+    // the parser stops as soon as the limit is reached
+    CHECK_LT(root->stmts.size(), 10);
+    CHECK_LT(engine.errors().back().loc.offset, 3 * 21);
+}
+
+TEST_CASE("testing the parallel lexer with an error limit") {
+    std::string input;
+    for (int i = 0; input.size() < 3 * ParallelLexer::MIN_CHUNK_SIZE + 100;
+         i++) {
+        input += i % 1000 == 500 ? "let v = a @ 0.5;\n" : "let v = a * 0.5;\n";
+        input += "let v" + std::to_string(i) + " = 0;\n";
+    }
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+
+    // limits reached in the first chunk, in a later one, never, and before
+    // lexing
+    for (std::size_t before : {0, 2}) {
+        for (std::size_t limit : {1, 2, 50, 1000}) {
+            CAPTURE(before);
+            CAPTURE(limit);
+            DiagnosticsEngine serial_errors;
+            serial_errors.set_error_limit(limit);
+            auto serial_names = std::make_shared<NameTable>();
+            TokenBuffer serial_tokens(input);
+            {
+                DiagnosticsScope scope(serial_errors);
+                for (std::size_t i = 0; i < before; i++) {
+                    DiagnosticsEngine::error(SourceLoc(0), "before");
+                }
+                Lexer serial(begin, end, serial_names);
+                serial.tokenize(serial_tokens);
+            }
+
+            DiagnosticsEngine parallel_errors;
+            parallel_errors.set_error_limit(limit);
+            auto parallel_names = std::make_shared<NameTable>();
+            TokenBuffer parallel_tokens(input);
+            {
+                DiagnosticsScope scope(parallel_errors);
+                for (std::size_t i = 0; i < before; i++) {
+                    DiagnosticsEngine::error(SourceLoc(0), "before");
+                }
+                ParallelLexer parallel(begin, end, parallel_names, 3);
+                parallel.tokenize(parallel_tokens);
+            }
+
+            CHECK_EQ(serial_errors.limit_reached(), limit != 1000);
+            REQUIRE_EQ(parallel_errors.errors().size(),
+                       serial_errors.errors().size());
+            CHECK_EQ(parallel_errors.errors().back().loc.offset,
+                     serial_errors.errors().back().loc.offset);
+            CHECK_EQ(parallel_names->size(), serial_names->size());
+            REQUIRE_EQ(parallel_tokens.size(), serial_tokens.size());
+            std::size_t mismatches = 0;
+            for (std::size_t i = 0; i < serial_tokens.size(); i++) {
+                mismatches +=
+                    parallel_tokens.type(i) != serial_tokens.type(i) ||
+                    parallel_tokens.offset(i) != serial_tokens.offset(i) ||
+                    parallel_tokens.name(i) != serial_tokens.name(i);
+            }
+            CHECK_EQ(mismatches, 0);
+            CHECK_EQ(serial_tokens.type(serial_tokens.size() - 1),
+                     Token::TK_EOF);
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#include "doctest.h"
+
+#include "tolang/exp_dag.h"
+#include "tolang/fold.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include <string>
+
+TEST_CASE("testing expression sharing") {
+    std::string input = "fn f(x, n) => (x - n) * (x - n) + g(x - n, 0);\n"
+                        "var x;\n"
+                        "let x = x * x + 1;\n"
+                        "put f(-0, 0);\n"
+                        "if x + 1 < x + 1 to end;\n"
+                        "tag end;\n";
+    Lexer lexer(input.data(), input.data() + input.size());
+    auto root = Parser(lexer).parse();
+    fold(*root);
+    auto stats = share_exps(*root);
+
+    // x n - x n - * x n - 0 g +  ->  x n - * 0 g +
+    // x x * 1 +                  ->  x * 1 +
+    // -0 0 f                     ->  -0 0 f
+    // x 1 + x 1 +                ->  x 1 +
+    CHECK_EQ(stats.nodes_before, 13 + 5 + 3 + 6);
+    CHECK_EQ(stats.nodes_after, 7 + 4 + 3 + 3);
+
+    auto &add = std::get<BinaryExp>(*root->func_defs[0]->exp);
+    auto &mul = std::get<BinaryExp>(*add.lhs);
+    auto &call = std::get<CallExp>(*add.rhs);
+    CHECK_EQ(mul.lhs, mul.rhs);
+    CHECK_EQ(mul.lhs, call.func_r_params[0]);
+    CHECK_NE(call.func_r_params[0], call.func_r_params[1]);
+
+    // nodes are not shared across statements
+    auto &let = std::get<LetStmt>(*root->stmts[0]);
+    auto &cond = *std::get<IfStmt>(*root->stmts[2]).cond;
+    CHECK_NE(std::get<BinaryExp>(*let.exp).rhs,
+             std::get<BinaryExp>(*cond.lhs).rhs);
+
+    // `-0` and `0` are different numbers
+    auto &put = std::get<CallExp>(*std::get<PutStmt>(*root->stmts[1]).exp);
+    CHECK_NE(put.func_r_params[0], put.func_r_params[1]);
+
+    // the two sides of a condition are one expression
+    CHECK_EQ(cond.lhs, cond.rhs);
+}
@@ -0,0 +1,87 @@
+#include "doctest.h"
+
+#include "tolang/flat_ast.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include <string>
+
+TEST_CASE("testing flat ast") {
+    std::string input = "fn f(a, b) => a * -b;\n"
+                        "var x;\n"
+                        "let x = f(1, x + 2) - 3;\n"
+                        "if x < 0 to end;\n"
+                        "tag end;\n";
+    Lexer lexer(input.data(), input.data() + input.size());
+    Parser parser(lexer);
+    auto root = parser.parse();
+    auto ast = flatten(*root);
+
+    CHECK_EQ(ast.func_defs.size(), 1);
+    CHECK_EQ(ast.var_decls.size(), 1);
+    REQUIRE_EQ(ast.stmts.size(), 3);
+    CHECK_EQ(ast.stmts[0].kind, FlatStmt::LET);
+    CHECK_EQ(ast.stmts[1].kind, FlatStmt::IF);
+    CHECK_EQ(ast.stmts[2].kind, FlatStmt::TAG);
+
+    const auto &func_def = ast.func_defs[0];
+    CHECK_EQ(ast.idents[func_def.ident].value, "f");
+    REQUIRE_EQ(func_def.param_count, 2);
+    CHECK_EQ(ast.idents[ast.params[func_def.first_param + 1]].value, "b");
+
+    // children come right before their parents, and every subtree is a
+    // contiguous range ending at its root
+    for (FlatId id = 0; id < ast.exps.size(); id++) {
+        const auto &exp = ast.exps[id];
+        CHECK_LE(exp.first, id);
+        auto check_child = [&](FlatId child) {
+            CHECK_LT(child, id);
+            CHECK_GE(child, exp.first);
+            CHECK_GE(ast.exps[child].first, exp.first);
+        };
+        if (exp.kind == FlatExp::BINARY) {
+            check_child(ast.binary_exps[exp.index].lhs);
+            check_child(ast.binary_exps[exp.index].rhs);
+            CHECK_EQ(ast.binary_exps[exp.index].rhs, id - 1);
+        } else if (exp.kind == FlatExp::UNARY) {
+            CHECK_EQ(ast.unary_exps[exp.index].exp, id - 1);
+        } else if (exp.kind == FlatExp::CALL) {
+            const auto &call = ast.call_exps[exp.index];
+            for (uint32_t i = 0; i < call.arg_count; i++) {
+                check_child(ast.args[call.first_arg + i]);
+            }
+        }
+    }
+
+    // `f(1, x + 2) - 3` in post-order: 1 x 2 + f 3 -
+    FlatId let = ast.stmts[0].exp;
+    const FlatExp::Kind expected[] = {
+        FlatExp::NUMBER, FlatExp::IDENT,  FlatExp::NUMBER, FlatExp::BINARY,
+        FlatExp::CALL,   FlatExp::NUMBER, FlatExp::BINARY,
+    };
+    REQUIRE_EQ(let - ast.exps[let].first + 1, std::size(expected));
+    for (std::size_t i = 0; i < std::size(expected); i++) {
+        CHECK_EQ(ast.exps[ast.exps[let].first + i].kind, expected[i]);
+    }
+    CHECK_EQ(ast.numbers[ast.exps[let - 1].index].value, 3.0f);
+
+    const auto &cond = ast.conds[ast.stmts[1].exp];
+    CHECK_EQ(cond.op, Cond::LT);
+    CHECK_EQ(ast.idents[ast.stmts[1].ident].value, "end");
+}
+
+TEST_CASE("testing flat ast of deep expressions") {
+    // neither parsing nor flattening takes native stack per level
+    std::string input = "var x;\nlet x = ";
+    for (int i = 0; i < 1000000; i++) {
+        input += "-";
+    }
+    input += "1;\n";
+    Lexer lexer(input.data(), input.data() + input.size());
+    Parser parser(lexer);
+    auto root = parser.parse();
+    auto ast = flatten(*root);
+
+    CHECK_EQ(ast.exps.size(), 1000001);
+    CHECK_EQ(ast.unary_exps.size(), 1000000);
+    CHECK_EQ(ast.exps[ast.stmts[0].exp].first, 0);
+}
@@ -0,0 +1,60 @@
+#include "doctest.h"
+
+#include "tolang/fold.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include <string>
+
+/**
+ * @brief Parse `let x = <exp>;` and fold it.
+ */
+static const Exp &fold_exp(const std::string &exp,
+                           std::unique_ptr<CompUnit> &root) {
+    std::string input = "let x = " + exp + ";";
+    Lexer lexer(input.data(), input.data() + input.size());
+    root = Parser(lexer).parse();
+    fold(*root);
+    return *std::get<LetStmt>(*root->stmts[0]).exp;
+}
+
+static float number(const Exp &exp) {
+    REQUIRE(std::holds_alternative<Number>(exp));
+    return std::get<Number>(exp).value;
+}
+
+TEST_CASE("testing constant folding") {
+    std::unique_ptr<CompUnit> root;
+    CHECK_EQ(number(fold_exp("0.5 * (2 + 2)", root)), 2.0f);
+    CHECK_EQ(number(fold_exp("-(1 - 3) / 4", root)), 0.5f);
+    CHECK_EQ(number(fold_exp("+-+-7", root)), 7.0f);
+
+    // a division by zero is left to run time
+    CHECK(std::holds_alternative<BinaryExp>(fold_exp("1 / 0", root)));
+
+    // operands are folded even if the expression itself is not
+    auto &call = std::get<CallExp>(fold_exp("f(1 + 1, y)", root));
+    CHECK_EQ(number(*call.func_r_params[0]), 2.0f);
+}
+
+TEST_CASE("testing algebraic simplification") {
+    std::unique_ptr<CompUnit> root;
+    for (auto exp : {"y * 1", "1 * y", "y / 1", "y - 0", "y + -0", "--y",
+                     "+y", "(y * (2 - 1)) / (0.5 + 0.5)"}) {
+        CAPTURE(exp);
+        auto &folded = fold_exp(exp, root);
+        REQUIRE(std::holds_alternative<IdentExp>(folded));
+        CHECK_EQ(std::get<IdentExp>(folded).ident->value, "y");
+    }
+
+    // `-0 + 0` is `0`, so adding `0` is not an identity
+    CHECK(std::holds_alternative<BinaryExp>(fold_exp("y + 0", root)));
+    CHECK(std::holds_alternative<BinaryExp>(fold_exp("y - -0", root)));
+    CHECK(std::holds_alternative<BinaryExp>(fold_exp("y * 2", root)));
+}
+
+TEST_CASE("testing folding of deep expressions") {
+    std::unique_ptr<CompUnit> root;
+    std::string minus(1000000, '-');
+    CHECK_EQ(number(fold_exp(minus + "3", root)), 3.0f);
+    CHECK(std::holds_alternative<IdentExp>(fold_exp(minus + "y", root)));
+}
@@ -0,0 +1,102 @@
+#include "doctest.h"
+
+#include "tolang/incremental_lexer.h"
+#include "tolang/lexer.h"
+#include "tolang/token_buffer.h"
+#include <string>
+#include <vector>
+
+static TokenBuffer lex_all(const std::string &source, NameTablePtr names) {
+    Lexer lexer(source.data(), source.data() + source.size(), names);
+    TokenBuffer tokens(lexer.source());
+    lexer.tokenize(tokens);
+    return tokens;
+}
+
+TEST_CASE("testing incremental lexer") {
+    std::string base;
+    for (int i = 0; i < 200; i++) {
+        base += "let v" + std::to_string(i) + " = v" + std::to_string(i) +
+                " + 1.5; # step\n";
+    }
+
+    struct Case {
+        std::size_t offset;
+        std::size_t old_length;
+        std::string text;
+    };
+    std::vector<Case> cases = {
+        {0, 0, "var x;\n"},           // insert at the start
+        {base.size(), 0, "put 1;"},   // append at the end
+        {4, 2, "value"},              // grow an identifier
+        {4, 1, ""},                   // shrink an identifier
+        {6, 0, "9"},                  // extend an identifier at its end
+        {3, 1, ""},                   // join a keyword and an identifier
+        {5, 0, "\n\n"},               // split a token over new lines
+        {100, 30, ""},                // delete across lines
+        {200, 0, "# "},               // comment out the rest of a line
+        {300, 1, "!"},                // an invalid character
+        {1000, 5, "<= >= == != =>"},  // operators
+        {base.size() - 1, 1, ""},     // drop the final newline
+    };
+
+    for (const auto &c : cases) {
+        auto names = std::make_shared<NameTable>();
+        auto tokens = lex_all(base, names);
+
+        std::string source = base;
+        source.replace(c.offset, c.old_length, c.text);
+
+        IncrementalLexer lexer(names);
+        lexer.relex(tokens, source, {c.offset, c.old_length, c.text.size()});
+        auto expects = lex_all(source, std::make_shared<NameTable>());
+
+        REQUIRE_EQ(tokens.size(), expects.size());
+        for (std::size_t i = 0; i < tokens.size(); i++) {
+            CHECK_EQ(tokens.type(i), expects.type(i));
+            CHECK_EQ(tokens.offset(i), expects.offset(i));
+            CHECK_EQ(tokens.length(i), expects.length(i));
+            CHECK_EQ(tokens.content(i), expects.content(i));
+            CHECK_EQ(tokens.value(i), expects.value(i));
+            if (tokens.type(i) == Token::TK_IDENT) {
+                CHECK_EQ(names->name(tokens.name(i)), tokens.content(i));
+            }
+        }
+        // a local edit rescans a few tokens, not the whole source
+        CHECK_LT(lexer.rescanned(), 20);
+    }
+}
+
+TEST_CASE("testing incremental lexer on successive edits") {
+    std::string source;
+    for (int i = 0; i < 300; i++) {
+        source += "let v" + std::to_string(i) + " = v" + std::to_string(i) +
+                  " * 2;\n";
+    }
+    auto names = std::make_shared<NameTable>();
+    auto tokens = lex_all(source, names);
+    IncrementalLexer lexer(names);
+
+    // type a line character by character, then jump back and forth, so that
+    // the gap of the buffer moves both ways
+    std::string line = "put (v1 + 2.5) / v2;\n";
+    std::size_t offsets[] = {source.size() / 2, 40, source.size() - 20, 300};
+    for (std::size_t offset : offsets) {
+        for (std::size_t i = 0; i < line.size(); i++) {
+            source.insert(offset + i, 1, line[i]);
+            lexer.relex(tokens, source, {offset + i, 0, 1});
+        }
+        source.erase(offset, 4);
+        lexer.relex(tokens, source, {offset, 4, 0});
+
+        auto expects = lex_all(source, std::make_shared<NameTable>());
+        REQUIRE_EQ(tokens.size(), expects.size());
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < tokens.size(); i++) {
+            mismatches += tokens.type(i) != expects.type(i) ||
+                          tokens.offset(i) != expects.offset(i) ||
+                          tokens.content(i) != expects.content(i);
+        }
+        CHECK_EQ(mismatches, 0);
+    }
+}
@@ -1,8 +1,17 @@
 #include "doctest.h"
 
+#include "tolang/keyword.h"
 #include "tolang/lexer.h"
+#include "tolang/source.h"
+#include "tolang/source_loc.h"
 #include "tolang/token.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <unistd.h>
 #include <vector>
 
 constexpr char INPUT[] = R"(fn nonParam() => 1 - 3.3;
@@ -22,69 +31,77 @@ let i = i + 1;
 if i <= n to entry;# maybe ok
 )";
 
-static std::vector<Token> EXPECTS = {
-    Token(Token::TK_FN, "fn", 1),      Token(Token::TK_IDENT, "nonParam", 1),
-    Token(Token::TK_LPARENT, "(", 1),  Token(Token::TK_RPARENT, ")", 1),
-    Token(Token::TK_RARROW, "=>", 1),  Token(Token::TK_NUMBER, "1", 1),
-    Token(Token::TK_MINU, "-", 1),     Token(Token::TK_NUMBER, "3.3", 1),
-    Token(Token::TK_SEMINCN, ";", 1),
-
-    Token(Token::TK_FN, "fn", 2),      Token(Token::TK_IDENT, "paramOne", 2),
-    Token(Token::TK_LPARENT, "(", 2),  Token(Token::TK_IDENT, "a", 2),
-    Token(Token::TK_RPARENT, ")", 2),  Token(Token::TK_RARROW, "=>", 2),
-    Token(Token::TK_IDENT, "a", 2),    Token(Token::TK_MULT, "*", 2),
-    Token(Token::TK_NUMBER, "0.2", 2), Token(Token::TK_SEMINCN, ";", 2),
-
-    Token(Token::TK_FN, "fn", 3),      Token(Token::TK_IDENT, "paramMore", 3),
-    Token(Token::TK_LPARENT, "(", 3),  Token(Token::TK_IDENT, "a", 3),
-    Token(Token::TK_COMMA, ",", 3),    Token(Token::TK_IDENT, "b", 3),
-    Token(Token::TK_COMMA, ",", 3),    Token(Token::TK_IDENT, "_c", 3),
-    Token(Token::TK_COMMA, ",", 3),    Token(Token::TK_IDENT, "d", 3),
-    Token(Token::TK_RPARENT, ")", 3),  Token(Token::TK_RARROW, "=>", 3),
-    Token(Token::TK_IDENT, "a", 3),    Token(Token::TK_DIV, "/", 3),
-    Token(Token::TK_LPARENT, "(", 3),  Token(Token::TK_IDENT, "b", 3),
-    Token(Token::TK_PLUS, "+", 3),     Token(Token::TK_IDENT, "_c", 3),
-    Token(Token::TK_RPARENT, ")", 3),  Token(Token::TK_SEMINCN, ";", 3),
-
-    Token(Token::TK_GET, "get", 4),    Token(Token::TK_IDENT, "a", 4),
-    Token(Token::TK_SEMINCN, ";", 4),
-
-    Token(Token::TK_PUT, "put", 5),    Token(Token::TK_IDENT, "a", 5),
-    Token(Token::TK_SEMINCN, ";", 5),
-
-    Token(Token::TK_LET, "let", 6),    Token(Token::TK_IDENT, "n", 6),
-    Token(Token::TK_ASSIGN, "=", 6),   Token(Token::TK_IDENT, "a", 6),
-    Token(Token::TK_MINU, "-", 6),     Token(Token::TK_NUMBER, "2.000003", 6),
-    Token(Token::TK_SEMINCN, ";", 6),
-
-    Token(Token::TK_LET, "let", 10),   Token(Token::TK_IDENT, "i", 10),
-    Token(Token::TK_ASSIGN, "=", 10),  Token(Token::TK_NUMBER, "0", 10),
-    Token(Token::TK_SEMINCN, ";", 10),
-
-    Token(Token::TK_TAG, "tag", 11),   Token(Token::TK_IDENT, "entry", 11),
-    Token(Token::TK_SEMINCN, ";", 11),
-
-    Token(Token::TK_IDENT, "a", 12),   Token(Token::TK_ASSIGN, "=", 12),
-    Token(Token::TK_MINU, "-", 12),    Token(Token::TK_IDENT, "a", 12),
-    Token(Token::TK_SEMINCN, ";", 12),
-
-    Token(Token::TK_PUT, "put", 13),   Token(Token::TK_IDENT, "a", 13),
-    Token(Token::TK_MULT, "*", 13),    Token(Token::TK_IDENT, "i", 13),
-    Token(Token::TK_SEMINCN, ";", 13),
-
-    Token(Token::TK_LET, "let", 14),   Token(Token::TK_IDENT, "i", 14),
-    Token(Token::TK_ASSIGN, "=", 14),  Token(Token::TK_IDENT, "i", 14),
-    Token(Token::TK_PLUS, "+", 14),    Token(Token::TK_NUMBER, "1", 14),
-    Token(Token::TK_SEMINCN, ";", 14),
-
-    Token(Token::TK_IF, "if", 15),     Token(Token::TK_IDENT, "i", 15),
-    Token(Token::TK_LE, "<=", 15),     Token(Token::TK_IDENT, "n", 15),
-    Token(Token::TK_TO, "to", 15),     Token(Token::TK_IDENT, "entry", 15),
-    Token(Token::TK_SEMINCN, ";", 15),
+// A token that the lexer is expected to produce, on the given line.
+struct ExpectedToken {
+    Token::TokenType type;
+    std::string_view content;
+    int lineno;
+};
+
+static std::vector<ExpectedToken> EXPECTS = {
+    {Token::TK_FN, "fn", 1},      {Token::TK_IDENT, "nonParam", 1},
+    {Token::TK_LPARENT, "(", 1},  {Token::TK_RPARENT, ")", 1},
+    {Token::TK_RARROW, "=>", 1},  {Token::TK_NUMBER, "1", 1},
+    {Token::TK_MINU, "-", 1},     {Token::TK_NUMBER, "3.3", 1},
+    {Token::TK_SEMINCN, ";", 1},
+
+    {Token::TK_FN, "fn", 2},      {Token::TK_IDENT, "paramOne", 2},
+    {Token::TK_LPARENT, "(", 2},  {Token::TK_IDENT, "a", 2},
+    {Token::TK_RPARENT, ")", 2},  {Token::TK_RARROW, "=>", 2},
+    {Token::TK_IDENT, "a", 2},    {Token::TK_MULT, "*", 2},
+    {Token::TK_NUMBER, "0.2", 2}, {Token::TK_SEMINCN, ";", 2},
+
+    {Token::TK_FN, "fn", 3},      {Token::TK_IDENT, "paramMore", 3},
+    {Token::TK_LPARENT, "(", 3},  {Token::TK_IDENT, "a", 3},
+    {Token::TK_COMMA, ",", 3},    {Token::TK_IDENT, "b", 3},
+    {Token::TK_COMMA, ",", 3},    {Token::TK_IDENT, "_c", 3},
+    {Token::TK_COMMA, ",", 3},    {Token::TK_IDENT, "d", 3},
+    {Token::TK_RPARENT, ")", 3},  {Token::TK_RARROW, "=>", 3},
+    {Token::TK_IDENT, "a", 3},    {Token::TK_DIV, "/", 3},
+    {Token::TK_LPARENT, "(", 3},  {Token::TK_IDENT, "b", 3},
+    {Token::TK_PLUS, "+", 3},     {Token::TK_IDENT, "_c", 3},
+    {Token::TK_RPARENT, ")", 3},  {Token::TK_SEMINCN, ";", 3},
+
+    {Token::TK_GET, "get", 4},    {Token::TK_IDENT, "a", 4},
+    {Token::TK_SEMINCN, ";", 4},
+
+    {Token::TK_PUT, "put", 5},    {Token::TK_IDENT, "a", 5},
+    {Token::TK_SEMINCN, ";", 5},
+
+    {Token::TK_LET, "let", 6},    {Token::TK_IDENT, "n", 6},
+    {Token::TK_ASSIGN, "=", 6},   {Token::TK_IDENT, "a", 6},
+    {Token::TK_MINU, "-", 6},     {Token::TK_NUMBER, "2.000003", 6},
+    {Token::TK_SEMINCN, ";", 6},
+
+    {Token::TK_LET, "let", 10},   {Token::TK_IDENT, "i", 10},
+    {Token::TK_ASSIGN, "=", 10},  {Token::TK_NUMBER, "0", 10},
+    {Token::TK_SEMINCN, ";", 10},
+
+    {Token::TK_TAG, "tag", 11},   {Token::TK_IDENT, "entry", 11},
+    {Token::TK_SEMINCN, ";", 11},
+
+    {Token::TK_IDENT, "a", 12},   {Token::TK_ASSIGN, "=", 12},
+    {Token::TK_MINU, "-", 12},    {Token::TK_IDENT, "a", 12},
+    {Token::TK_SEMINCN, ";", 12},
+
+    {Token::TK_PUT, "put", 13},   {Token::TK_IDENT, "a", 13},
+    {Token::TK_MULT, "*", 13},    {Token::TK_IDENT, "i", 13},
+    {Token::TK_SEMINCN, ";", 13},
+
+    {Token::TK_LET, "let", 14},   {Token::TK_IDENT, "i", 14},
+    {Token::TK_ASSIGN, "=", 14},  {Token::TK_IDENT, "i", 14},
+    {Token::TK_PLUS, "+", 14},    {Token::TK_NUMBER, "1", 14},
+    {Token::TK_SEMINCN, ";", 14},
+
+    {Token::TK_IF, "if", 15},     {Token::TK_IDENT, "i", 15},
+    {Token::TK_LE, "<=", 15},     {Token::TK_IDENT, "n", 15},
+    {Token::TK_TO, "to", 15},     {Token::TK_IDENT, "entry", 15},
+    {Token::TK_SEMINCN, ";", 15},
 };
 
 TEST_CASE("testing lexer") {
     std::vector<Token> tokens;
+    LineTable lines(INPUT);
 
     std::istringstream input(INPUT);
     Lexer lexer = Lexer(input);
@@ -99,6 +116,186 @@ TEST_CASE("testing lexer") {
     for (int i = 0; i < tokens.size(); i++) {
         CHECK_EQ(tokens.at(i).type, EXPECTS.at(i).type);
         CHECK_EQ(tokens.at(i).content, EXPECTS.at(i).content);
-        CHECK_EQ(tokens.at(i).lineno, EXPECTS.at(i).lineno);
+        CHECK_EQ(lines.line(tokens.at(i).loc), EXPECTS.at(i).lineno);
+    }
+}
+
+TEST_CASE("testing lexer on buffer") {
+    std::vector<Token> tokens;
+    LineTable lines(INPUT);
+
+    SourceBuffer source{std::string(INPUT)};
+    Lexer lexer(source);
+    Token token;
+
+    lexer.next(token);
+    while (token.type != Token::TK_EOF) {
+        tokens.push_back(token);
+        lexer.next(token);
+    }
+    CHECK_EQ(tokens.size(), EXPECTS.size());
+    for (int i = 0; i < tokens.size(); i++) {
+        CHECK_EQ(tokens.at(i).type, EXPECTS.at(i).type);
+        CHECK_EQ(tokens.at(i).content, EXPECTS.at(i).content);
+        CHECK_EQ(lines.line(tokens.at(i).loc), EXPECTS.at(i).lineno);
+    }
+
+    // EOF can be read repeatedly
+    lexer.next(token);
+    CHECK_EQ(token.type, Token::TK_EOF);
+    CHECK_EQ(lines.line(token.loc), 16);
+}
+
+TEST_CASE("testing identifier interning") {
+    auto names = std::make_shared<NameTable>();
+    std::istringstream input(INPUT);
+    Lexer lexer(input, names);
+    Token token;
+
+    std::vector<Token> idents;
+    lexer.next(token);
+    while (token.type != Token::TK_EOF) {
+        if (token.type == Token::TK_IDENT) {
+            idents.push_back(token);
+        }
+        lexer.next(token);
+    }
+
+    // nonParam paramOne a paramMore b _c d n i entry
+    CHECK_EQ(names->size(), 10);
+    for (const auto &ident : idents) {
+        CHECK_EQ(names->name(ident.name), ident.content);
+        for (const auto &other : idents) {
+            CHECK_EQ(ident.name == other.name, ident.content == other.content);
+        }
+    }
+
+    // keywords are never interned
+    CHECK_EQ(names->intern("let"), 10);
+    CHECK_EQ(names->intern("entry"), idents.back().name);
+}
+
+TEST_CASE("testing keyword recognizer") {
+    CHECK_EQ(KEYWORD_COUNT, 8);
+    for (const auto &keyword : KEYWORDS) {
+        CHECK_EQ(keyword_type(keyword.spelling), keyword.type);
+        CHECK_EQ(token_type_to_string(keyword.type), keyword.spelling);
+    }
+
+    for (auto word : {"f", "fnn", "Fn", "vars", "lets", "gut", "to_", "tog",
+                      "identifier", "number", "err", "eof", "_", "i"}) {
+        CHECK_EQ(keyword_type(word), Token::TK_IDENT);
+    }
+}
+
+TEST_CASE("testing lexer trivia skipping") {
+    // runs of every length around the vector width, with the token landing at
+    // every position of a vector
+    std::string input;
+    std::vector<int> expect_lines;
+    int lineno = 1;
+    for (int n = 0; n < 80; n++) {
+        for (int i = 0; i < n; i++) {
+            char ch = " \t\n"[(i * 7 + n) % 3];
+            input += ch;
+            lineno += ch == '\n';
+        }
+        input += "x";
+        expect_lines.push_back(lineno);
+        input += " # " + std::string(n, '#') + "\n";
+        lineno++;
+    }
+    // a long block of blank lines and comments must not exhaust the stack
+    for (int i = 0; i < 200000; i++) {
+        input += i % 2 ? "\n" : "# commented out\n";
+        lineno++;
+    }
+    input += "y";
+    expect_lines.push_back(lineno);
+
+    Lexer lexer(input.data(), input.data() + input.size());
+    LineTable table(input);
+    Token token;
+    std::vector<int> lines;
+    lexer.next(token);
+    while (token.type != Token::TK_EOF) {
+        CHECK_EQ(token.type, Token::TK_IDENT);
+        lines.push_back(table.line(token.loc));
+        lexer.next(token);
+    }
+    CHECK_EQ(lines, expect_lines);
+}
+
+TEST_CASE("testing lexer into token buffer") {
+    std::istringstream input(INPUT);
+    Lexer lexer(input);
+    TokenBuffer tokens(lexer.source());
+    lexer.tokenize(tokens);
+    LineTable lines(INPUT);
+
+    CHECK_EQ(tokens.size(), EXPECTS.size() + 1);
+    for (int i = 0; i < EXPECTS.size(); i++) {
+        auto token = tokens.get(i);
+        CHECK_EQ(token.type, EXPECTS.at(i).type);
+        CHECK_EQ(token.content, EXPECTS.at(i).content);
+        CHECK_EQ(lines.line(token.loc), EXPECTS.at(i).lineno);
+        CHECK_EQ(token.content.data() - lexer.source().data(),
+                 tokens.offset(i));
+    }
+    CHECK_EQ(tokens.type(EXPECTS.size()), Token::TK_EOF);
+    CHECK_EQ(tokens.offset(EXPECTS.size()), lexer.source().size());
+}
+
+TEST_CASE("testing source size limit") {
+    // a sparse file takes no space, and the size is checked before mapping
+    auto path = std::filesystem::temp_directory_path() /
+                ("tolang-test-large-" + std::to_string(getpid()) + ".tol");
+    std::ofstream(path).close();
+
+    std::filesystem::resize_file(path, MAX_SOURCE_SIZE);
+    CHECK_EQ(SourceBuffer::map_file(path.string()).size(), MAX_SOURCE_SIZE);
+
+    // the offset of the end would be `SourceLoc::invalid()`
+    std::filesystem::resize_file(path, MAX_SOURCE_SIZE + 1);
+    CHECK_THROWS_AS(SourceBuffer::map_file(path.string()),
+                    std::runtime_error);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("testing number literal conversion") {
+    std::vector<std::string> literals = {
+        "0",
+        "7",
+        "0.5",
+        "3.3",
+        "2.000003",
+        "1.",
+        "0.",
+        "16777215",
+        "16777216",
+        "16777217",
+        "0.1234567891",
+        "0.12345678912",
+        "3.4028235",
+        "123456789012345678901234567890",
+        "0.000000000000000000000000000001",
+        // out of the range of a float
+        "99999999999999999999999999999999999999999",
+        "0.0000000000000000000000000000000000000000000001",
+    };
+    for (int i = 0; i < 2000; i++) {
+        // a spread of mantissas and scales, hitting both conversion paths
+        literals.push_back(std::to_string(i * 7919 % 100003) + "." +
+                           std::to_string(i * 104729 % 1000000007));
+    }
+
+    for (const auto &literal : literals) {
+        Lexer lexer(literal.data(), literal.data() + literal.size());
+        Token token;
+        lexer.next(token);
+        CHECK_EQ(token.type, Token::TK_NUMBER);
+        CHECK_EQ(token.content, literal);
+        CHECK_EQ(token.value, std::strtof(literal.c_str(), nullptr));
     }
 }
@@ -3,12 +3,15 @@
 #if TOLANG_BACKEND == LLVM
 
 #include "tolang/ast.h"
+#include "tolang/exp_dag.h"
+#include "tolang/flat_ast.h"
 #include "tolang/lexer.h"
 #include "tolang/parser.h"
 #include "tolang/visitor.h"
 #include "llvm/asm/AsmPrinter.h"
 #include <doctest.h>
 #include <sstream>
+#include <string>
 
 static constexpr char INPUT[] = R"(fn add(a, b) => a + b;
 
@@ -113,4 +116,117 @@ TEST_CASE("testing visitor") {
     CHECK_EQ(ir, EXPECTED);
 }
 
+TEST_CASE("testing visitor while parsing") {
+    std::istringstream input(INPUT);
+    Lexer lexer = Lexer(input);
+    Parser parser = Parser(lexer);
+
+    ModulePtr module = Module::New("tolang.c");
+    auto visitor = Visitor(module);
+    auto root = parser.parse(visitor);
+    CHECK(root->stmts.empty());
+
+    AsmPrinter printer;
+
+    std::ostringstream ss;
+    printer.Print(module, ss);
+
+    CHECK_EQ(ss.str(), EXPECTED);
+}
+
+TEST_CASE("testing visitor on flat ast") {
+    std::istringstream input(INPUT);
+    Lexer lexer = Lexer(input);
+    Parser parser = Parser(lexer);
+    auto ast = flatten(*parser.parse());
+
+    ModulePtr module = Module::New("tolang.c");
+    auto visitor = Visitor(module);
+    visitor.visit(ast);
+
+    AsmPrinter printer;
+
+    std::ostringstream ss;
+    printer.Print(module, ss);
+
+    CHECK_EQ(ss.str(), EXPECTED);
+}
+
+TEST_CASE("testing visitor on shared expressions") {
+    // nothing is repeated within a statement, so nothing changes
+    std::istringstream input(INPUT);
+    Lexer lexer = Lexer(input);
+    Parser parser = Parser(lexer);
+    auto root = parser.parse();
+    share_exps(*root);
+
+    ModulePtr module = Module::New("tolang.c");
+    auto visitor = Visitor(module);
+    visitor.memoize_exps(true);
+    visitor.visit(*root);
+
+    AsmPrinter printer;
+
+    std::ostringstream ss;
+    printer.Print(module, ss);
+
+    CHECK_EQ(ss.str(), EXPECTED);
+
+    // a repeated subexpression is generated once
+    std::istringstream repeated("fn f(x, n) => (x - n) * (x - n) + (x - n);");
+    Lexer repeated_lexer(repeated);
+    auto repeated_root = Parser(repeated_lexer).parse();
+    share_exps(*repeated_root);
+
+    module = Module::New("tolang.c");
+    auto repeated_visitor = Visitor(module);
+    repeated_visitor.memoize_exps(true);
+    repeated_visitor.visit(*repeated_root);
+
+    std::ostringstream repeated_ss;
+    printer.Print(module, repeated_ss);
+    auto ir = repeated_ss.str();
+    std::size_t subs = 0;
+    for (auto pos = ir.find("fsub"); pos != std::string::npos;
+         pos = ir.find("fsub", pos + 1)) {
+        subs++;
+    }
+    CHECK_EQ(subs, 1);
+}
+
+TEST_CASE("testing visitor on deep expressions") {
+    // neither resolving nor generating takes native stack per level
+    std::string input = "var x;\nget x;\nlet x = x";
+    for (int i = 0; i < 1000000; i++) {
+        input += " + 1";
+    }
+    input += ";\n";
+    Lexer lexer(input.data(), input.data() + input.size());
+    auto root = Parser(lexer).parse();
+
+    auto count_adds = [&root](bool shared) {
+        ModulePtr module = Module::New("tolang.c");
+        auto visitor = Visitor(module);
+        visitor.memoize_exps(shared);
+        visitor.visit(*root);
+
+        AsmPrinter printer;
+
+        std::ostringstream ss;
+        printer.Print(module, ss);
+        auto ir = ss.str();
+        std::size_t adds = 0;
+        for (auto pos = ir.find("fadd"); pos != std::string::npos;
+             pos = ir.find("fadd", pos + 1)) {
+            adds++;
+        }
+        return adds;
+    };
+    CHECK_EQ(count_adds(false), 1000000);
+
+    // only the numbers are shared, as every sum has another depth
+    share_exps(*root);
+    CHECK_EQ(count_adds(true), 1000000);
+}
+
 #endif
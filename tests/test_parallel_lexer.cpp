@@ -0,0 +1,39 @@
+#include "doctest.h"
+
+#include "tolang/lexer.h"
+#include "tolang/parallel_lexer.h"
+#include "tolang/token_buffer.h"
+#include <string>
+
+TEST_CASE("testing parallel lexer") {
+    // enough lines for three chunks, each with names unseen before it and a
+    // comment or a blank line right before a possible split point
+    std::string input;
+    for (int i = 0; input.size() < 3 * ParallelLexer::MIN_CHUNK_SIZE + 100;
+         i++) {
+        input += "let v" + std::to_string(i % 50000) + " = a * 0.5;";
+        input += i % 3 == 0 ? " # note\n" : i % 3 == 1 ? "\n\n" : "\n";
+    }
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+
+    Lexer serial(begin, end);
+    TokenBuffer expects(serial.source());
+    serial.tokenize(expects);
+
+    ParallelLexer parallel(begin, end, std::make_shared<NameTable>(), 3);
+    TokenBuffer tokens(parallel.source());
+    parallel.tokenize(tokens);
+
+    REQUIRE_EQ(tokens.size(), expects.size());
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+        mismatches += tokens.type(i) != expects.type(i) ||
+                      tokens.offset(i) != expects.offset(i) ||
+                      tokens.length(i) != expects.length(i) ||
+                      tokens.name(i) != expects.name(i);
+    }
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(tokens.type(tokens.size() - 1), Token::TK_EOF);
+    CHECK_EQ(parallel.names()->size(), serial.names()->size());
+}
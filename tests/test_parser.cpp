@@ -1,7 +1,10 @@
 #include "doctest.h"
+#include "tolang/error.h"
 #include "tolang/lexer.h"
 #include "tolang/parser.h"
+#include <memory>
 #include <sstream>
+#include <string>
 
 constexpr char INPUT[] = R"(
 fn add(a, b) => a + b;
@@ -163,4 +166,135 @@ TEST_CASE("testing parser") {
     root->print(oss);
 
     CHECK(oss.str() == EXPECTED);
-}
\ No newline at end of file
+}
+
+TEST_CASE("testing parser on token buffer") {
+    std::istringstream iss(INPUT);
+
+    Lexer lexer(iss);
+    TokenBuffer tokens(lexer.source());
+    lexer.tokenize(tokens);
+    CHECK_EQ(tokens.type(tokens.size() - 1), Token::TK_EOF);
+
+    Parser parser(tokens, lexer.names());
+    auto root = parser.parse();
+
+    std::ostringstream oss;
+    root->print(oss);
+
+    CHECK(oss.str() == EXPECTED);
+}
+
+TEST_CASE("testing parser on a lexer past its window") {
+    // many windows of tokens, with syntax errors and invalid characters
+    std::string input = "fn f(a, b) => a * b;\nvar x;\n";
+    for (std::size_t i = 0; input.size() < 40 * Parser::WINDOW_SIZE; i++) {
+        input += i % 97 == 0   ? "let x = f(x, 1 $;\n"
+                 : i % 89 == 0 ? "put x +;\n"
+                               : "let x = f(x, (x + 1) * 2) - -3;\n";
+    }
+
+    auto parse = [&](bool stream) {
+        DiagnosticsEngine engine;
+        DiagnosticsScope scope(engine);
+        Lexer lexer(input.data(), input.data() + input.size());
+        TokenBuffer tokens(lexer.source());
+        std::unique_ptr<CompUnit> root;
+        if (stream) {
+            root = Parser(lexer).parse();
+        } else {
+            lexer.tokenize(tokens);
+            root = Parser(tokens, lexer.names()).parse();
+        }
+        std::ostringstream oss;
+        root->print(oss);
+        engine.dump(oss, *root->lines);
+        return oss.str();
+    };
+    CHECK(parse(true) == parse(false));
+}
+
+TEST_CASE("testing parser on precedence") {
+    std::string input = "let x = -1 - 2 * f(3, 4) / +5 + (6 - 7);";
+    Lexer lexer(input.data(), input.data() + input.size());
+    Parser parser(lexer);
+    auto root = parser.parse();
+    REQUIRE_EQ(root->stmts.size(), 1);
+
+    // ((-1 - ((2 * f(3, 4)) / +5)) + (6 - 7))
+    auto &let = std::get<LetStmt>(*root->stmts[0]);
+    auto &add = std::get<BinaryExp>(*let.exp);
+    CHECK_EQ(add.op, BinaryExp::PLUS);
+    CHECK_EQ(std::get<BinaryExp>(*add.rhs).op, BinaryExp::MINU);
+    auto &sub = std::get<BinaryExp>(*add.lhs);
+    CHECK_EQ(sub.op, BinaryExp::MINU);
+    CHECK_EQ(std::get<UnaryExp>(*sub.lhs).op, UnaryExp::MINU);
+    auto &div = std::get<BinaryExp>(*sub.rhs);
+    CHECK_EQ(div.op, BinaryExp::DIV);
+    CHECK_EQ(std::get<UnaryExp>(*div.rhs).op, UnaryExp::PLUS);
+    auto &mul = std::get<BinaryExp>(*div.lhs);
+    CHECK_EQ(mul.op, BinaryExp::MULT);
+    CHECK_EQ(std::get<CallExp>(*mul.rhs).func_r_params.size(), 2);
+
+    // a binary expression is located at the start of its rule
+    CHECK_EQ(add.loc.offset, input.find("-1"));
+    CHECK_EQ(div.loc.offset, input.find("2 *"));
+}
+
+TEST_CASE("testing parser on deeply nested expressions") {
+    // one million levels, far more than the native stack could hold if
+    // every level took a few recursive calls
+    constexpr int DEPTH = 1000000;
+    std::string input = "let x = ";
+    for (int i = 0; i < DEPTH; i++) {
+        input += i % 2 == 0 ? "-(" : "f(";
+    }
+    input += "x";
+    input.append(DEPTH, ')');
+    input += ";";
+
+    Lexer lexer(input.data(), input.data() + input.size());
+    Parser parser(lexer);
+    auto root = parser.parse();
+    REQUIRE_EQ(root->stmts.size(), 1);
+
+    int depth = 0;
+    const Exp *exp = std::get<LetStmt>(*root->stmts[0]).exp;
+    while (exp != nullptr && !std::holds_alternative<IdentExp>(*exp)) {
+        if (auto unary = std::get_if<UnaryExp>(exp)) {
+            exp = unary->exp;
+        } else {
+            auto &call = std::get<CallExp>(*exp);
+            REQUIRE_EQ(call.func_r_params.size(), 1);
+            exp = call.func_r_params[0];
+        }
+        depth++;
+    }
+    CHECK_EQ(depth, DEPTH);
+}
+
+TEST_CASE("testing parallel parser") {
+    // enough definitions for three chunks, followed by the other sections
+    std::string input;
+    for (int i = 0; input.size() < 4 * 3 * Parser::MIN_PARALLEL_TOKENS; i++) {
+        auto name = "f" + std::to_string(i);
+        input += "fn " + name + "(a, b) => a * (b - " + std::to_string(i) +
+                 ") + g(a, -b);\n";
+    }
+    input += "var x;\nget x;\nput f0(x, 1);\n";
+
+    Lexer lexer(input.data(), input.data() + input.size());
+    TokenBuffer tokens(lexer.source());
+    lexer.tokenize(tokens);
+
+    auto serial = Parser(tokens, lexer.names()).parse();
+    auto parallel = Parser(tokens, lexer.names()).parse_parallel(3);
+    REQUIRE_EQ(parallel->func_defs.size(), serial->func_defs.size());
+    CHECK_EQ(parallel->var_decls.size(), 1);
+    CHECK_EQ(parallel->stmts.size(), 2);
+
+    std::ostringstream expected, actual;
+    serial->print(expected);
+    parallel->print(actual);
+    CHECK(actual.str() == expected.str());
+}
@@ -0,0 +1,125 @@
+#include "doctest.h"
+
+#include "tolang/error.h"
+#include "tolang/flat_ast.h"
+#include "tolang/lexer.h"
+#include "tolang/parser.h"
+#include "tolang/resolver.h"
+#include <memory>
+#include <string>
+#include <variant>
+
+static const std::string INPUT = "fn f(a, b) => a * b;\n"
+                                 "var x;\n"
+                                 "var y;\n"
+                                 "get x;\n"
+                                 "let y = f(x, 2);\n"
+                                 "to end;\n"
+                                 "tag end;\n";
+
+static std::unique_ptr<CompUnit> parse(const std::string &input) {
+    Lexer lexer(input.data(), input.data() + input.size());
+    return Parser(lexer).parse();
+}
+
+TEST_CASE("testing resolver binding identifiers to slots") {
+    auto root = parse(INPUT);
+    Resolver resolver;
+    resolver.resolve(*root);
+
+    auto &func = *root->func_defs[0];
+    auto &body = std::get<BinaryExp>(*func.exp);
+    uint32_t f = func.ident->slot;
+    uint32_t a = func.func_f_params[0]->slot;
+    uint32_t b = func.func_f_params[1]->slot;
+    CHECK_EQ(std::get<IdentExp>(*body.lhs).ident->slot, a);
+    CHECK_EQ(std::get<IdentExp>(*body.rhs).ident->slot, b);
+
+    uint32_t x = root->var_decls[0]->ident->slot;
+    uint32_t y = root->var_decls[1]->ident->slot;
+    CHECK_EQ(std::get<GetStmt>(*root->stmts[0]).ident->slot, x);
+    auto &let = std::get<LetStmt>(*root->stmts[1]);
+    CHECK_EQ(let.ident->slot, y);
+    auto &call = std::get<CallExp>(*let.exp);
+    CHECK_EQ(call.ident->slot, f);
+    CHECK_EQ(std::get<IdentExp>(*call.func_r_params[0]).ident->slot, x);
+
+    uint32_t end = std::get<ToStmt>(*root->stmts[2]).ident->slot;
+    CHECK_EQ(std::get<TagStmt>(*root->stmts[3]).ident->slot, end);
+
+    // every symbol has a slot of its own
+    CHECK_EQ(resolver.size(), 6);
+    for (uint32_t slot : {f, a, b, x, y, end}) {
+        REQUIRE_LT(slot, resolver.size());
+        CHECK_EQ(resolver.symbol(slot).slot, slot);
+    }
+    CHECK_EQ(resolver.symbol(f).type, SymbolType::FUNC);
+    CHECK_EQ(resolver.symbol(x).name, "x");
+    CHECK_EQ(resolver.symbol(end).type, SymbolType::TAG);
+}
+
+TEST_CASE("testing resolver on the flat layout") {
+    auto root = parse(INPUT);
+    Resolver().resolve(*root);
+    auto ast = flatten(*parse(INPUT));
+    Resolver().resolve(ast);
+
+    auto &let = std::get<LetStmt>(*root->stmts[1]);
+    auto &stmt = ast.stmts[1];
+    CHECK_EQ(ast.idents[stmt.ident].slot, let.ident->slot);
+    CHECK_EQ(ast.idents[ast.func_defs[0].ident].slot,
+             root->func_defs[0]->ident->slot);
+}
+
+TEST_CASE("testing resolver on names with errors") {
+    auto root = parse("fn f(a, a) => a;\n"
+                      "var x;\n"
+                      "var x;\n"
+                      "let z = 1;\n"
+                      "let f = 1;\n"
+                      "put f(1);\n"
+                      "put x(1);\n");
+    Resolver resolver;
+    resolver.resolve(*root);
+
+    // a duplicate parameter still takes an argument slot
+    auto &func = *root->func_defs[0];
+    CHECK_NE(func.func_f_params[0]->slot, NO_SLOT);
+    CHECK_NE(func.func_f_params[0]->slot, func.func_f_params[1]->slot);
+
+    CHECK_NE(root->var_decls[0]->ident->slot, NO_SLOT);
+
+    // undefined names, variables called and functions assigned
+    CHECK_EQ(std::get<LetStmt>(*root->stmts[0]).ident->slot, NO_SLOT);
+    CHECK_EQ(std::get<LetStmt>(*root->stmts[1]).ident->slot, NO_SLOT);
+    auto &bad_args = std::get<CallExp>(*std::get<PutStmt>(*root->stmts[2]).exp);
+    CHECK_EQ(bad_args.ident->slot, NO_SLOT);
+    auto &bad_call = std::get<CallExp>(*std::get<PutStmt>(*root->stmts[3]).exp);
+    CHECK_EQ(bad_call.ident->slot, NO_SLOT);
+}
+
+TEST_CASE("testing resolver on deep expressions") {
+    // the walk takes no native stack per level, and still reports the names
+    // at the bottom of the tree
+    std::string input = "var x;\nlet x = y";
+    for (int i = 0; i < 1000000; i++) {
+        input += " + 1";
+    }
+    input += ";\n";
+    auto root = parse(input);
+
+    DiagnosticsEngine engine;
+    {
+        DiagnosticsScope scope(engine);
+        Resolver().resolve(*root);
+    }
+    REQUIRE_EQ(engine.errors().size(), 1);
+    CHECK_NE(engine.errors()[0].msg.find("y"), std::string::npos);
+    auto &let = std::get<LetStmt>(*root->stmts[0]);
+    CHECK_NE(let.ident->slot, NO_SLOT);
+    const Exp *exp = let.exp;
+    while (auto binary = std::get_if<BinaryExp>(exp)) {
+        exp = binary->lhs;
+    }
+    CHECK_EQ(std::get<IdentExp>(*exp).ident->slot, NO_SLOT);
+}
@@ -0,0 +1,28 @@
+#include "doctest.h"
+
+#include "tolang/source_loc.h"
+#include <string>
+
+TEST_CASE("testing line table") {
+    std::string source = "var a;\n\n  get a;\nput a";
+    LineTable lines(source);
+    CHECK_EQ(lines.size(), 4);
+
+    auto check = [&](std::size_t offset, int line, int column) {
+        auto pos = lines.line_column(SourceLoc(offset));
+        CHECK_EQ(lines.line(SourceLoc(offset)), line);
+        CHECK_EQ(pos.line, line);
+        CHECK_EQ(pos.column, column);
+    };
+    check(0, 1, 1);                   // `var`
+    check(4, 1, 5);                   // `a`
+    check(6, 1, 7);                   // the first newline
+    check(7, 2, 1);                   // the empty line
+    check(10, 3, 3);                  // `get`
+    check(source.size() - 1, 4, 5);   // the last `a`
+    check(source.size(), 4, 6);       // EOF
+
+    LineTable empty;
+    CHECK_EQ(empty.line(SourceLoc(0)), 1);
+    CHECK_EQ(LineTable("").size(), 1);
+}
@@ -1,55 +1,94 @@
-#include "tolang/utils.h"
-
-#if TOLANG_BACKEND == LLVM
-
 #include "doctest.h"
+#include "tolang/name_table.h"
 #include "tolang/symtable.h"
-#include <memory>
 #include <string>
-#include <unordered_map>
-#include <vector>
 
 TEST_CASE("testing low symbol table") {
-    std::shared_ptr<SymbolTable> cur_table = std::make_shared<SymbolTable>();
-    std::shared_ptr<Symbol> cur_symbol;
+    NameTable names;
+    NameId a = names.intern("a");
+    NameId b = names.intern("b");
+    NameId d = names.intern("d");
+    SymbolTable table;
+    const Symbol *cur_symbol;
 
-    CHECK(cur_table->add_symbol(
-        std::make_shared<VariableSymbol>("a", nullptr, 10)));
+    CHECK(table.add_symbol(Symbol(SymbolType::VAR, a, "a", SourceLoc(10))));
 
-    CHECK(cur_table->add_symbol(
-        std::make_shared<VariableSymbol>("b", nullptr, 20)));
+    CHECK(table.add_symbol(Symbol(SymbolType::VAR, b, "b", SourceLoc(20))));
 
-    CHECK_FALSE(cur_table->add_symbol(
-        std::make_shared<VariableSymbol>("b", nullptr, 30)));
+    CHECK_FALSE(
+        table.add_symbol(Symbol(SymbolType::VAR, b, "b", SourceLoc(30))));
 
-    CHECK((cur_symbol = cur_table->get_symbol("a")) != nullptr);
+    CHECK((cur_symbol = table.get_symbol(a)) != nullptr);
     CHECK(cur_symbol->name == "a");
-    CHECK(cur_symbol->lineno == 10);
+    CHECK(cur_symbol->loc.offset == 10);
 
-    CHECK((cur_symbol = cur_table->get_symbol("d")) == nullptr);
+    CHECK((cur_symbol = table.get_symbol(d)) == nullptr);
 
     // new scope
-    cur_table = cur_table->push_scope();
+    table.push_scope();
 
-    CHECK((cur_symbol = cur_table->get_symbol("a")) != nullptr);
+    CHECK((cur_symbol = table.get_symbol(a)) != nullptr);
     CHECK(cur_symbol->name == "a");
+    CHECK_FALSE(table.exist_in_scope(a));
 
-    CHECK(cur_table->add_symbol(
-        std::make_shared<VariableSymbol>("a", nullptr, 40)));
+    CHECK(table.add_symbol(Symbol(SymbolType::VAR, a, "a", SourceLoc(40))));
 
-    CHECK((cur_symbol = cur_table->get_symbol("a")) != nullptr);
-    CHECK(cur_symbol->lineno == 40);
+    CHECK((cur_symbol = table.get_symbol(a)) != nullptr);
+    CHECK(cur_symbol->loc.offset == 40);
+    CHECK(table.exist_in_scope(a));
 
-    CHECK(cur_table->add_symbol(std::make_shared<TagSymbol>("b", nullptr, 50)));
+    CHECK(table.add_symbol(Symbol(SymbolType::TAG, b, "b", SourceLoc(50))));
 
     CHECK_FALSE(
-        cur_table->add_symbol(std::make_shared<TagSymbol>("b", nullptr, 60)));
+        table.add_symbol(Symbol(SymbolType::TAG, b, "b", SourceLoc(60))));
 
     // pop scope
-    cur_table = cur_table->pop_scope();
+    table.pop_scope();
 
-    CHECK((cur_symbol = cur_table->get_symbol("a")) != nullptr);
-    CHECK(cur_symbol->lineno == 10);
+    CHECK((cur_symbol = table.get_symbol(a)) != nullptr);
+    CHECK(cur_symbol->loc.offset == 10);
+    CHECK((cur_symbol = table.get_symbol(b)) != nullptr);
+    CHECK(cur_symbol->type == SymbolType::VAR);
+
+    // every symbol took a slot, added or not
+    CHECK(table.size() == 6);
+    CHECK(table.symbol(2).loc.offset == 30);
+    CHECK(table.symbol(5).slot == 5);
 }
 
-#endif
+TEST_CASE("testing symbol table with many names and scopes") {
+    NameTable names;
+    SymbolTable table;
+    const int count = 1000;
+    for (int i = 0; i < count; i++) {
+        auto name = "v" + std::to_string(i);
+        table.add_symbol(
+            Symbol(SymbolType::VAR, names.intern(name), "", SourceLoc(i)));
+    }
+
+    for (int depth = 0; depth < 10; depth++) {
+        table.push_scope();
+        for (int i = depth; i < count; i += 10) {
+            auto name = "v" + std::to_string(i);
+            CHECK(table.add_symbol(Symbol(SymbolType::TAG, names.intern(name),
+                                          "", SourceLoc(i))));
+        }
+    }
+    for (int depth = 9; depth >= 0; depth--) {
+        for (int i = 0; i < count; i += 97) {
+            auto symbol =
+                table.get_symbol(names.intern("v" + std::to_string(i)));
+            REQUIRE(symbol != nullptr);
+            CHECK(symbol->type ==
+                  (i % 10 <= depth ? SymbolType::TAG : SymbolType::VAR));
+        }
+        table.pop_scope();
+    }
+
+    for (int i = 0; i < count; i++) {
+        auto symbol = table.get_symbol(names.intern("v" + std::to_string(i)));
+        REQUIRE(symbol != nullptr);
+        CHECK(symbol->type == SymbolType::VAR);
+        CHECK(symbol->slot == i);
+    }
+}